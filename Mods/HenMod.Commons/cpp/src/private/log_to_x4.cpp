@@ -12,6 +12,7 @@ namespace LogToX4 {
 
 static string g_module_dir;
 static string g_log_timestamp;
+static string g_data_dir;
 
 string GetLogDir() {
   if (!g_module_dir.empty())
@@ -29,6 +30,21 @@ string GetLogDir() {
   return g_module_dir;
 }
 
+string GetDataDir() {
+  if (!g_data_dir.empty())
+    return g_data_dir;
+
+  // Local app data is per user and not shared along with logs
+  char appDataPath[MAX_PATH];
+  if (SHGetFolderPathA(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, appDataPath) == S_OK) {
+    g_data_dir = string(appDataPath) + "\\HenMod";
+    CreateDirectoryA(g_data_dir.c_str(), NULL);
+  } else {
+    g_data_dir = GetLogDir();
+  }
+  return g_data_dir;
+}
+
 string GetLogTimestamp() {
   if (!g_log_timestamp.empty())
     return g_log_timestamp;
@@ -0,0 +1,762 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Awaitable tasks for multi-step network flows (authenticate, connect,
+// resolve, join) that never park a thread. A Task<T> is a lazy coroutine: it
+// starts when awaited or spawned, and after every suspension it resumes on
+// its TaskScheduler, so one task never runs on two threads at once.
+// Cancellation is cooperative: cancelling the token a task runs under makes
+// its pending and later awaits throw TaskCancelled.
+
+// Runs posted work in order on one thread (e.g. a network executor)
+class TaskScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~TaskScheduler() = default;
+    // Both may be called from any thread
+    virtual void Post(std::function<void()> work) = 0;
+    virtual void PostAt(Clock::time_point when, std::function<void()> work) = 0;
+};
+
+class TaskCancelled : public std::runtime_error
+{
+public:
+    TaskCancelled() : std::runtime_error("task cancelled") {}
+};
+
+class TaskTimeout : public std::runtime_error
+{
+public:
+    TaskTimeout() : std::runtime_error("task timed out") {}
+};
+
+namespace task_detail {
+
+struct CancellationState
+{
+    std::atomic<bool> cancelled{false};
+    std::mutex mutex;
+    std::uint64_t nextId = 1;
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> callbacks;
+    // Linked sources are cancelled with their parent
+    std::shared_ptr<CancellationState> parent;
+    std::uint64_t parentRegistration = 0;
+
+    ~CancellationState()
+    {
+        if (parent)
+        {
+            parent->Unregister(parentRegistration);
+        }
+    }
+
+    std::uint64_t Register(std::function<void()> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!cancelled.load(std::memory_order_relaxed))
+            {
+                callbacks.emplace_back(nextId, std::move(callback));
+                return nextId++;
+            }
+        }
+        callback();
+        return 0;
+    }
+
+    void Unregister(std::uint64_t id)
+    {
+        if (id == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        std::erase_if(callbacks, [id](const auto &entry) { return entry.first == id; });
+    }
+
+    bool Cancel()
+    {
+        std::vector<std::pair<std::uint64_t, std::function<void()>>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cancelled.exchange(true, std::memory_order_acq_rel))
+            {
+                return false;
+            }
+            pending.swap(callbacks);
+        }
+        for (auto &entry : pending)
+        {
+            entry.second();
+        }
+        return true;
+    }
+};
+
+} // namespace task_detail
+
+// Observes a CancellationSource. A default-constructed token is never
+// cancelled.
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+
+    bool IsCancelled() const { return m_state && m_state->cancelled.load(std::memory_order_acquire); }
+
+    // Runs callback once, on the cancelling thread, when the source is
+    // cancelled (right away if it already is). Returns an id for Unregister,
+    // or 0 if the callback already ran or never can. A callback that is
+    // running while Unregister is called may still complete.
+    std::uint64_t Register(std::function<void()> callback) const
+    {
+        return m_state ? m_state->Register(std::move(callback)) : 0;
+    }
+
+    void Unregister(std::uint64_t id) const
+    {
+        if (m_state)
+        {
+            m_state->Unregister(id);
+        }
+    }
+
+private:
+    friend class CancellationSource;
+    explicit CancellationToken(std::shared_ptr<task_detail::CancellationState> state) : m_state(std::move(state)) {}
+
+    std::shared_ptr<task_detail::CancellationState> m_state;
+};
+
+class CancellationSource
+{
+public:
+    CancellationSource() : m_state(std::make_shared<task_detail::CancellationState>()) {}
+
+    // Also cancelled when parent is
+    explicit CancellationSource(const CancellationToken &parent) : CancellationSource()
+    {
+        if (!parent.m_state)
+        {
+            return;
+        }
+        std::weak_ptr<task_detail::CancellationState> weak = m_state;
+        m_state->parentRegistration = parent.m_state->Register([weak]()
+        {
+            if (auto state = weak.lock())
+            {
+                state->Cancel();
+            }
+        });
+        m_state->parent = parent.m_state;
+    }
+
+    CancellationToken Token() const { return CancellationToken(m_state); }
+    // Returns false if it was already cancelled
+    bool Cancel() { return m_state->Cancel(); }
+    bool IsCancelled() const { return m_state->cancelled.load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<task_detail::CancellationState> m_state;
+};
+
+template <typename T = void>
+class Task;
+
+namespace task_detail {
+
+class PromiseBase;
+template <typename T>
+class Promise;
+
+// Resumes whoever awaited the task; a spawned task hands its result to
+// onDone instead, which destroys the frame
+struct FinalAwaiter
+{
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        auto &promise = handle.promise();
+        if (promise.continuation)
+        {
+            return promise.continuation;
+        }
+        std::function<void()> onDone = std::move(promise.onDone);
+        if (onDone)
+        {
+            onDone();
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+};
+
+class PromiseBase
+{
+public:
+    TaskScheduler *scheduler = nullptr;
+    CancellationToken token;
+    bool tokenBound = false;
+    std::coroutine_handle<> continuation;
+    std::function<void()> onDone;
+    std::exception_ptr exception;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+    // A child task runs on its parent's scheduler and, unless given its own
+    // token, under the parent's
+    void Inherit(const PromiseBase &parent)
+    {
+        scheduler = parent.scheduler;
+        if (!tokenBound)
+        {
+            token = parent.token;
+        }
+    }
+};
+
+template <typename Promise>
+concept TaskPromise = std::derived_from<Promise, PromiseBase>;
+
+// Starts the awaited task in place; it resumes the awaiting one when done
+template <typename T>
+struct TaskAwaiter
+{
+    std::coroutine_handle<Promise<T>> child;
+
+    bool await_ready() noexcept { return false; }
+
+    template <TaskPromise Parent>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Parent> parent) noexcept
+    {
+        child.promise().Inherit(parent.promise());
+        child.promise().continuation = parent;
+        return child;
+    }
+
+    T await_resume() { return child.promise().TakeResult(); }
+};
+
+template <typename T>
+class Promise : public PromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+    void return_value(T value) { m_value.emplace(std::move(value)); }
+
+    T TakeResult()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template <>
+class Promise<void> : public PromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+
+    void TakeResult()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace task_detail
+
+template <typename T>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = task_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : m_handle(handle) {}
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    ~Task() { Reset(); }
+
+    // Runs under token instead of the token of whoever awaits or spawns it
+    Task &&WithCancellation(CancellationToken token) &&
+    {
+        m_handle.promise().token = std::move(token);
+        m_handle.promise().tokenBound = true;
+        return std::move(*this);
+    }
+
+    task_detail::TaskAwaiter<T> operator co_await() && noexcept { return {m_handle}; }
+
+    // Hands the coroutine frame over to the caller
+    Handle Release() { return std::exchange(m_handle, {}); }
+
+private:
+    void Reset()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+            m_handle = {};
+        }
+    }
+
+    Handle m_handle;
+};
+
+namespace task_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+struct Unit
+{
+};
+
+// Shared by a suspended task and whatever may resume it: a completion
+// callback, a timer or cancellation. The first to finish it wins, and the
+// task resumes on its scheduler.
+template <typename T>
+class Rendezvous : public std::enable_shared_from_this<Rendezvous<T>>
+{
+public:
+    // From await_suspend, before starting the operation
+    void Arm(std::coroutine_handle<> handle, const PromiseBase &promise)
+    {
+        m_handle = handle;
+        m_scheduler = promise.scheduler;
+        m_token = promise.token;
+        std::weak_ptr<Rendezvous> weak = this->weak_from_this();
+        m_registration = m_token.Register([weak]()
+        {
+            if (auto self = weak.lock())
+            {
+                self->Fail(std::make_exception_ptr(TaskCancelled()));
+            }
+        });
+    }
+
+    template <typename... Args>
+    bool Succeed(Args &&...args)
+    {
+        if (!Claim())
+        {
+            return false;
+        }
+        if constexpr (std::is_void_v<T>)
+        {
+            m_value.emplace();
+        }
+        else
+        {
+            m_value.emplace(std::forward<Args>(args)...);
+        }
+        Resume();
+        return true;
+    }
+
+    bool Fail(std::exception_ptr exception)
+    {
+        if (!Claim())
+        {
+            return false;
+        }
+        m_exception = std::move(exception);
+        Resume();
+        return true;
+    }
+
+    bool IsFinished() const { return m_claimed.load(std::memory_order_acquire); }
+
+    // From await_resume
+    T Take()
+    {
+        m_token.Unregister(m_registration);
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+        if constexpr (!std::is_void_v<T>)
+        {
+            return std::move(*m_value);
+        }
+    }
+
+private:
+    bool Claim() { return !m_claimed.exchange(true, std::memory_order_acq_rel); }
+    void Resume()
+    {
+        m_scheduler->Post([handle = m_handle]() { handle.resume(); });
+    }
+
+    std::atomic<bool> m_claimed{false};
+    std::optional<std::conditional_t<std::is_void_v<T>, Unit, T>> m_value;
+    std::exception_ptr m_exception;
+    std::coroutine_handle<> m_handle;
+    TaskScheduler *m_scheduler = nullptr;
+    CancellationToken m_token;
+    std::uint64_t m_registration = 0;
+};
+
+template <typename T, typename Start, typename ToException>
+class CallbackAwaitable
+{
+public:
+    CallbackAwaitable(Start start, ToException toException)
+        : m_start(std::move(start)), m_toException(std::move(toException))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    template <TaskPromise Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        m_state->Arm(handle, handle.promise());
+        if (m_state->IsFinished())
+        {
+            return; // Cancelled before it started
+        }
+        auto state = m_state;
+        auto onSuccess = [state](auto &&...value) { state->Succeed(std::forward<decltype(value)>(value)...); };
+        auto onError = [state, toException = m_toException](const auto &error) { state->Fail(toException(error)); };
+        try
+        {
+            m_start(std::move(onSuccess), std::move(onError));
+        }
+        catch (...)
+        {
+            state->Fail(std::current_exception());
+        }
+    }
+
+    T await_resume() { return m_state->Take(); }
+
+private:
+    Start m_start;
+    ToException m_toException;
+    std::shared_ptr<Rendezvous<T>> m_state = std::make_shared<Rendezvous<T>>();
+};
+
+template <typename T>
+class FutureAwaitable
+{
+public:
+    FutureAwaitable(std::future<T> future, std::chrono::milliseconds pollInterval)
+        : m_future(std::move(future)), m_pollInterval(pollInterval)
+    {
+    }
+
+    bool await_ready() const { return m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+    template <TaskPromise Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        m_state->Arm(handle, handle.promise());
+        Poll(m_state, std::make_shared<std::future<T>>(std::move(m_future)), handle.promise().scheduler,
+             m_pollInterval);
+    }
+
+    T await_resume()
+    {
+        // Still ours if it was ready without suspending
+        if (m_future.valid())
+        {
+            return m_future.get();
+        }
+        return m_state->Take();
+    }
+
+private:
+    static void Poll(std::shared_ptr<Rendezvous<T>> state, std::shared_ptr<std::future<T>> future,
+                     TaskScheduler *scheduler, std::chrono::milliseconds interval)
+    {
+        if (state->IsFinished())
+        {
+            return; // Cancelled
+        }
+        if (future->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            scheduler->PostAt(TaskScheduler::Clock::now() + interval,
+                              [state, future, scheduler, interval]() { Poll(state, future, scheduler, interval); });
+            return;
+        }
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                future->get();
+                state->Succeed();
+            }
+            else
+            {
+                state->Succeed(future->get());
+            }
+        }
+        catch (...)
+        {
+            state->Fail(std::current_exception());
+        }
+    }
+
+    std::future<T> m_future;
+    std::chrono::milliseconds m_pollInterval;
+    std::shared_ptr<Rendezvous<T>> m_state = std::make_shared<Rendezvous<T>>();
+};
+
+class DelayAwaitable
+{
+public:
+    explicit DelayAwaitable(TaskScheduler::Clock::time_point when) : m_when(when) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    template <TaskPromise Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        m_state->Arm(handle, handle.promise());
+        auto state = m_state;
+        handle.promise().scheduler->PostAt(m_when, [state]() { state->Succeed(); });
+    }
+
+    void await_resume() { m_state->Take(); }
+
+private:
+    TaskScheduler::Clock::time_point m_when;
+    std::shared_ptr<Rendezvous<void>> m_state = std::make_shared<Rendezvous<void>>();
+};
+
+} // namespace task_detail
+
+struct TaskContext
+{
+    TaskScheduler *scheduler = nullptr;
+    CancellationToken token;
+};
+
+namespace task_detail {
+
+struct ContextAwaiter
+{
+    TaskContext context;
+
+    bool await_ready() noexcept { return false; }
+
+    template <TaskPromise Promise>
+    bool await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        context = {handle.promise().scheduler, handle.promise().token};
+        return false;
+    }
+
+    TaskContext await_resume() { return context; }
+};
+
+} // namespace task_detail
+
+// co_await CurrentTaskContext() yields the running task's scheduler and token
+// without suspending
+inline task_detail::ContextAwaiter CurrentTaskContext()
+{
+    return {};
+}
+
+// Adapts an API that reports through a success/error callback pair. start
+// receives (onSuccess, onError) and issues the request; toException maps the
+// error callback's argument to a std::exception_ptr. The callbacks may fire
+// on any thread; the first of success, error and cancellation wins and later
+// calls are ignored.
+template <typename T, typename Start, typename ToException>
+task_detail::CallbackAwaitable<T, Start, ToException> FromCallbacks(Start start, ToException toException)
+{
+    return {std::move(start), std::move(toException)};
+}
+
+// std::future has no completion callback, so a pending one is polled on the
+// scheduler every pollInterval
+template <typename T>
+task_detail::FutureAwaitable<T> FromFuture(std::future<T> future,
+                                           std::chrono::milliseconds pollInterval = std::chrono::milliseconds(5))
+{
+    return {std::move(future), pollInterval};
+}
+
+inline task_detail::DelayAwaitable DelayUntil(TaskScheduler::Clock::time_point when)
+{
+    return task_detail::DelayAwaitable(when);
+}
+
+inline task_detail::DelayAwaitable Delay(TaskScheduler::Clock::duration duration)
+{
+    return task_detail::DelayAwaitable(TaskScheduler::Clock::now() + duration);
+}
+
+template <typename Awaitable>
+auto AwaitAsTask(Awaitable awaitable) -> Task<decltype(awaitable.await_resume())>
+{
+    co_return co_await std::move(awaitable);
+}
+
+// Throws TaskTimeout if the task has not finished by the deadline. The task
+// runs under a token linked to the caller's, so it is also cancelled with it.
+template <typename T>
+Task<T> WithDeadline(Task<T> task, TaskScheduler::Clock::time_point deadline)
+{
+    const TaskContext context = co_await CurrentTaskContext();
+    auto source = std::make_shared<CancellationSource>(context.token);
+    auto expired = std::make_shared<std::atomic<bool>>(false);
+    std::weak_ptr<CancellationSource> weak = source;
+    context.scheduler->PostAt(deadline, [weak, expired]()
+    {
+        if (auto source = weak.lock())
+        {
+            expired->store(true);
+            source->Cancel();
+        }
+    });
+
+    try
+    {
+        co_return co_await std::move(task).WithCancellation(source->Token());
+    }
+    catch (const TaskCancelled &)
+    {
+        if (expired->load())
+        {
+            throw TaskTimeout();
+        }
+        throw;
+    }
+}
+
+template <typename Awaitable>
+    requires requires(Awaitable awaitable) { awaitable.await_resume(); }
+auto WithDeadline(Awaitable awaitable, TaskScheduler::Clock::time_point deadline)
+{
+    return WithDeadline(AwaitAsTask(std::move(awaitable)), deadline);
+}
+
+template <typename Awaitable>
+auto WithTimeout(Awaitable awaitable, TaskScheduler::Clock::duration timeout)
+{
+    return WithDeadline(std::move(awaitable), TaskScheduler::Clock::now() + timeout);
+}
+
+// Starts task on scheduler. done receives a ready future holding the result
+// or exception, on the scheduler's thread. If the scheduler drops its work
+// (e.g. is destroyed) before the task finishes, neither happens.
+template <typename T>
+void Spawn(TaskScheduler &scheduler, Task<T> task, std::type_identity_t<std::function<void(std::future<T>)>> done,
+           CancellationToken token = {})
+{
+    auto handle = task.Release();
+    auto &promise = handle.promise();
+    promise.scheduler = &scheduler;
+    if (!promise.tokenBound)
+    {
+        promise.token = std::move(token);
+    }
+    promise.onDone = [handle, done = std::move(done)]()
+    {
+        std::promise<T> result;
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                handle.promise().TakeResult();
+                result.set_value();
+            }
+            else
+            {
+                result.set_value(handle.promise().TakeResult());
+            }
+        }
+        catch (...)
+        {
+            result.set_exception(std::current_exception());
+        }
+        handle.destroy();
+        if (done)
+        {
+            done(result.get_future());
+        }
+    };
+    scheduler.Post([handle]() { handle.resume(); });
+}
+
+template <typename T>
+std::future<T> Spawn(TaskScheduler &scheduler, Task<T> task, CancellationToken token = {})
+{
+    auto result = std::make_shared<std::promise<T>>();
+    std::future<T> future = result->get_future();
+    Spawn<T>(
+        scheduler, std::move(task),
+        [result](std::future<T> done)
+        {
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    done.get();
+                    result->set_value();
+                }
+                else
+                {
+                    result->set_value(done.get());
+                }
+            }
+            catch (...)
+            {
+                result->set_exception(std::current_exception());
+            }
+        },
+        std::move(token));
+    return future;
+}
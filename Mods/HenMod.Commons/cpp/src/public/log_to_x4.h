@@ -10,5 +10,7 @@ namespace LogToX4 {
 
 	// Utilities (exposed for tests or advanced usage)
 	std::string GetModuleDir();                 // returns directory path of this DLL
+	std::string GetLogDir();                    // where log and data files are written
+	std::string GetDataDir();                   // per-user app data, for files that must not sit with logs
 	void AppendToModLog(const std::string& s); // append text to module log file
 }
\ No newline at end of file
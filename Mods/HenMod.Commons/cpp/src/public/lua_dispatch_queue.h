@@ -0,0 +1,193 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+#include "log_to_x4.h"
+#include "mpsc_queue.h"
+#include <lua/lua_includes.h>
+
+// Pending Lua invocations posted from any thread and run on the thread that
+// owns the Lua state. Drain, called once per frame on that thread, hands the
+// whole batch to a small Lua trampoline in a single lua_pcall; the trampoline
+// calls each function under Lua's own pcall so one failing callback does not
+// drop the rest of the batch. Suspended coroutines are resumed the same way.
+class LuaDispatchQueue
+{
+public:
+    using Value = std::variant<std::monostate, bool, double, std::string>;
+
+    struct Stats
+    {
+        std::uint64_t posted = 0;
+        std::uint64_t dispatched = 0;
+        std::uint64_t batches = 0;
+        std::uint64_t errors = 0;
+    };
+
+    // Process-wide queue for the UI Lua state
+    static LuaDispatchQueue &Instance()
+    {
+        static LuaDispatchQueue instance;
+        return instance;
+    }
+
+    // The Lua state Drain runs on; set from the owning thread
+    void Attach(lua_State *L)
+    {
+        if (L != m_state)
+        {
+            m_state = L;
+            m_trampolineRef = LUA_NOREF; // Belonged to the previous state
+        }
+    }
+
+    lua_State *GetState() const { return m_state; }
+
+    // Any thread, lock-free. functionRef is a LUA_REGISTRYINDEX reference.
+    void Post(int functionRef, std::vector<Value> args = {})
+    {
+        m_queue.Push({functionRef, std::move(args)});
+        m_posted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Any thread, lock-free. Resumes the coroutine anchored at threadRef (a
+    // LUA_REGISTRYINDEX reference, released once it is dispatched) with args
+    // as the results of its yield.
+    void PostResume(int threadRef, std::vector<Value> args = {})
+    {
+        m_queue.Push({threadRef, std::move(args), true});
+        m_posted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Owner thread only. Runs everything posted so far in one pcall and
+    // returns the number of invocations; they wait in the queue while no
+    // state is attached.
+    size_t Drain()
+    {
+        lua_State *L = m_state;
+        if (!L || m_queue.Empty() || !PushTrampoline(L))
+        {
+            return 0;
+        }
+
+        // Event array: { { fn, arg1, ..., n = argc }, ... }
+        lua_newtable(L);
+        size_t count = 0;
+        Invocation invocation;
+        while (m_queue.TryPop(invocation))
+        {
+            lua_createtable(L, static_cast<int>(invocation.args.size()) + 1, 1);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, invocation.functionRef);
+            lua_rawseti(L, -2, 1);
+            if (invocation.releaseRef)
+            {
+                luaL_unref(L, LUA_REGISTRYINDEX, invocation.functionRef);
+            }
+            for (size_t i = 0; i < invocation.args.size(); ++i)
+            {
+                PushValue(L, invocation.args[i]);
+                lua_rawseti(L, -2, static_cast<int>(i) + 2);
+            }
+            lua_pushinteger(L, static_cast<lua_Integer>(invocation.args.size()));
+            lua_setfield(L, -2, "n");
+            lua_rawseti(L, -2, static_cast<int>(++count));
+        }
+
+        if (lua_pcall(L, 1, 2, 0) != 0)
+        {
+            LogToX4::Log("Error in Lua dispatch: %s", lua_tostring(L, -1));
+            lua_pop(L, 1);
+            ++m_stats.errors;
+        }
+        else
+        {
+            const int failed = static_cast<int>(lua_tointeger(L, -2));
+            if (failed > 0)
+            {
+                LogToX4::Log("Error in %d Lua callback(s), first: %s", failed, lua_tostring(L, -1));
+                m_stats.errors += static_cast<std::uint64_t>(failed);
+            }
+            lua_pop(L, 2);
+        }
+
+        m_stats.dispatched += count;
+        ++m_stats.batches;
+        return count;
+    }
+
+    // Owner thread only
+    Stats GetStats() const
+    {
+        Stats stats = m_stats;
+        stats.posted = m_posted.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct Invocation
+    {
+        int functionRef = LUA_NOREF;
+        std::vector<Value> args;
+        bool releaseRef = false; // One-shot: coroutine resumes
+    };
+
+    // Runs each event under pcall (or resumes it, for a coroutine); returns
+    // the failure count and first error
+    static constexpr const char *TRAMPOLINE =
+        "local events = ...\n"
+        "local failed, first = 0, nil\n"
+        "for i = 1, #events do\n"
+        "  local event = events[i]\n"
+        "  local run = type(event[1]) == 'thread' and coroutine.resume or pcall\n"
+        "  local ok, err = run(event[1], unpack(event, 2, event.n + 1))\n"
+        "  if not ok then\n"
+        "    failed = failed + 1\n"
+        "    first = first or tostring(err)\n"
+        "  end\n"
+        "end\n"
+        "return failed, first\n";
+
+    bool PushTrampoline(lua_State *L)
+    {
+        if (m_trampolineRef == LUA_NOREF)
+        {
+            if (luaL_loadstring(L, TRAMPOLINE) != 0)
+            {
+                LogToX4::Log("Failed to compile Lua dispatch trampoline: %s", lua_tostring(L, -1));
+                lua_pop(L, 1);
+                return false;
+            }
+            m_trampolineRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        lua_rawgeti(L, LUA_REGISTRYINDEX, m_trampolineRef);
+        return true;
+    }
+
+    static void PushValue(lua_State *L, const Value &value)
+    {
+        if (const bool *b = std::get_if<bool>(&value))
+        {
+            lua_pushboolean(L, *b);
+        }
+        else if (const double *d = std::get_if<double>(&value))
+        {
+            lua_pushnumber(L, *d);
+        }
+        else if (const std::string *s = std::get_if<std::string>(&value))
+        {
+            lua_pushlstring(L, s->data(), s->size());
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+    }
+
+    MpscQueue<Invocation> m_queue;
+    std::atomic<std::uint64_t> m_posted{0};
+    lua_State *m_state = nullptr;
+    int m_trampolineRef = LUA_NOREF;
+    Stats m_stats; // Owner thread only
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Lock-free multi-producer single-consumer queue (Vyukov's intrusive list).
+// Push may be called from any thread and never blocks; TryPop must only be
+// called from the one consumer thread. Items pop in the order their Push
+// completed, so each producer's items stay in order.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+    {
+        Node *stub = new Node();
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        T discarded;
+        while (TryPop(discarded))
+        {
+        }
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void Push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        // Swinging head first makes the push linearizable with one exchange;
+        // the consumer waits out the short window before next is linked
+        Node *previous = m_head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only. Returns false when empty, or when a producer is between
+    // its two steps (the item then shows up on the next call).
+    bool TryPop(T &out)
+    {
+        Node *tail = m_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+        out = std::move(next->value);
+        m_tail = next; // next becomes the new stub
+        delete tail;
+        return true;
+    }
+
+    // Consumer only; a hint, since producers may be pushing concurrently
+    bool Empty() const
+    {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node *> m_head; // Producers push here
+    Node *m_tail;               // Consumer pops from here
+};
@@ -4,6 +4,11 @@ Lua Wrapper Generator for X4 C++ Scripts
 
 This script scans C++ header files for functions marked with // LUA_EXPORT
 and generates Lua wrapper functions automatically.
+
+Functions marked with // LUA_EXPORT_AWAIT start an async operation and
+return its handle. They get a second, yieldable wrapper named <Name>Await
+(a trailing "Async" is dropped): called from a Lua coroutine, it yields until
+the operation finishes and returns success, error.
 """
 
 import re
@@ -19,6 +24,7 @@ class FunctionSignature:
         self.class_name = class_name.strip()
         self.header_file = header_file
         self.namespace = namespace.strip()
+        self.awaitable = False
 
     def __str__(self):
         param_str = ", ".join(f"{t} {n}" for t, n in self.params)
@@ -177,6 +183,7 @@ def scan_header_files_for_exports(header_dir: str) -> List[FunctionSignature]:
                                 parsed.class_name = current_class
                                 parsed.namespace = current_namespace
                                 parsed.header_file = file_path
+                                parsed.awaitable = '// LUA_EXPORT_AWAIT' in line
                                 functions.append(parsed)
                                 print(f"Found LUA_EXPORT function: {parsed} in class {current_class}")
                             except ValueError as e:
@@ -208,6 +215,11 @@ def split_params(params_str: str) -> List[str]:
 
     return params
 
+def await_function_name(func: FunctionSignature) -> str:
+    """Lua name of the yieldable wrapper for an awaitable function."""
+    base = func.name[:-len("Async")] if func.name.endswith("Async") else func.name
+    return f"{base}Await"
+
 def generate_lua_wrapper(func: FunctionSignature) -> str:
     """Generate a Lua wrapper function for the given C++ function."""
 
@@ -317,6 +329,21 @@ def generate_lua_wrapper(func: FunctionSignature) -> str:
 {return_stmt}
 }}
 
+"""
+
+    if func.awaitable:
+        # Check for a coroutine before starting the operation
+        await_name = await_function_name(func)
+        wrapper += f"""static int lua_{await_name}(lua_State* L) {{
+    RequireLuaCoroutine(L, "{await_name}");
+"""
+        if param_checks:
+            wrapper += "\n".join(param_checks) + "\n"
+        wrapper += f"""
+    auto result = {base_call};
+    return AwaitOperation(L, result);
+}}
+
 """
 
     return wrapper
@@ -333,6 +360,9 @@ def generate_lua_module_registration(functions: List[FunctionSignature], module_
                 break
         if not skip_func:
             reg_entries.append(f'    {{"{func.name}", lua_{func.name}}},')
+            if func.awaitable:
+                await_name = await_function_name(func)
+                reg_entries.append(f'    {{"{await_name}", lua_{await_name}}},')
 
     registration = f"""static const luaL_Reg {module_name}_functions[] = {{
 {chr(10).join(reg_entries)}
@@ -343,6 +373,7 @@ def generate_lua_module_registration(functions: List[FunctionSignature], module_
 __declspec(dllexport)
 #endif
 int luaopen_{module_name}(lua_State* L) {{
+    SetLuaState(L);
     luaL_register(L, "{module_name}", {module_name}_functions);
     return 1;
 }}
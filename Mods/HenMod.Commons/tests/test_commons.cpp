@@ -1,5 +1,15 @@
 #include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include "x4_script_base.h"
+#include "mpsc_queue.h"
+#include "coro_task.h"
 
 TEST_CASE("X4ScriptBase basic functionality", "[commons]") {
     // Test basic instantiation
@@ -12,4 +22,258 @@ TEST_CASE("X4ScriptBase basic functionality", "[commons]") {
     TestScript script;
     REQUIRE(script.GetScriptName() == "TestScript");
     REQUIRE(!script.IsInitialized());
-}
\ No newline at end of file
+}
+
+TEST_CASE("MpscQueue keeps each producer's items in order", "[commons]") {
+    MpscQueue<int> queue;
+    int value = 0;
+    REQUIRE(queue.Empty());
+    REQUIRE_FALSE(queue.TryPop(value));
+
+    constexpr int PRODUCERS = 4;
+    constexpr int ITEMS = 10000;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < ITEMS; ++i) {
+                queue.Push(p * ITEMS + i);
+            }
+        });
+    }
+
+    // Consume concurrently with the producers
+    std::vector<int> next(PRODUCERS, 0);
+    int popped = 0;
+    bool ordered = true;
+    while (popped < PRODUCERS * ITEMS) {
+        if (!queue.TryPop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int producer = value / ITEMS;
+        ordered = ordered && value % ITEMS == next[producer];
+        next[producer] = value % ITEMS + 1;
+        ++popped;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    REQUIRE(ordered);
+    REQUIRE(queue.Empty());
+}
+
+TEST_CASE("MpscQueue releases unconsumed items", "[commons]") {
+    auto tracked = std::make_shared<int>(0);
+    {
+        MpscQueue<std::shared_ptr<int>> queue;
+        queue.Push(tracked);
+        queue.Push(tracked);
+        REQUIRE(tracked.use_count() == 3);
+    }
+    REQUIRE(tracked.use_count() == 1);
+}
+
+namespace {
+// Runs posted work and due timers on the test thread
+class ManualScheduler : public TaskScheduler {
+public:
+    void Post(std::function<void()> work) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_work.push_back(std::move(work));
+    }
+
+    void PostAt(Clock::time_point when, std::function<void()> work) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_timers.emplace_back(when, std::move(work));
+    }
+
+    template <typename T>
+    bool RunUntilReady(std::future<T>& future, std::chrono::milliseconds limit = std::chrono::milliseconds(2000)) {
+        const auto deadline = Clock::now() + limit;
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (Clock::now() > deadline) {
+                return false;
+            }
+            if (RunOnce() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        return true;
+    }
+
+    size_t RunOnce() {
+        std::vector<std::function<void()>> due;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            due.swap(m_work);
+            const auto now = Clock::now();
+            for (auto it = m_timers.begin(); it != m_timers.end();) {
+                if (it->first <= now) {
+                    due.push_back(std::move(it->second));
+                    it = m_timers.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& work : due) {
+            work();
+        }
+        return due.size();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::function<void()>> m_work;
+    std::vector<std::pair<Clock::time_point, std::function<void()>>> m_timers;
+};
+
+// Stand-in for an SDK call that reports through a callback pair
+struct FakeError {
+    std::string message;
+};
+
+auto ToException = [](const FakeError& error) {
+    return std::make_exception_ptr(std::runtime_error(error.message));
+};
+
+Task<int> Resolve(std::function<void(std::function<void(int)>, std::function<void(const FakeError&)>)> call) {
+    co_return co_await FromCallbacks<int>(
+        [call](auto onSuccess, auto onError) { call(onSuccess, onError); }, ToException);
+}
+
+Task<int> ResolveTwice(std::function<void(std::function<void(int)>, std::function<void(const FakeError&)>)> call) {
+    const int first = co_await Resolve(call);
+    const int second = co_await Resolve(call);
+    co_return first + second;
+}
+}
+
+TEST_CASE("Task chains callback results across threads", "[commons]") {
+    ManualScheduler scheduler;
+    const auto schedulerThread = std::this_thread::get_id();
+    bool resumedOnScheduler = true;
+    std::vector<std::thread> network;
+
+    auto call = [&network](std::function<void(int)> onSuccess, std::function<void(const FakeError&)>) {
+        network.emplace_back([onSuccess]() { onSuccess(20); });
+    };
+    auto task = [&]() -> Task<int> {
+        const int value = co_await ResolveTwice(call);
+        resumedOnScheduler = std::this_thread::get_id() == schedulerThread;
+        co_return value + 2;
+    };
+
+    auto future = Spawn(scheduler, task());
+    REQUIRE(scheduler.RunUntilReady(future));
+    REQUIRE(future.get() == 42);
+    REQUIRE(resumedOnScheduler);
+    for (auto& thread : network) {
+        thread.join();
+    }
+}
+
+TEST_CASE("Task surfaces callback errors as exceptions", "[commons]") {
+    ManualScheduler scheduler;
+    auto future = Spawn(scheduler, Resolve([](auto, auto onError) { onError(FakeError{ "rejected" }); }));
+    REQUIRE(scheduler.RunUntilReady(future));
+    REQUIRE_THROWS_WITH(future.get(), "rejected");
+
+    std::string error;
+    Spawn<int>(scheduler, Resolve([](auto, auto) { throw std::runtime_error("not connected"); }),
+        [&error](std::future<int> result) {
+            try {
+                result.get();
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+        });
+    scheduler.RunOnce();
+    scheduler.RunOnce();
+    REQUIRE(error == "not connected");
+}
+
+TEST_CASE("Task cancellation resumes pending awaits and ignores late results", "[commons]") {
+    ManualScheduler scheduler;
+    std::function<void(int)> complete;
+    CancellationSource source;
+    auto future = Spawn(scheduler, Resolve([&complete](auto onSuccess, auto) { complete = onSuccess; }), source.Token());
+
+    scheduler.RunOnce();
+    REQUIRE(complete);
+    source.Cancel();
+    REQUIRE(scheduler.RunUntilReady(future));
+    REQUIRE_THROWS_AS(future.get(), TaskCancelled);
+    complete(1); // Late completion is dropped
+    REQUIRE(scheduler.RunOnce() == 0);
+
+    // Already cancelled: the request is never issued
+    bool issued = false;
+    auto skipped = Spawn(scheduler, Resolve([&issued](auto, auto) { issued = true; }), source.Token());
+    REQUIRE(scheduler.RunUntilReady(skipped));
+    REQUIRE_THROWS_AS(skipped.get(), TaskCancelled);
+    REQUIRE_FALSE(issued);
+}
+
+TEST_CASE("Task deadlines time out stalled steps", "[commons]") {
+    using namespace std::chrono_literals;
+    ManualScheduler scheduler;
+    CancellationSource source;
+    auto stalled = [&]() -> Task<int> {
+        co_return co_await WithTimeout(FromCallbacks<int>([](auto, auto) {}, ToException), 20ms);
+    };
+
+    const auto start = TaskScheduler::Clock::now();
+    auto future = Spawn(scheduler, stalled(), source.Token());
+    REQUIRE(scheduler.RunUntilReady(future));
+    REQUIRE_THROWS_AS(future.get(), TaskTimeout);
+    REQUIRE(TaskScheduler::Clock::now() - start >= 20ms);
+
+    // A step that finishes in time is unaffected, and so is the caller's token
+    auto quick = [&]() -> Task<int> {
+        co_return co_await WithTimeout(Resolve([](auto onSuccess, auto) { onSuccess(7); }), 1s);
+    };
+    auto done = Spawn(scheduler, quick(), source.Token());
+    REQUIRE(scheduler.RunUntilReady(done));
+    REQUIRE(done.get() == 7);
+    REQUIRE_FALSE(source.IsCancelled());
+}
+
+TEST_CASE("Task awaits std::future and delays without blocking", "[commons]") {
+    using namespace std::chrono_literals;
+    ManualScheduler scheduler;
+    std::promise<std::string> response;
+    auto task = [&]() -> Task<std::string> {
+        co_await Delay(5ms);
+        co_return co_await FromFuture(response.get_future(), 1ms);
+    };
+
+    auto future = Spawn(scheduler, task());
+    REQUIRE_FALSE(scheduler.RunUntilReady(future, 30ms));
+    response.set_value("match-1");
+    REQUIRE(scheduler.RunUntilReady(future));
+    REQUIRE(future.get() == "match-1");
+}
+
+TEST_CASE("CancellationSource follows its parent", "[commons]") {
+    CancellationSource parent;
+    int notified = 0;
+    {
+        CancellationSource child(parent.Token());
+        child.Token().Register([&notified]() { ++notified; });
+        parent.Cancel();
+        REQUIRE(child.IsCancelled());
+        REQUIRE(notified == 1);
+    }
+
+    // Children that go away unregister from a parent that lives on
+    CancellationSource longLived;
+    for (int i = 0; i < 3; ++i) {
+        CancellationSource child(longLived.Token());
+    }
+    REQUIRE(longLived.Cancel());
+    REQUIRE_FALSE(longLived.Cancel());
+}
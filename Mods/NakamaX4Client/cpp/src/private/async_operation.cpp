@@ -0,0 +1,186 @@
+#include "../public/async_operation.h"
+#include <algorithm>
+#include <vector>
+
+int AsyncOperationTable::Begin(const std::string& kind, Clock::time_point deadline, std::function<void()> onCancel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int handle = m_nextHandle++;
+    Operation& operation = m_operations[handle];
+    operation.kind = kind;
+    operation.status.state = AsyncOperationState::Running;
+    operation.deadline = deadline;
+    operation.onCancel = std::move(onCancel);
+    return handle;
+}
+
+void AsyncOperationTable::SetProgress(int handle, float progress) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_operations.find(handle);
+    if (it != m_operations.end() && it->second.status.state == AsyncOperationState::Running) {
+        it->second.status.progress = std::clamp(progress, 0.0f, 1.0f);
+    }
+}
+
+bool AsyncOperationTable::Complete(int handle, bool success, const std::string& error,
+    const std::function<void()>& commit) {
+    AsyncOperationStatus status;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_operations.find(handle);
+        if (it == m_operations.end() || it->second.status.state != AsyncOperationState::Running) {
+            return false;
+        }
+        if (commit) {
+            commit();
+        }
+        FinishLocked(it->second, success ? AsyncOperationState::Succeeded : AsyncOperationState::Failed, error);
+        status = it->second.status;
+        PruneLocked();
+    }
+    Notify(handle, status);
+    return true;
+}
+
+bool AsyncOperationTable::Cancel(int handle) {
+    std::function<void()> onCancel;
+    AsyncOperationStatus status;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_operations.find(handle);
+        if (it == m_operations.end() || it->second.status.state != AsyncOperationState::Running) {
+            return false;
+        }
+        FinishLocked(it->second, AsyncOperationState::Cancelled, "cancelled");
+        onCancel = std::move(it->second.onCancel);
+        status = it->second.status;
+        PruneLocked();
+    }
+    if (onCancel) {
+        onCancel();
+    }
+    Notify(handle, status);
+    return true;
+}
+
+AsyncOperationTable::Clock::time_point AsyncOperationTable::ExpireOverdue(Clock::time_point now) {
+    std::vector<std::pair<int, AsyncOperationStatus>> expired;
+    std::vector<std::function<void()>> cleanups;
+    Clock::time_point next = Clock::time_point::max();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [handle, operation] : m_operations) {
+            if (operation.status.state != AsyncOperationState::Running) {
+                continue;
+            }
+            if (operation.deadline > now) {
+                next = std::min(next, operation.deadline);
+                continue;
+            }
+            FinishLocked(operation, AsyncOperationState::Failed, operation.kind + " timeout");
+            if (operation.onCancel) {
+                cleanups.push_back(std::move(operation.onCancel));
+            }
+            expired.emplace_back(handle, operation.status);
+        }
+        PruneLocked();
+    }
+    for (auto& cleanup : cleanups) {
+        cleanup();
+    }
+    for (const auto& [handle, status] : expired) {
+        Notify(handle, status);
+    }
+    return next;
+}
+
+void AsyncOperationTable::Release(int handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_operations.find(handle);
+    if (it != m_operations.end() && it->second.status.IsFinished()) {
+        m_operations.erase(it);
+    }
+}
+
+void AsyncOperationTable::CancelAll() {
+    std::vector<int> running;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& [handle, operation] : m_operations) {
+            if (operation.status.state == AsyncOperationState::Running) {
+                running.push_back(handle);
+            }
+        }
+    }
+    for (int handle : running) {
+        Cancel(handle);
+    }
+}
+
+AsyncOperationStatus AsyncOperationTable::Get(int handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_operations.find(handle);
+    return it == m_operations.end() ? AsyncOperationStatus{} : it->second.status;
+}
+
+size_t AsyncOperationTable::RunningCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<size_t>(std::count_if(m_operations.begin(), m_operations.end(),
+        [](const auto& entry) { return entry.second.status.state == AsyncOperationState::Running; }));
+}
+
+void AsyncOperationTable::SetCompletionObserver(CompletionObserver observer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_observer = std::move(observer);
+}
+
+const char* AsyncOperationTable::StateName(AsyncOperationState state) {
+    switch (state) {
+    case AsyncOperationState::Running:
+        return "running";
+    case AsyncOperationState::Succeeded:
+        return "succeeded";
+    case AsyncOperationState::Failed:
+        return "failed";
+    case AsyncOperationState::Cancelled:
+        return "cancelled";
+    default:
+        return "unknown";
+    }
+}
+
+void AsyncOperationTable::FinishLocked(Operation& operation, AsyncOperationState state, const std::string& error) {
+    operation.status.state = state;
+    operation.status.error = error;
+    if (state == AsyncOperationState::Succeeded) {
+        operation.status.progress = 1.0f;
+    }
+    operation.finishedOrder = ++m_finishedCount;
+}
+
+// Drops the oldest finished operations nobody released
+void AsyncOperationTable::PruneLocked() {
+    std::vector<std::pair<std::uint64_t, int>> finished;
+    for (const auto& [handle, operation] : m_operations) {
+        if (operation.status.IsFinished()) {
+            finished.emplace_back(operation.finishedOrder, handle);
+        }
+    }
+    if (finished.size() <= MAX_FINISHED) {
+        return;
+    }
+    std::sort(finished.begin(), finished.end());
+    for (size_t i = 0; i < finished.size() - MAX_FINISHED; ++i) {
+        m_operations.erase(finished[i].second);
+    }
+}
+
+void AsyncOperationTable::Notify(int handle, const AsyncOperationStatus& status) {
+    CompletionObserver observer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        observer = m_observer;
+    }
+    if (observer) {
+        observer(handle, status);
+    }
+}
@@ -0,0 +1,81 @@
+#include "../public/fleet_formation.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace FleetFormation {
+
+using Matrix3 = std::array<std::array<float, 3>, 3>;
+
+// Leader local -> world rotation, R = Ry(yaw) * Rx(pitch) * Rz(roll)
+static Matrix3 BuildRotation(const std::vector<float>& rotation) {
+    const float pitch = rotation.size() > 0 ? rotation[0] : 0.0f;
+    const float yaw = rotation.size() > 1 ? rotation[1] : 0.0f;
+    const float roll = rotation.size() > 2 ? rotation[2] : 0.0f;
+
+    const float cp = std::cos(pitch), sp = std::sin(pitch);
+    const float cy = std::cos(yaw), sy = std::sin(yaw);
+    const float cr = std::cos(roll), sr = std::sin(roll);
+
+    return { {
+        { cy * cr + sy * sp * sr, -cy * sr + sy * sp * cr, sy * cp },
+        { cp * sr, cp * cr, -sp },
+        { -sy * cr + cy * sp * sr, sy * sr + cy * sp * cr, cy * cp },
+    } };
+}
+
+static float Component(const std::vector<float>& v, size_t i) {
+    return i < v.size() ? v[i] : 0.0f;
+}
+
+std::vector<float> WorldToLocal(const std::vector<float>& worldOffset,
+    const std::vector<float>& rotation) {
+    const Matrix3 r = BuildRotation(rotation);
+    std::vector<float> local(3, 0.0f);
+    // Inverse of a rotation is its transpose
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            local[i] += r[j][i] * Component(worldOffset, j);
+        }
+    }
+    return local;
+}
+
+std::vector<float> LocalToWorld(const std::vector<float>& localOffset,
+    const std::vector<float>& rotation) {
+    const Matrix3 r = BuildRotation(rotation);
+    std::vector<float> world(3, 0.0f);
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            world[i] += r[i][j] * Component(localOffset, j);
+        }
+    }
+    return world;
+}
+
+std::vector<std::int16_t> QuantizeOffset(const std::vector<float>& localOffset) {
+    constexpr float minValue = static_cast<float>(std::numeric_limits<std::int16_t>::min());
+    constexpr float maxValue = static_cast<float>(std::numeric_limits<std::int16_t>::max());
+
+    std::vector<std::int16_t> quantized(3, 0);
+    for (size_t i = 0; i < 3; ++i) {
+        const float steps = std::round(Component(localOffset, i) / OFFSET_QUANTUM_M);
+        quantized[i] = static_cast<std::int16_t>(std::clamp(steps, minValue, maxValue));
+    }
+    return quantized;
+}
+
+std::vector<float> DequantizeOffset(const std::vector<std::int16_t>& offset) {
+    std::vector<float> local(3, 0.0f);
+    for (size_t i = 0; i < 3 && i < offset.size(); ++i) {
+        local[i] = static_cast<float>(offset[i]) * OFFSET_QUANTUM_M;
+    }
+    return local;
+}
+
+std::string MemberKey(const std::string& playerId, const std::string& shipId) {
+    return playerId + "/" + shipId;
+}
+
+} // namespace FleetFormation
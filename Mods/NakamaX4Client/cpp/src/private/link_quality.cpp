@@ -0,0 +1,95 @@
+#include "../public/link_quality.h"
+#include <algorithm>
+#include <cmath>
+
+// Upper bound on the jitter margin added to the interpolation delay
+constexpr float MAX_JITTER_MARGIN_MS = 400.0f;
+
+LinkQualityEstimator::LinkQualityEstimator(std::chrono::milliseconds lossTimeout)
+    : m_lossTimeout(lossTimeout) {}
+
+std::uint32_t LinkQualityEstimator::OnPingSent(Clock::time_point now) {
+    Expire(now);
+
+    // Reuses the slot of the probe sent WINDOW pings ago
+    const std::uint32_t sequence = m_nextSequence++;
+    m_probes[sequence % WINDOW] = { sequence, now, 0.0, ProbeState::Pending };
+    return sequence;
+}
+
+bool LinkQualityEstimator::OnPong(std::uint32_t sequence, Clock::time_point now) {
+    Probe& probe = m_probes[sequence % WINDOW];
+    if (probe.sequence != sequence || probe.state != ProbeState::Pending) {
+        return false;
+    }
+    if (now - probe.sentAt > m_lossTimeout) {
+        probe.state = ProbeState::Lost;
+        return false;
+    }
+    probe.state = ProbeState::Acked;
+
+    const double rttMs = std::chrono::duration<double, std::milli>(now - probe.sentAt).count();
+    probe.rttMs = rttMs;
+    if (m_samples == 0) {
+        m_srttMs = rttMs;
+        m_rttVarMs = rttMs / 2.0;
+    }
+    else {
+        m_rttVarMs = 0.75 * m_rttVarMs + 0.25 * std::abs(m_srttMs - rttMs);
+        m_srttMs = 0.875 * m_srttMs + 0.125 * rttMs;
+    }
+    ++m_samples;
+    return true;
+}
+
+void LinkQualityEstimator::Expire(Clock::time_point now) {
+    for (auto& probe : m_probes) {
+        if (probe.state == ProbeState::Pending && now - probe.sentAt > m_lossTimeout) {
+            probe.state = ProbeState::Lost;
+        }
+    }
+}
+
+void LinkQualityEstimator::Reset() {
+    m_probes = {};
+    m_srttMs = 0.0;
+    m_rttVarMs = 0.0;
+    m_samples = 0;
+}
+
+double LinkQualityEstimator::LossRate() const {
+    size_t acked = 0;
+    size_t lost = 0;
+    for (const auto& probe : m_probes) {
+        acked += probe.state == ProbeState::Acked;
+        lost += probe.state == ProbeState::Lost;
+    }
+    return acked + lost == 0 ? 0.0 : static_cast<double>(lost) / static_cast<double>(acked + lost);
+}
+
+double LinkQualityEstimator::MinRttMs() const {
+    double minimum = 0.0;
+    bool found = false;
+    for (const auto& probe : m_probes) {
+        if (probe.state == ProbeState::Acked && (!found || probe.rttMs < minimum)) {
+            minimum = probe.rttMs;
+            found = true;
+        }
+    }
+    return minimum;
+}
+
+double LinkQualityEstimator::OldestPendingMs(Clock::time_point now) const {
+    double oldest = 0.0;
+    for (const auto& probe : m_probes) {
+        if (probe.state == ProbeState::Pending) {
+            oldest = std::max(oldest, std::chrono::duration<double, std::milli>(now - probe.sentAt).count());
+        }
+    }
+    return oldest;
+}
+
+float LinkQualityEstimator::JitterMarginMs() const {
+    // Two deviations of margin absorb most late snapshots
+    return std::min(MAX_JITTER_MARGIN_MS, static_cast<float>(2.0 * m_rttVarMs));
+}
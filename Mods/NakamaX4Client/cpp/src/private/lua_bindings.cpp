@@ -1,4 +1,57 @@
 #include "../public/lua_bindings.h"
+#include <map>
+#include <mutex>
 
 // Global Lua state for callbacks - shared across all generated modules
-lua_State *g_luaState = nullptr;
\ No newline at end of file
+lua_State *g_luaState = nullptr;
+
+namespace {
+
+// Coroutines suspended in AwaitOperation, by operation handle, anchored in
+// the registry until resumed
+std::mutex g_awaitMutex;
+std::map<int, int> g_awaitingThreads;
+std::once_flag g_awaitObserverInstalled;
+
+void ResumeAwaitingThread(int handle, const AsyncOperationStatus& status) {
+    int threadRef = LUA_NOREF;
+    {
+        std::lock_guard<std::mutex> lock(g_awaitMutex);
+        auto it = g_awaitingThreads.find(handle);
+        if (it == g_awaitingThreads.end()) {
+            return;
+        }
+        threadRef = it->second;
+        g_awaitingThreads.erase(it);
+    }
+    const bool success = status.state == AsyncOperationState::Succeeded;
+    LuaDispatchQueue::Instance().PostResume(threadRef, { success, status.error });
+    NakamaX4Client::GetInstance()->GetOperations().Release(handle);
+}
+
+}
+
+int AwaitOperation(lua_State* L, int handle) {
+    AsyncOperationTable& operations = NakamaX4Client::GetInstance()->GetOperations();
+    std::call_once(g_awaitObserverInstalled, [&operations]() {
+        operations.SetCompletionObserver(ResumeAwaitingThread);
+    });
+
+    AsyncOperationStatus status;
+    {
+        // Held across the check so a completion in between waits for the
+        // thread to be registered instead of missing it
+        std::lock_guard<std::mutex> lock(g_awaitMutex);
+        status = operations.Get(handle);
+        if (status.state == AsyncOperationState::Running) {
+            lua_pushthread(L);
+            g_awaitingThreads[handle] = luaL_ref(L, LUA_REGISTRYINDEX);
+            return lua_yield(L, 0);
+        }
+    }
+
+    operations.Release(handle);
+    lua_pushboolean(L, status.state == AsyncOperationState::Succeeded);
+    lua_pushstring(L, status.state == AsyncOperationState::Unknown ? "unknown operation" : status.error.c_str());
+    return 2;
+}
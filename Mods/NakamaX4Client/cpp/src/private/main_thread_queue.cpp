@@ -0,0 +1,57 @@
+#include "../public/main_thread_queue.h"
+#include <algorithm>
+
+void MainThreadQueue::Post(Work work) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back({ std::move(work), Clock::now() });
+    ++m_stats.posted;
+}
+
+size_t MainThreadQueue::Drain() {
+    const auto start = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_draining.swap(m_pending);
+    }
+
+    double totalLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+    std::uint64_t failures = 0;
+    for (auto& item : m_draining) {
+        const double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - item.postedAt).count();
+        totalLatencyMs += latencyMs;
+        maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+        // One bad event must not drop the rest of the frame's events
+        try {
+            item.work();
+        }
+        catch (...) {
+            ++failures;
+        }
+    }
+    const size_t count = m_draining.size();
+    m_draining.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.run += count;
+    m_stats.failures += failures;
+    m_stats.totalLatencyMs += totalLatencyMs;
+    m_stats.maxLatencyMs = std::max(m_stats.maxLatencyMs, maxLatencyMs);
+    m_stats.lastDrainMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return count;
+}
+
+void MainThreadQueue::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+}
+
+size_t MainThreadQueue::PendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+MainThreadQueueStats MainThreadQueue::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,106 @@
+#include "../public/match_handler_registry.h"
+
+double MatchOpCodeStats::DecodePercentileUs(double percentile) const {
+    std::uint64_t total = 0;
+    for (auto count : decodeHistogram) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+
+    const double target = total * (percentile / 100.0);
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < decodeHistogram.size(); ++i) {
+        seen += decodeHistogram[i];
+        if (seen >= target) {
+            return static_cast<double>(std::uint64_t(1) << i);
+        }
+    }
+    return static_cast<double>(std::uint64_t(1) << (decodeHistogram.size() - 1));
+}
+
+bool MatchHandlerRegistry::RegisterRaw(std::int64_t opCode, const std::string& name,
+    RawHandler handler) {
+    return Install(opCode, name, std::move(handler), true);
+}
+
+bool MatchHandlerRegistry::Install(std::int64_t opCode, const std::string& name,
+    RawHandler handler, bool timesWholeCall) {
+    if (!InRange(opCode) || !handler) {
+        return false;
+    }
+    Slot& slot = m_slots[static_cast<size_t>(opCode)];
+    slot.name = name;
+    slot.handler = std::move(handler);
+    slot.timesWholeCall = timesWholeCall;
+    return true;
+}
+
+void MatchHandlerRegistry::Unregister(std::int64_t opCode) {
+    if (InRange(opCode)) {
+        m_slots[static_cast<size_t>(opCode)].handler = nullptr;
+    }
+}
+
+bool MatchHandlerRegistry::IsRegistered(std::int64_t opCode) const {
+    return InRange(opCode) && static_cast<bool>(m_slots[static_cast<size_t>(opCode)].handler);
+}
+
+MatchHandlerRegistry::DispatchResult MatchHandlerRegistry::Dispatch(std::int64_t opCode,
+    const char* data, size_t size) {
+    if (!IsRegistered(opCode)) {
+        m_unknown.fetch_add(1, std::memory_order_relaxed);
+        return DispatchResult::Unknown;
+    }
+
+    Slot& slot = m_slots[static_cast<size_t>(opCode)];
+    slot.messages.fetch_add(1, std::memory_order_relaxed);
+    slot.bytes.fetch_add(size, std::memory_order_relaxed);
+
+    bool handled = false;
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        handled = slot.handler(data, size);
+    }
+    catch (...) {
+        slot.failures.fetch_add(1, std::memory_order_relaxed);
+        throw;
+    }
+    if (slot.timesWholeCall) {
+        RecordDecode(opCode, std::chrono::steady_clock::now() - start);
+    }
+
+    if (!handled) {
+        slot.failures.fetch_add(1, std::memory_order_relaxed);
+        return DispatchResult::Malformed;
+    }
+    return DispatchResult::Handled;
+}
+
+void MatchHandlerRegistry::RecordDecode(std::int64_t opCode,
+    std::chrono::steady_clock::duration elapsed) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    size_t bucket = 0;
+    while (bucket + 1 < MatchOpCodeStats::HISTOGRAM_BUCKETS &&
+        us >= (std::int64_t(1) << bucket)) {
+        ++bucket;
+    }
+    m_slots[static_cast<size_t>(opCode)].histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+MatchOpCodeStats MatchHandlerRegistry::GetStats(std::int64_t opCode) const {
+    MatchOpCodeStats stats;
+    if (!InRange(opCode)) {
+        return stats;
+    }
+    const Slot& slot = m_slots[static_cast<size_t>(opCode)];
+    stats.name = slot.name;
+    stats.messages = slot.messages.load(std::memory_order_relaxed);
+    stats.bytes = slot.bytes.load(std::memory_order_relaxed);
+    stats.failures = slot.failures.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < stats.decodeHistogram.size(); ++i) {
+        stats.decodeHistogram[i] = slot.histogram[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
@@ -0,0 +1,262 @@
+#include "../public/msgpack_reader.h"
+#include <cstring>
+
+bool MsgPackReader::Take(size_t n, const char*& out) {
+    if (m_failed || static_cast<size_t>(m_end - m_pos) < n) {
+        return Fail();
+    }
+    out = m_pos;
+    m_pos += n;
+    return true;
+}
+
+bool MsgPackReader::ReadBigEndian(size_t n, std::uint64_t& out) {
+    const char* bytes = nullptr;
+    if (!Take(n, bytes)) {
+        return false;
+    }
+    out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        out = (out << 8) | static_cast<std::uint8_t>(bytes[i]);
+    }
+    return true;
+}
+
+// Length prefix for the 8/16/32-bit forms of str, bin, array and map
+bool MsgPackReader::ReadLength(std::uint8_t tag, int tag8, std::uint8_t tag16,
+    std::uint8_t tag32, std::uint32_t& length) {
+    std::uint64_t value = 0;
+    if (tag == tag8 && ReadBigEndian(1, value)) {}
+    else if (tag == tag16 && ReadBigEndian(2, value)) {}
+    else if (tag == tag32 && ReadBigEndian(4, value)) {}
+    else {
+        return Fail();
+    }
+    length = static_cast<std::uint32_t>(value);
+    return true;
+}
+
+bool MsgPackReader::ReadArrayHeader(std::uint32_t& count) {
+    const char* tag = nullptr;
+    if (!Take(1, tag)) {
+        return false;
+    }
+    const auto t = static_cast<std::uint8_t>(*tag);
+    if ((t & 0xf0) == 0x90) {
+        count = t & 0x0f;
+        return true;
+    }
+    return ReadLength(t, -1, 0xdc, 0xdd, count);
+}
+
+bool MsgPackReader::ReadMapHeader(std::uint32_t& count) {
+    const char* tag = nullptr;
+    if (!Take(1, tag)) {
+        return false;
+    }
+    const auto t = static_cast<std::uint8_t>(*tag);
+    if ((t & 0xf0) == 0x80) {
+        count = t & 0x0f;
+        return true;
+    }
+    return ReadLength(t, -1, 0xde, 0xdf, count);
+}
+
+bool MsgPackReader::ReadString(std::string_view& out) {
+    const char* tag = nullptr;
+    if (!Take(1, tag)) {
+        return false;
+    }
+    const auto t = static_cast<std::uint8_t>(*tag);
+    std::uint32_t length = 0;
+    if ((t & 0xe0) == 0xa0) {
+        length = t & 0x1f;
+    }
+    else if (!ReadLength(t, 0xd9, 0xda, 0xdb, length)) {
+        return false;
+    }
+    const char* bytes = nullptr;
+    if (!Take(length, bytes)) {
+        return false;
+    }
+    out = std::string_view(bytes, length);
+    return true;
+}
+
+bool MsgPackReader::ReadInt(std::int64_t& out) {
+    const char* tag = nullptr;
+    if (!Take(1, tag)) {
+        return false;
+    }
+    const auto t = static_cast<std::uint8_t>(*tag);
+    if (t <= 0x7f) {
+        out = t;
+        return true;
+    }
+    if (t >= 0xe0) {
+        out = static_cast<std::int8_t>(t);
+        return true;
+    }
+
+    std::uint64_t raw = 0;
+    switch (t) {
+    case 0xcc: if (!ReadBigEndian(1, raw)) return false; out = static_cast<std::int64_t>(raw); return true;
+    case 0xcd: if (!ReadBigEndian(2, raw)) return false; out = static_cast<std::int64_t>(raw); return true;
+    case 0xce: if (!ReadBigEndian(4, raw)) return false; out = static_cast<std::int64_t>(raw); return true;
+    case 0xcf: if (!ReadBigEndian(8, raw)) return false; out = static_cast<std::int64_t>(raw); return true;
+    case 0xd0: if (!ReadBigEndian(1, raw)) return false; out = static_cast<std::int8_t>(raw); return true;
+    case 0xd1: if (!ReadBigEndian(2, raw)) return false; out = static_cast<std::int16_t>(raw); return true;
+    case 0xd2: if (!ReadBigEndian(4, raw)) return false; out = static_cast<std::int32_t>(raw); return true;
+    case 0xd3: if (!ReadBigEndian(8, raw)) return false; out = static_cast<std::int64_t>(raw); return true;
+    default: return Fail();
+    }
+}
+
+bool MsgPackReader::ReadBool(bool& out) {
+    const char* tag = nullptr;
+    if (!Take(1, tag)) {
+        return false;
+    }
+    const auto t = static_cast<std::uint8_t>(*tag);
+    if (t == 0xc2 || t == 0xc3) {
+        out = t == 0xc3;
+        return true;
+    }
+    return Fail();
+}
+
+bool MsgPackReader::ReadFloat(float& out) {
+    if (m_failed || m_pos == m_end) {
+        return Fail();
+    }
+    const auto t = static_cast<std::uint8_t>(*m_pos);
+    std::uint64_t raw = 0;
+    if (t == 0xca) {
+        ++m_pos;
+        if (!ReadBigEndian(4, raw)) {
+            return false;
+        }
+        const auto bits = static_cast<std::uint32_t>(raw);
+        std::memcpy(&out, &bits, sizeof(out));
+        return true;
+    }
+    if (t == 0xcb) {
+        ++m_pos;
+        if (!ReadBigEndian(8, raw)) {
+            return false;
+        }
+        double value = 0.0;
+        std::memcpy(&value, &raw, sizeof(value));
+        out = static_cast<float>(value);
+        return true;
+    }
+
+    std::int64_t value = 0;
+    if (!ReadInt(value)) {
+        return false;
+    }
+    out = static_cast<float>(value);
+    return true;
+}
+
+bool MsgPackReader::Skip() {
+    // Values still to skip; containers add their children
+    std::uint64_t remaining = 1;
+    while (remaining > 0) {
+        --remaining;
+        const char* tag = nullptr;
+        if (!Take(1, tag)) {
+            return false;
+        }
+        const auto t = static_cast<std::uint8_t>(*tag);
+        const char* ignored = nullptr;
+        std::uint32_t length = 0;
+
+        if (t <= 0x7f || t >= 0xe0 || t == 0xc0 || t == 0xc2 || t == 0xc3) {
+            continue; // fixint, nil, bool
+        }
+        if ((t & 0xf0) == 0x80) { remaining += 2u * (t & 0x0f); continue; }
+        if ((t & 0xf0) == 0x90) { remaining += t & 0x0f; continue; }
+        if ((t & 0xe0) == 0xa0) { if (!Take(t & 0x1f, ignored)) return false; continue; }
+
+        switch (t) {
+        case 0xcc: case 0xd0: if (!Take(1, ignored)) return false; break;
+        case 0xcd: case 0xd1: if (!Take(2, ignored)) return false; break;
+        case 0xca: case 0xce: case 0xd2: if (!Take(4, ignored)) return false; break;
+        case 0xcb: case 0xcf: case 0xd3: if (!Take(8, ignored)) return false; break;
+        case 0xd4: if (!Take(2, ignored)) return false; break;  // fixext 1
+        case 0xd5: if (!Take(3, ignored)) return false; break;  // fixext 2
+        case 0xd6: if (!Take(5, ignored)) return false; break;  // fixext 4
+        case 0xd7: if (!Take(9, ignored)) return false; break;  // fixext 8
+        case 0xd8: if (!Take(17, ignored)) return false; break; // fixext 16
+        case 0xc4: case 0xc5: case 0xc6: // bin
+            if (!ReadLength(t, 0xc4, 0xc5, 0xc6, length) || !Take(length, ignored)) return false;
+            break;
+        case 0xd9: case 0xda: case 0xdb: // str
+            if (!ReadLength(t, 0xd9, 0xda, 0xdb, length) || !Take(length, ignored)) return false;
+            break;
+        case 0xc7: case 0xc8: case 0xc9: // ext: length, then type byte
+            if (!ReadLength(t, 0xc7, 0xc8, 0xc9, length) || !Take(length + 1u, ignored)) return false;
+            break;
+        case 0xdc: case 0xdd:
+            if (!ReadLength(t, -1, 0xdc, 0xdd, length)) return false;
+            remaining += length;
+            break;
+        case 0xde: case 0xdf:
+            if (!ReadLength(t, -1, 0xde, 0xdf, length)) return false;
+            remaining += 2ull * length;
+            break;
+        default:
+            return Fail(); // 0xc1 is never used
+        }
+    }
+    return true;
+}
+
+bool MsgPackReader::ReadRaw(std::string_view& out) {
+    const char* start = m_pos;
+    if (!Skip()) {
+        return false;
+    }
+    out = std::string_view(start, static_cast<size_t>(m_pos - start));
+    return true;
+}
+
+namespace MatchDecode {
+
+bool ReadFloat3(MsgPackReader& reader, std::array<float, 3>& out) {
+    std::uint32_t count = 0;
+    if (!reader.ReadArrayHeader(count)) {
+        return false;
+    }
+    out = {};
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const bool ok = i < out.size() ? reader.ReadFloat(out[i]) : reader.Skip();
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReadPositionUpdate(MsgPackReader& reader, PositionUpdateView& out) {
+    std::uint32_t fields = 0;
+    if (!reader.ReadArrayHeader(fields) || fields < 4) {
+        return false;
+    }
+    if (!reader.ReadString(out.player_id) ||
+        !ReadFloat3(reader, out.position) ||
+        !ReadFloat3(reader, out.rotation) ||
+        !ReadFloat3(reader, out.velocity)) {
+        return false;
+    }
+    // Fields appended by newer senders
+    for (std::uint32_t i = 4; i < fields; ++i) {
+        if (!reader.Skip()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
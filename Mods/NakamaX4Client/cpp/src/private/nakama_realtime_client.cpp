@@ -1,23 +1,47 @@
 #include "../public/nakama_realtime_client.h"
+#include "../public/nakama_x4_client.h"
 #include "../public/log_to_x4.h"
 #include "../public/sector_match.h"
+#include "../public/match_opcodes.h"
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <msgpack.hpp>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <nlohmann/json.hpp>
 
+// Link probing
+constexpr auto PING_INTERVAL = std::chrono::seconds(1);
+// Network thread cadence when it cannot be woken by socket activity: the SDK
+// websocket transport, connects in flight, replication held back by budget
+constexpr auto SDK_TRANSPORT_POLL_INTERVAL = std::chrono::milliseconds(50);
+constexpr auto CONNECTING_POLL_INTERVAL = std::chrono::milliseconds(100);
+constexpr auto REPLICATION_POLL_INTERVAL = std::chrono::milliseconds(20);
+// Socket calls reuse the open connection; give up on it well before the
+// HTTP path would time out so a stalled socket only costs one wait
+constexpr auto SOCKET_RPC_TIMEOUT = std::chrono::seconds(3);
+// Past the HTTP transports' own request timeouts
+constexpr auto HTTP_RPC_TIMEOUT = std::chrono::seconds(35);
+constexpr auto MATCH_JOIN_TIMEOUT = std::chrono::seconds(5);
+// Resolve over either RPC path, then join
+constexpr auto MATCH_JOIN_FLOW_TIMEOUT = SOCKET_RPC_TIMEOUT + HTTP_RPC_TIMEOUT + MATCH_JOIN_TIMEOUT;
+
 NakamaRealtimeClient::NakamaRealtimeClient()
-    : X4ScriptSingleton("NakamaRealtimeClient"), m_connected(false) {
+    : X4ScriptSingleton("NakamaRealtimeClient"), m_connected(false),
+    m_state(RealtimeConnectionState::Disconnected), m_lastServerTick(-1) {
+    RegisterSectorHandlers();
 }
 
 NakamaRealtimeClient::~NakamaRealtimeClient() { Shutdown(); }
 
 bool NakamaRealtimeClient::Initialize(
     std::shared_ptr<Nakama::NSessionInterface> session,
-    std::shared_ptr<Nakama::NClientInterface> client, std::function<void(bool)> callback) {
+    std::shared_ptr<Nakama::NClientInterface> client, std::function<void(bool)> callback,
+    bool eventDrivenTransport) {
     if (IsInitialized()) {
         LogWarning("Realtime client already initialized");
         if (callback) callback(true);
@@ -30,19 +54,30 @@ bool NakamaRealtimeClient::Initialize(
         return false;
     }
 
-    m_session = session;
+    StoreSession(session);
     m_client = client;
 
     LogInfo("Initializing realtime client...");
 
     try {
-        m_rtClient = m_client->createRtClient();
+        if (eventDrivenTransport) {
+            auto transport = std::make_shared<PollWebsocketTransport>();
+            m_rtClient = m_client->createRtClient(transport);
+            std::lock_guard<std::mutex> lock(m_transportMutex);
+            m_transport = transport;
+        }
+        else {
+            m_rtClient = m_client->createRtClient();
+        }
 
         // Set listener for realtime events
         m_rtClient->setListener(this);
 
         // Connect asynchronously
-        auto connectFuture = m_rtClient->connectAsync(m_session, true);
+        m_state = RealtimeConnectionState::Connecting;
+        m_backoff.Reset();
+        m_disconnectedAt = std::chrono::steady_clock::now();
+        auto connectFuture = m_rtClient->connectAsync(session, true);
 
         SetInitialized(true);
         if (callback) callback(true);
@@ -63,32 +98,170 @@ void NakamaRealtimeClient::Shutdown() {
 
     LogInfo("Shutting down realtime client");
 
+    // Intentional disconnect: no reconnect
+    m_state = RealtimeConnectionState::Disconnected;
+    m_rejoinSector.clear();
     if (m_rtClient && m_connected) {
         m_rtClient->disconnect();
     }
 
     m_rtClient.reset();
-    m_session.reset();
+    {
+        std::lock_guard<std::mutex> lock(m_transportMutex);
+        m_transport.reset();
+    }
+    StoreSession(nullptr);
     m_client.reset();
-    m_currentMatchId.clear();
+    SetCurrentMatchId("");
     m_connected = false;
 
     SetInitialized(false);
     LogInfo("Realtime client shutdown complete");
 }
 
+void NakamaRealtimeClient::SetSession(std::shared_ptr<Nakama::NSessionInterface> session) {
+    if (IsInitialized() && session) {
+        StoreSession(std::move(session));
+    }
+}
+
+std::shared_ptr<Nakama::NSessionInterface> NakamaRealtimeClient::Session() const {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    return m_session;
+}
+
+void NakamaRealtimeClient::StoreSession(std::shared_ptr<Nakama::NSessionInterface> session) {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    m_userId = session ? session->getUserId() : std::string();
+    m_session = std::move(session);
+}
+
+bool NakamaRealtimeClient::IsSelf(std::string_view playerId) const {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    return playerId == m_userId;
+}
+
 void NakamaRealtimeClient::Update(float deltaTime) {
     // Call base class Update
     X4ScriptBase::Update(deltaTime);
 
-    // Tick the realtime client if connected
+    if (m_state == RealtimeConnectionState::WaitingToReconnect &&
+        std::chrono::steady_clock::now() >= m_nextReconnectAttempt) {
+        AttemptReconnect();
+    }
+
+    // Write everything queued during the frame, then tick the realtime client
     if (m_rtClient) {
+        SendPingIfDue();
+        AdaptToLink();
+        ScheduleReplication();
+        FlushOutbound();
         m_rtClient->tick();
     }
 }
 
+bool NakamaRealtimeClient::WaitForNetwork(std::chrono::milliseconds timeout) {
+    std::shared_ptr<PollWebsocketTransport> transport;
+    {
+        std::lock_guard<std::mutex> lock(m_transportMutex);
+        transport = m_transport;
+    }
+    if (!transport) {
+        return false;
+    }
+    transport->WaitForActivity(timeout);
+    return true;
+}
+
+void NakamaRealtimeClient::WakeNetwork() {
+    std::shared_ptr<PollWebsocketTransport> transport;
+    {
+        std::lock_guard<std::mutex> lock(m_transportMutex);
+        transport = m_transport;
+    }
+    if (transport) {
+        transport->Wake();
+    }
+}
+
+void NakamaRealtimeClient::SetNetworkWakeHandler(std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(m_transportMutex);
+    m_networkWakeHandler = std::move(handler);
+}
+
+void NakamaRealtimeClient::NotifyNetwork() {
+    std::function<void()> handler;
+    {
+        std::lock_guard<std::mutex> lock(m_transportMutex);
+        handler = m_networkWakeHandler;
+    }
+    if (handler) {
+        handler();
+    }
+}
+
+std::chrono::steady_clock::time_point NakamaRealtimeClient::NextNetworkDeadline(
+    std::chrono::steady_clock::time_point now) const {
+    if (!m_rtClient) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_transportMutex);
+        if (!m_transport) {
+            return now + SDK_TRANSPORT_POLL_INTERVAL;
+        }
+    }
+
+    switch (m_state.load()) {
+    case RealtimeConnectionState::WaitingToReconnect:
+        return m_nextReconnectAttempt;
+    case RealtimeConnectionState::Connecting:
+    case RealtimeConnectionState::Reconnecting:
+        return now + CONNECTING_POLL_INTERVAL;
+    default:
+        break;
+    }
+    if (!m_connected || !InMatch()) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+
+    // Queued sends go out right away; state the budget held back is retried
+    // once tokens have refilled
+    if (m_outbound.PendingCount() > 0) {
+        return now;
+    }
+    auto deadline = m_lastPingSent + PING_INTERVAL;
+    if (m_replication.GetStats(now).waiting > 0) {
+        deadline = std::min(deadline, now + REPLICATION_POLL_INTERVAL);
+    }
+    return deadline;
+}
+
 bool NakamaRealtimeClient::IsConnected() const { return m_connected; }
 
+bool NakamaRealtimeClient::IsReconnecting() const {
+    const auto state = m_state.load();
+    return state == RealtimeConnectionState::WaitingToReconnect ||
+        state == RealtimeConnectionState::Reconnecting;
+}
+
+std::string NakamaRealtimeClient::BuildMatchRequest(const std::string& sectorName) const {
+    // Crowded sectors are sharded; the position hint lets the server
+    // place us in the shard closest to where we are
+    nlohmann::json request = {{"sector", sectorName}};
+    // Lets the server answer a repeated request with the first result, which
+    // makes the call safe to retry over HTTP after a socket timeout
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    std::ostringstream requestKey;
+    requestKey << std::hex << rng() << rng();
+    request["request_key"] = requestKey.str();
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    if (sectorManager && sectorManager->GetPositionHint().size() == 3) {
+        request["position"] = sectorManager->GetPositionHint();
+    }
+    return request.dump();
+}
+
 bool NakamaRealtimeClient::JoinOrCreateMatch(const std::string& sectorName) {
     if (!IsInitialized() || !m_connected) {
         LogError("Realtime client not initialized or not connected");
@@ -98,24 +271,13 @@ bool NakamaRealtimeClient::JoinOrCreateMatch(const std::string& sectorName) {
     LogInfo("Looking for sector match: %s", sectorName.c_str());
 
     try {
-
-        std::future<Nakama::NRpc> matchResponseFuture = m_client->rpcAsync(
-            m_session,
-            "get_sector_match_id", 
-            "{\"sector\":\"" + sectorName + "\"}");
-        auto matchResponse = matchResponseFuture.get();
-        // Parse the response JSON to find existing matches
-        auto json = nlohmann::json::parse(matchResponse.payload);
-        std::string matchId = json.value("match_id", "");
-        if (!matchId.empty()) {
-            LogInfo("Joining match: %s", matchId.c_str());
-            auto joinFuture = m_rtClient->joinMatchAsync(matchId, {{"sector", sectorName}});
-            joinFuture.wait_for(std::chrono::seconds(5)); // Wait for join to complete
-            m_currentMatchId = matchId;
-            OnMatchJoined(matchId);
-            return true;
+        const SectorMatchJoin match = NakamaX4Client::GetInstance()->RunTask(
+            JoinSectorMatchAsync(sectorName, BuildMatchRequest(sectorName)), MATCH_JOIN_FLOW_TIMEOUT);
+        if (match.matchId.empty()) {
+            return false;
         }
-        return false;
+        ApplyMatchJoin(match);
+        return true;
     }
     catch (const std::exception& e) {
         LogError("Exception while joining/creating match for sector %s: %s", 
@@ -124,113 +286,799 @@ bool NakamaRealtimeClient::JoinOrCreateMatch(const std::string& sectorName) {
     }
 }
 
-void NakamaRealtimeClient::SendPosition(const std::string& data) {
-    if (!IsInitialized() || !m_connected || m_currentMatchId.empty()) {
-        LogWarning("Cannot send position: not connected or not in match");
+int NakamaRealtimeClient::JoinOrCreateMatchAsync(const std::string& sectorName) {
+    auto* owner = NakamaX4Client::GetInstance();
+    if (!IsInitialized() || !m_connected) {
+        LogError("Realtime client not initialized or not connected");
+        return owner->FailedOperation("join_match", "Realtime client not connected");
+    }
+
+    LogInfo("Looking for sector match: %s", sectorName.c_str());
+    const int handle = owner->GetOperations().Begin("join_match",
+        std::chrono::steady_clock::now() + MATCH_JOIN_FLOW_TIMEOUT);
+    owner->StartTask<SectorMatchJoin>(JoinSectorMatchAsync(sectorName, BuildMatchRequest(sectorName)),
+        [this, handle, sectorName](std::future<SectorMatchJoin> result) {
+            try {
+                const SectorMatchJoin match = result.get();
+                if (match.matchId.empty()) {
+                    throw std::runtime_error("no match for sector");
+                }
+                RunInbound([this, handle, sectorName, match]() { FinishMatchJoin(handle, sectorName, match); });
+            }
+            catch (const std::exception& e) {
+                LogError("Exception while joining/creating match for sector %s: %s",
+                    sectorName.c_str(), e.what());
+                NakamaX4Client::GetInstance()->GetOperations().Complete(handle, false, e.what());
+            }
+        });
+    return handle;
+}
+
+// Game side of JoinOrCreateMatchAsync. A join that is no longer wanted (the
+// player moved on, or the operation was cancelled or timed out) is left.
+void NakamaRealtimeClient::FinishMatchJoin(int handle, const std::string& sectorName, const SectorMatchJoin& match) {
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    AsyncOperationTable& operations = NakamaX4Client::GetInstance()->GetOperations();
+    const bool current = !sectorManager || sectorManager->GetCurrentSector() == sectorName;
+    if (current && operations.Complete(handle, true)) {
+        ApplyMatchJoin(match);
         return;
     }
 
+    operations.Complete(handle, false, "sector changed");
+    LogInfo("Leaving match %s joined for sector %s; no longer wanted",
+        match.matchId.c_str(), sectorName.c_str());
     try {
-        // Convert string data to NBytes
-        Nakama::NBytes dataBytes(data.begin(), data.end());
+        if (m_rtClient) {
+            m_rtClient->leaveMatch(match.matchId);
+        }
+    }
+    catch (const std::exception& e) {
+        LogError("Exception leaving match: %s", e.what());
+    }
+}
+
+Task<SectorMatchJoin> NakamaRealtimeClient::JoinSectorMatchAsync(std::string sectorName, std::string request) {
+    const Nakama::NRpc response = co_await CallRpcAsync("get_sector_match_id", request, true);
+    // Parse the response JSON to find existing matches
+    auto json = nlohmann::json::parse(response.payload);
+    SectorMatchJoin match;
+    match.matchId = json.value("match_id", "");
+    match.shard = json.value("shard", 0);
+    if (match.matchId.empty()) {
+        co_return match;
+    }
 
-        m_rtClient->sendMatchData(m_currentMatchId, 1, dataBytes);
-        LogInfo("Position data sent to match %s", m_currentMatchId.c_str());
+    LogInfo("Joining match: %s (shard %d)", match.matchId.c_str(), match.shard);
+    auto rtClient = m_rtClient;
+    if (!rtClient) {
+        throw std::runtime_error("realtime client shut down");
+    }
+    co_await WithTimeout(NakamaCall<Nakama::NMatch>([rtClient, matchId = match.matchId, sectorName](auto onSuccess, auto onError) {
+        rtClient->joinMatch(matchId, {{"sector", sectorName}}, onSuccess, onError);
+    }), MATCH_JOIN_TIMEOUT);
+    co_return match;
+}
+
+void NakamaRealtimeClient::ApplyMatchJoin(const SectorMatchJoin& match) {
+    SetCurrentMatchId(match.matchId);
+    OnMatchJoined(match.matchId);
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    if (sectorManager) {
+        sectorManager->OnShardJoined(match.shard);
+    }
+}
+
+Nakama::NRpc NakamaRealtimeClient::CallRpc(const std::string& id, const std::string& payload, bool idempotent) {
+    return NakamaX4Client::GetInstance()->RunTask(CallRpcAsync(id, payload, idempotent),
+        SOCKET_RPC_TIMEOUT + HTTP_RPC_TIMEOUT);
+}
+
+Task<Nakama::NRpc> NakamaRealtimeClient::CallRpcAsync(std::string id, std::string payload, bool idempotent) {
+    auto rtClient = m_rtClient;
+    if (rtClient && m_connected) {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            auto response = co_await WithTimeout(NakamaCall<Nakama::NRpc>([rtClient, id, payload](auto onSuccess, auto onError) {
+                rtClient->rpc(id, payload, onSuccess, onError);
+            }), SOCKET_RPC_TIMEOUT);
+            RecordRpc(m_socketRpcStats, start, true);
+            co_return response;
+        }
+        catch (const TaskCancelled&) {
+            RecordRpc(m_socketRpcStats, start, false);
+            throw;
+        }
+        catch (const TaskTimeout&) {
+            RecordRpc(m_socketRpcStats, start, false);
+            if (!idempotent) {
+                throw std::runtime_error("RPC " + id + " timed out");
+            }
+            LogWarning("Socket RPC %s timed out, retrying over HTTP", id.c_str());
+        }
+        catch (const std::exception& e) {
+            RecordRpc(m_socketRpcStats, start, false);
+            if (!idempotent) {
+                throw;
+            }
+            LogWarning("Socket RPC %s failed, retrying over HTTP: %s", id.c_str(), e.what());
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto client = m_client;
+    auto session = Session();
+    try {
+        auto response = co_await WithTimeout(NakamaCall<Nakama::NRpc>([client, session, id, payload](auto onSuccess, auto onError) {
+            client->rpc(session, id, payload, onSuccess, onError);
+        }), HTTP_RPC_TIMEOUT);
+        RecordRpc(m_httpRpcStats, start, true);
+        co_return response;
+    }
+    catch (const TaskTimeout&) {
+        RecordRpc(m_httpRpcStats, start, false);
+        throw std::runtime_error("RPC " + id + " timed out");
+    }
+    catch (...) {
+        RecordRpc(m_httpRpcStats, start, false);
+        throw;
+    }
+}
+
+void NakamaRealtimeClient::RecordRpc(LatencyStats& stats,
+    std::chrono::steady_clock::time_point start, bool success) {
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(m_rpcStatsMutex);
+    if (success) {
+        stats.Record(ms);
+    }
+    else {
+        ++stats.failures;
+    }
+}
+
+LatencyStats NakamaRealtimeClient::GetRpcStats(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(m_rpcStatsMutex);
+    if (path == "socket") {
+        return m_socketRpcStats;
+    }
+    if (path == "http") {
+        return m_httpRpcStats;
+    }
+    return {};
+}
+
+float NakamaRealtimeClient::GetRpcAverageLatencyMs(const std::string& path) const {
+    return static_cast<float>(GetRpcStats(path).AverageMs());
+}
+
+int NakamaRealtimeClient::GetRpcCallCount(const std::string& path) const {
+    return static_cast<int>(GetRpcStats(path).calls);
+}
+
+void NakamaRealtimeClient::SendPosition(const std::string& data) {
+    SendMatchData(MatchOpCode::Position, data);
+}
+
+void NakamaRealtimeClient::SendMatchData(std::int64_t opCode, const std::string& data, bool replaceable) {
+    if (!IsInitialized() || !m_connected || !InMatch()) {
+        LogWarning("Cannot send match data: not connected or not in match");
+        return;
+    }
+
+    m_outbound.Enqueue(opCode, data, replaceable);
+    NotifyNetwork();
+}
+
+void NakamaRealtimeClient::FlushOutbound() {
+    const std::string matchId = CurrentMatchId();
+    if (!m_connected || matchId.empty()) {
+        return;
+    }
+
+    try {
+        // NBytes is a std::string, so pooled payloads are passed through as-is
+        m_outbound.Flush([this, &matchId](std::int64_t opCode, const std::string& payload) {
+            m_rtClient->sendMatchData(matchId, opCode, payload);
+        });
     }
     catch (const std::exception& e) {
-        LogError("Exception sending position: %s", e.what());
+        LogError("Exception sending match data: %s", e.what());
+    }
+}
+
+void NakamaRealtimeClient::Replicate(const std::string& entityId, std::int64_t opCode,
+    const std::string& data, const ReplicationHints& hints) {
+    if (!IsInitialized() || !m_connected || !InMatch()) {
+        return;
+    }
+    m_replication.Submit(entityId, opCode, data, hints);
+    NotifyNetwork();
+}
+
+void NakamaRealtimeClient::StopReplicating(const std::string& entityId) {
+    m_replication.Remove(entityId);
+}
+
+// Move what fits in this tick's budget into the outbound queue. Several
+// entities share an opcode, so these messages must not merge there.
+void NakamaRealtimeClient::ScheduleReplication() {
+    if (!m_connected || !InMatch()) {
+        return;
     }
+    m_replication.Tick(std::chrono::steady_clock::now(), [this](std::int64_t opCode, std::string_view payload) {
+        m_outbound.Enqueue(opCode, payload, false);
+    });
+}
+
+void NakamaRealtimeClient::SetReplicationBudget(int bytesPerSecond) {
+    m_replication.SetBudgetBytesPerSecond(static_cast<size_t>(std::max(0, bytesPerSecond)));
+}
+
+int NakamaRealtimeClient::GetReplicationBudget() const {
+    return static_cast<int>(m_replication.GetBudgetBytesPerSecond());
+}
+
+float NakamaRealtimeClient::GetReplicationStarvationMs() const {
+    return static_cast<float>(m_replication.GetStats().maxWaitMs);
+}
+
+int NakamaRealtimeClient::GetDeferredReplicationCount() const {
+    return static_cast<int>(m_replication.GetStats().deferred);
+}
+
+ReplicationStats NakamaRealtimeClient::GetReplicationStats() const {
+    return m_replication.GetStats();
+}
+
+OpCodeCounters NakamaRealtimeClient::GetOutboundCounters(std::int64_t opCode) const {
+    return m_outbound.GetCounters(opCode);
+}
+
+int NakamaRealtimeClient::GetSentMessageCount(int opCode) const {
+    return static_cast<int>(m_outbound.GetCounters(opCode).sent);
+}
+
+int NakamaRealtimeClient::GetSentBytes(int opCode) const {
+    return static_cast<int>(m_outbound.GetCounters(opCode).bytes);
 }
 
 void NakamaRealtimeClient::LeaveMatch() {
-    if (!IsInitialized() || !m_connected || m_currentMatchId.empty()) {
+    const std::string matchId = CurrentMatchId();
+    if (!IsInitialized() || !m_connected || matchId.empty()) {
         LogWarning("Cannot leave match: not connected or not in match");
         return;
     }
 
     try {
-        LogInfo("Leaving match: %s", m_currentMatchId.c_str());
+        LogInfo("Leaving match: %s", matchId.c_str());
 
-        m_rtClient->leaveMatch(m_currentMatchId);
+        m_rtClient->leaveMatch(matchId);
+        m_outbound.Clear();
+        m_replication.Clear();
         OnMatchLeft();
-        m_currentMatchId.clear();
+        SetCurrentMatchId("");
     }
     catch (const std::exception& e) {
         LogError("Exception leaving match: %s", e.what());
     }
 }
 
+std::string NakamaRealtimeClient::CurrentMatchId() const {
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    return m_currentMatchId;
+}
+
+bool NakamaRealtimeClient::InMatch() const {
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    return !m_currentMatchId.empty();
+}
+
+void NakamaRealtimeClient::SetCurrentMatchId(std::string matchId) {
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    m_currentMatchId = std::move(matchId);
+}
+
 void NakamaRealtimeClient::OnRealtimeConnected() {
     LogInfo("Realtime connection established");
 }
 
 void NakamaRealtimeClient::OnRealtimeDisconnected() {
     LogInfo("Realtime connection lost");
-    m_currentMatchId.clear();
+    SetCurrentMatchId("");
 }
 
 // NRtClientListenerInterface implementations
 void NakamaRealtimeClient::onConnect() {
     LogInfo("Realtime client connected");
     m_connected = true;
+    const bool recovering = m_state == RealtimeConnectionState::Reconnecting;
+    m_state = RealtimeConnectionState::Connected;
+    m_backoff.Reset();
     OnRealtimeConnected();
+
+    if (recovering) {
+        if (m_rejoinSector.empty()) {
+            RecordRecovery();
+        }
+        else {
+            RejoinSector();
+        }
+    }
 }
 
 void NakamaRealtimeClient::onDisconnect(
     const Nakama::NRtClientDisconnectInfo& info) {
     LogInfo("Realtime client disconnected: %s", info.reason.c_str());
-    m_connected = false;
+    const bool wasConnected = m_connected.exchange(false);
+    const auto state = m_state.load();
+
+    if (state == RealtimeConnectionState::Disconnected) {
+        // Shutdown in progress
+        OnRealtimeDisconnected();
+        return;
+    }
+
+    if (wasConnected && state == RealtimeConnectionState::Connected && m_rejoinSector.empty()) {
+        // Fresh outage (not one interrupting a rejoin): remember where we
+        // were before the match ID is cleared
+        m_disconnectedAt = std::chrono::steady_clock::now();
+        auto* sectorManager = SectorMatchManager::GetInstance();
+        m_rejoinSector = (sectorManager && InMatch())
+            ? sectorManager->GetCurrentSector() : std::string();
+    }
     OnRealtimeDisconnected();
+    ScheduleReconnect();
 }
 
 void NakamaRealtimeClient::onError(const Nakama::NRtError& error) {
     LogError("Realtime client error: %s", error.message.c_str());
+    // A failed connect attempt, the first one included, may only report an
+    // error; retry it with backoff like a dropped connection
+    const auto state = m_state.load();
+    if (!m_connected && (state == RealtimeConnectionState::Connecting ||
+        state == RealtimeConnectionState::Reconnecting)) {
+        ScheduleReconnect();
+    }
+}
+
+void NakamaRealtimeClient::ScheduleReconnect() {
+    if (m_state == RealtimeConnectionState::WaitingToReconnect) {
+        return;
+    }
+    const auto delay = m_backoff.NextDelay();
+    m_nextReconnectAttempt = std::chrono::steady_clock::now() + delay;
+    m_state = RealtimeConnectionState::WaitingToReconnect;
+    LogInfo("Reconnecting in %lld ms (attempt %d)",
+        static_cast<long long>(delay.count()), m_backoff.Attempts());
+}
+
+void NakamaRealtimeClient::AttemptReconnect() {
+    m_state = RealtimeConnectionState::Reconnecting;
+
+    const auto session = Session();
+    if (!session || !session->isExpired()) {
+        ConnectSocket();
+        return;
+    }
+
+    if (session->isRefreshExpired()) {
+        // Only a full authentication from the game can recover from this
+        LogError("Session and refresh token expired; authenticate again to reconnect");
+        m_state = RealtimeConnectionState::Disconnected;
+        m_rejoinSector.clear();
+        return;
+    }
+
+    // NakamaX4Client owns the session: it persists the refreshed one and
+    // hands it to SetSession before onDone runs
+    LogInfo("Session expired, refreshing before reconnecting");
+    NakamaX4Client::GetInstance()->RefreshSessionNow([this](bool success) {
+        if (m_state != RealtimeConnectionState::Reconnecting) {
+            return; // Shut down meanwhile
+        }
+        if (!success) {
+            ScheduleReconnect();
+            return;
+        }
+        ConnectSocket();
+    });
+}
+
+void NakamaRealtimeClient::ConnectSocket() {
+    LogInfo("Reconnecting realtime socket (attempt %d)", m_backoff.Attempts());
+    // onConnect / onDisconnect report the outcome
+    m_rtClient->connect(Session(), true);
+}
+
+// Re-resolve the sector (its match may have been replaced while we were
+// away) and join it. The server's late-join full snapshot repopulates
+// SectorMatchManager.
+void NakamaRealtimeClient::RejoinSector() {
+    const std::string sector = m_rejoinSector;
+    LogInfo("Rejoining sector match: %s", sector.c_str());
+
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    if (sectorManager) {
+        sectorManager->ClearRemotePlayers();
+    }
+
+    // Runs on the thread that ticks the network, like the SDK callbacks
+    NakamaX4Client::GetInstance()->StartTask<SectorMatchJoin>(JoinSectorMatchAsync(sector, BuildMatchRequest(sector)),
+        [this, sector](std::future<SectorMatchJoin> result) {
+            try {
+                const SectorMatchJoin match = result.get();
+                if (match.matchId.empty()) {
+                    throw std::runtime_error("no match for sector");
+                }
+                ApplyMatchJoin(match);
+            }
+            catch (const std::exception& e) {
+                LogError("Failed to rejoin sector %s: %s", sector.c_str(), e.what());
+            }
+            m_rejoinSector.clear();
+            RecordRecovery();
+        });
+}
+
+void NakamaRealtimeClient::RecordRecovery() {
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - m_disconnectedAt).count();
+    {
+        std::lock_guard<std::mutex> lock(m_rpcStatsMutex);
+        m_recoveryStats.Record(ms);
+    }
+    LogInfo("Realtime connection recovered in %.0f ms", ms);
+}
+
+float NakamaRealtimeClient::GetLastRecoveryMs() const {
+    return static_cast<float>(GetRecoveryStats().lastMs);
+}
+
+int NakamaRealtimeClient::GetReconnectCount() const {
+    return static_cast<int>(GetRecoveryStats().calls);
+}
+
+LatencyStats NakamaRealtimeClient::GetRecoveryStats() const {
+    std::lock_guard<std::mutex> lock(m_rpcStatsMutex);
+    return m_recoveryStats;
 }
 
 void NakamaRealtimeClient::OnMatchJoined(const std::string& matchId) {
     LogInfo("Joined match: %s", matchId.c_str());
+    // Server tick numbering restarts with every match
+    m_lastServerTick = -1;
+    // Probes sent to the previous match will never be answered
+    std::lock_guard<std::mutex> lock(m_linkMutex);
+    m_linkQuality.Reset();
+    m_sendRate.Reset();
 }
 
 void NakamaRealtimeClient::OnMatchLeft() {
     LogInfo("Left current match");
-    m_currentMatchId.clear();
+    SetCurrentMatchId("");
+}
+
+// Reads a [tick, [[opCode, payload], ...]] snapshot. Returns false if malformed.
+static bool ReadSnapshot(const msgpack::object& obj, std::int64_t& tick,
+    std::vector<std::pair<std::int64_t, const msgpack::object*>>& entries) {
+    if (obj.type != msgpack::type::ARRAY || obj.via.array.size < 2) {
+        return false;
+    }
+
+    tick = obj.via.array.ptr[0].as<std::int64_t>();
+
+    const msgpack::object& list = obj.via.array.ptr[1];
+    if (list.type != msgpack::type::ARRAY) {
+        return false;
+    }
+
+    entries.reserve(list.via.array.size);
+    for (uint32_t i = 0; i < list.via.array.size; ++i) {
+        const msgpack::object& entry = list.via.array.ptr[i];
+        if (entry.type != msgpack::type::ARRAY || entry.via.array.size < 2) {
+            continue;
+        }
+        entries.emplace_back(entry.via.array.ptr[0].as<std::int64_t>(), &entry.via.array.ptr[1]);
+    }
+    return true;
 }
 
 void NakamaRealtimeClient::onMatchData(const Nakama::NMatchData& matchData) {
-    // Handle incoming match data (position updates from other players)
-    if (matchData.opCode == 1) // Position data opcode
-    {
-        try {
-            // Deserialize MessagePack data into PositionUpdate struct
-            msgpack::object_handle oh =
-                msgpack::unpack(reinterpret_cast<const char*>(matchData.data.data()),
-                    matchData.data.size());
-            msgpack::object obj = oh.get();
+    const InboundExecutor executor = matchData.opCode == MatchOpCode::Pong ? nullptr : GetInboundExecutor();
+    if (!executor) {
+        DispatchMatchData(matchData.opCode, matchData.data.data(), matchData.data.size());
+        return;
+    }
+    executor([this, opCode = matchData.opCode, data = matchData.data]() {
+        DispatchMatchData(opCode, data.data(), data.size());
+    });
+}
 
-            // Convert to PositionUpdate struct
-            PositionUpdate update;
-            obj.convert(update);
+// Handle incoming match data through the registered opcode handlers
+void NakamaRealtimeClient::DispatchMatchData(std::int64_t opCode, const char* data, size_t size) {
+    try {
+        auto result = m_matchHandlers.Dispatch(opCode, data, size);
+        if (result == MatchHandlerRegistry::DispatchResult::Malformed) {
+            LogWarning("Malformed match data (opcode %lld)", static_cast<long long>(opCode));
+        }
+        else if (result == MatchHandlerRegistry::DispatchResult::Unknown) {
+            LogWarning("Unknown match data opcode %lld", static_cast<long long>(opCode));
+        }
+    }
+    catch (const std::exception& e) {
+        LogError("Failed to deserialize match data (opcode %lld): %s",
+            static_cast<long long>(opCode), e.what());
+    }
+}
 
-            if (update.player_id == m_session->getUserId()) {
-                // Ignore updates from self
-                return;
-            }
+void NakamaRealtimeClient::SetInboundExecutor(InboundExecutor executor) {
+    std::lock_guard<std::mutex> lock(m_transportMutex);
+    m_inboundExecutor = std::move(executor);
+}
 
-            // Update remote player
+NakamaRealtimeClient::InboundExecutor NakamaRealtimeClient::GetInboundExecutor() const {
+    std::lock_guard<std::mutex> lock(m_transportMutex);
+    return m_inboundExecutor;
+}
+
+void NakamaRealtimeClient::RunInbound(std::function<void()> work) {
+    const InboundExecutor executor = GetInboundExecutor();
+    if (!executor) {
+        work();
+        return;
+    }
+    executor(std::move(work));
+}
+
+void NakamaRealtimeClient::RegisterSectorHandlers() {
+    // Position updates make up nearly all inbound traffic; they are decoded
+    // straight from the packet bytes without building a msgpack object tree
+    m_matchHandlers.Register<PositionUpdateView>(MatchOpCode::Position, "position",
+        [](const char* data, size_t size, PositionUpdateView& out) {
+            MsgPackReader reader(data, size);
+            return MatchDecode::ReadPositionUpdate(reader, out);
+        },
+        [this](const PositionUpdateView& update) { ApplyPosition(update); });
+
+    m_matchHandlers.Register<FleetUpdate>(MatchOpCode::Fleet, "fleet",
+        [this](const FleetUpdate& update) {
             auto* sectorManager = SectorMatchManager::GetInstance();
-            if (sectorManager) {
-                sectorManager->UpdateRemotePlayer(update.player_id, update.position,
-                    update.rotation, update.velocity);
+            if (sectorManager && !IsSelf(update.player_id)) {
+                sectorManager->UpdateRemoteFleet(update);
+            }
+        });
+
+    m_matchHandlers.RegisterRaw(MatchOpCode::Snapshot, "snapshot",
+        [this](const char* data, size_t size) {
+            MsgPackReader reader(data, size);
+            return HandleSnapshot(reader);
+        });
+
+    m_matchHandlers.RegisterRaw(MatchOpCode::Pong, "pong",
+        [this](const char* data, size_t size) {
+            MsgPackReader reader(data, size);
+            std::uint32_t fields = 0;
+            std::int64_t sequence = 0;
+            if (!reader.ReadArrayHeader(fields) || fields < 1 || !reader.ReadInt(sequence)) {
+                return false;
             }
+            OnPong(static_cast<std::uint32_t>(sequence));
+            return true;
+        });
+
+    auto bulk = [this](std::int64_t opCode) {
+        return [this, opCode](const char* data, size_t size) {
+            msgpack::object_handle oh = msgpack::unpack(data, size);
+            return HandleBulkSnapshot(opCode, oh.get());
+        };
+    };
+    m_matchHandlers.RegisterRaw(MatchOpCode::FullSnapshot, "full_snapshot",
+        bulk(MatchOpCode::FullSnapshot));
+    m_matchHandlers.RegisterRaw(MatchOpCode::ShardGhosts, "shard_ghosts",
+        bulk(MatchOpCode::ShardGhosts));
+}
+
+// Aggregated server tick: [tick, [[opCode, payload], ...]]
+// Each entry goes through the same handlers as a standalone message.
+bool NakamaRealtimeClient::HandleSnapshot(MsgPackReader& reader) {
+    std::uint32_t fields = 0;
+    std::int64_t tick = 0;
+    std::uint32_t count = 0;
+    if (!reader.ReadArrayHeader(fields) || fields < 2 || !reader.ReadInt(tick) ||
+        !reader.ReadArrayHeader(count)) {
+        return false;
+    }
+
+    if (tick <= m_lastServerTick) {
+        return true; // Older than what we already applied
+    }
+    m_lastServerTick = tick;
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint32_t pairSize = 0;
+        std::int64_t entryOpCode = 0;
+        std::string_view payload;
+        if (!reader.ReadArrayHeader(pairSize) || pairSize != 2 ||
+            !reader.ReadInt(entryOpCode) || !reader.ReadRaw(payload)) {
+            return false;
         }
-        catch (const std::exception& e) {
-            LogError("Failed to deserialize match data: %s", e.what());
+
+        // Unknown entry types are counted by the registry and skipped
+        if (m_matchHandlers.Dispatch(entryOpCode, payload.data(), payload.size()) ==
+            MatchHandlerRegistry::DispatchResult::Malformed) {
+            LogWarning("Malformed snapshot entry (opcode %lld)",
+                static_cast<long long>(entryOpCode));
+        }
+    }
+    return true;
+}
+
+void NakamaRealtimeClient::ApplyPosition(const PositionUpdateView& update) {
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    if (!sectorManager || IsSelf(update.player_id)) {
+        // Ignore updates from self
+        return;
+    }
+
+    m_scratchPlayerId.assign(update.player_id.data(), update.player_id.size());
+    m_scratchPosition.assign(update.position.begin(), update.position.end());
+    m_scratchRotation.assign(update.rotation.begin(), update.rotation.end());
+    m_scratchVelocity.assign(update.velocity.begin(), update.velocity.end());
+    sectorManager->UpdateRemotePlayer(m_scratchPlayerId, m_scratchPosition,
+        m_scratchRotation, m_scratchVelocity);
+}
+
+// Late-join state of everyone already in the sector, or the state of sibling
+// shards; both are applied in bulk
+bool NakamaRealtimeClient::HandleBulkSnapshot(std::int64_t opCode, const msgpack::object& obj) {
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    if (!sectorManager) {
+        return true;
+    }
+
+    std::int64_t tick = 0;
+    std::vector<std::pair<std::int64_t, const msgpack::object*>> entries;
+    if (!ReadSnapshot(obj, tick, entries)) {
+        return false;
+    }
+
+    std::vector<PositionUpdate> players;
+    std::vector<FleetUpdate> fleets;
+    for (const auto& entry : entries) {
+        if (entry.first == MatchOpCode::Position) {
+            PositionUpdate update;
+            entry.second->convert(update);
+            if (!IsSelf(update.player_id)) {
+                players.push_back(std::move(update));
+            }
         }
+        else if (entry.first == MatchOpCode::Fleet) {
+            FleetUpdate update;
+            entry.second->convert(update);
+            if (!IsSelf(update.player_id)) {
+                fleets.push_back(std::move(update));
+            }
+        }
+    }
+
+    if (opCode == MatchOpCode::ShardGhosts) {
+        // Ticks belong to the sibling match, not ours
+        sectorManager->ApplyShardGhosts(players, fleets);
+        return true;
     }
+
+    sectorManager->ApplySectorSnapshot(players, fleets);
+    // The regular snapshot for this same tick may still follow
+    m_lastServerTick = std::max(m_lastServerTick, tick - 1);
+    return true;
+}
+
+void NakamaRealtimeClient::SendPingIfDue() {
+    const auto now = std::chrono::steady_clock::now();
+    if (!m_connected || !InMatch() || now - m_lastPingSent < PING_INTERVAL) {
+        return;
+    }
+    m_lastPingSent = now;
+
+    std::uint32_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_linkMutex);
+        sequence = m_linkQuality.OnPingSent(now);
+    }
+
+    msgpack::sbuffer sbuf;
+    msgpack::pack(sbuf, std::vector<std::uint32_t>{ sequence });
+    // Flushed right after this, so the send time above is accurate to the tick
+    m_outbound.Enqueue(MatchOpCode::Ping, std::string_view(sbuf.data(), sbuf.size()), false);
+}
+
+void NakamaRealtimeClient::OnPong(std::uint32_t sequence) {
+    std::lock_guard<std::mutex> lock(m_linkMutex);
+    m_linkQuality.OnPong(sequence, std::chrono::steady_clock::now());
+}
+
+// Feed the link estimate into interpolation delay and, through the AIMD
+// controller, the local send rate. Runs every network tick so a stuck probe
+// is noticed without waiting for the next pong.
+void NakamaRealtimeClient::AdaptToLink() {
+    if (!m_connected || !InMatch()) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    float marginMs = 0.0f;
+    int intervalMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_linkMutex);
+        m_linkQuality.Expire(now);
+
+        SendRateController::Signals signals;
+        signals.smoothedRttMs = m_linkQuality.SmoothedRttMs();
+        signals.rttVarMs = m_linkQuality.JitterMs();
+        signals.minRttMs = m_linkQuality.MinRttMs();
+        signals.oldestPendingMs = m_linkQuality.OldestPendingMs(now);
+        signals.lossRate = m_linkQuality.LossRate();
+        signals.samples = m_linkQuality.Samples();
+
+        m_sendRate.Update(signals, now);
+        marginMs = m_linkQuality.JitterMarginMs();
+        intervalMs = m_sendRate.IntervalMs();
+    }
+
+    auto* sectorManager = SectorMatchManager::GetInstance();
+    if (sectorManager) {
+        sectorManager->SetLinkDelayMargin(marginMs);
+        sectorManager->SetSendInterval(intervalMs);
+    }
+}
+
+float NakamaRealtimeClient::GetSendRateHz() const {
+    std::lock_guard<std::mutex> lock(m_linkMutex);
+    return static_cast<float>(m_sendRate.RateHz());
+}
+
+int NakamaRealtimeClient::GetCongestionEvents() const {
+    std::lock_guard<std::mutex> lock(m_linkMutex);
+    return static_cast<int>(m_sendRate.Decreases());
+}
+
+LinkQualityEstimator NakamaRealtimeClient::GetLinkQuality() const {
+    std::lock_guard<std::mutex> lock(m_linkMutex);
+    return m_linkQuality;
+}
+
+float NakamaRealtimeClient::GetRttMs() const {
+    return static_cast<float>(GetLinkQuality().SmoothedRttMs());
+}
+
+float NakamaRealtimeClient::GetJitterMs() const {
+    return static_cast<float>(GetLinkQuality().JitterMs());
+}
+
+float NakamaRealtimeClient::GetPacketLoss() const {
+    return static_cast<float>(GetLinkQuality().LossRate());
+}
+
+MatchOpCodeStats NakamaRealtimeClient::GetInboundStats(std::int64_t opCode) const {
+    return m_matchHandlers.GetStats(opCode);
+}
+
+int NakamaRealtimeClient::GetReceivedMessageCount(int opCode) const {
+    return static_cast<int>(m_matchHandlers.GetStats(opCode).messages);
+}
+
+float NakamaRealtimeClient::GetDecodePercentileUs(int opCode, float percentile) const {
+    return static_cast<float>(m_matchHandlers.GetStats(opCode).DecodePercentileUs(percentile));
 }
 
 void NakamaRealtimeClient::onMatchPresence(
     const Nakama::NMatchPresenceEvent& matchPresence) {
+    RunInbound([this, matchPresence]() { ApplyPresence(matchPresence); });
+}
+
+void NakamaRealtimeClient::ApplyPresence(const Nakama::NMatchPresenceEvent& matchPresence) {
     // Handle players joining/leaving the match
     auto* sectorManager = SectorMatchManager::GetInstance();
     if (!sectorManager)
@@ -238,8 +1086,12 @@ void NakamaRealtimeClient::onMatchPresence(
 
     for (const auto& presence : matchPresence.joins) {
         LogInfo("Player joined match: %s", presence.userId.c_str());
-        // When a player joins, they should send their current position
-        // For now, just add them as a remote player
+        // Keep state already delivered by a full snapshot; otherwise add a
+        // placeholder until the player's first update arrives
+        if (IsSelf(presence.userId) ||
+            sectorManager->HasPlayer(presence.userId)) {
+            continue;
+        }
         PlayerShip remoteShip(presence.userId, "remote_ship", true);
         sectorManager->OnSectorJoined(sectorManager->GetCurrentSector(),
             remoteShip);
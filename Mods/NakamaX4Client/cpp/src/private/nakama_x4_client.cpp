@@ -3,15 +3,36 @@
 #include "../public/nakama_realtime_client.h"
 #include "../public/sector_match.h"
 #include "../public/x4_script_base.h"
+#include "lua_dispatch_queue.h"
+#include <nakama-cpp/NUtils.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <ctime>
 #include <thread>
 #include "nakama_x4_client.h"
 
+// REST calls slower than this are logged with their timing breakdown
+constexpr double SLOW_HTTP_REQUEST_MS = 1000.0;
+// Network thread cadence while REST calls are outstanding: the pooled
+// transport's sockets are not part of the wait, and the SDK transport gives
+// no completion signal at all
+constexpr auto HTTP_POLL_INTERVAL = std::chrono::milliseconds(5);
+constexpr auto SDK_HTTP_POLL_INTERVAL = std::chrono::milliseconds(50);
+// How long authentication / storage sync may take, blocking or not
+constexpr auto AUTH_TIMEOUT = std::chrono::seconds(20);
+constexpr auto SYNC_TIMEOUT = std::chrono::seconds(5);
+// Operation progress once the request is handed to the transport
+constexpr float REQUEST_SENT_PROGRESS = 0.5f;
+constexpr const char* PLAYER_DATA_COLLECTION = "player_data";
+constexpr const char* STORAGE_JOURNAL_FILE = "nakama_storage.journal";
+constexpr const char* SESSION_FILE = "nakama_session.dat";
+// Before retrying a failed background session refresh
+constexpr auto SESSION_REFRESH_RETRY = std::chrono::seconds(60);
+
 NakamaX4Client::NakamaX4Client()
 	: X4ScriptSingleton("NakamaX4Client"), m_authenticating(false),
-	m_syncing(false), m_lastUpdateTime(std::chrono::steady_clock::now()) {
+	m_lastUpdateTime(std::chrono::steady_clock::now()) {
 }
 
 bool NakamaX4Client::Initialize(const Config& config) {
@@ -23,12 +44,17 @@ bool NakamaX4Client::Initialize(const Config& config) {
 	LogInfo("Initializing Nakama client (host=%s, port=%d)", config.host.c_str(),
 		config.port);
 
+	m_config = config;
+	m_executionMode = config.executionMode;
+	m_tasks = CancellationSource();
 	if (!CreateClient(config)) {
 		LogError("Failed to create Nakama client");
 		return false;
 	}
+	OpenStorageJournal();
 
 	SetInitialized(true);
+	RestoreSession();
 	LogInfo("Nakama client initialized successfully");
 	return true;
 }
@@ -40,53 +66,201 @@ void NakamaX4Client::Shutdown() {
 
 	LogInfo("Shutting down Nakama client");
 
+	// Join the network thread before tearing down what it ticks. Cancelled
+	// tasks unwind on this thread so their frames are released.
+	m_tasks.Cancel();
+	m_network.Stop();
+	m_network.RunPending(std::chrono::steady_clock::now());
+	m_operations.CancelAll();
+	m_journal.Close();
+	m_storage.Clear();
+
 	auto* realtimeClient = NakamaRealtimeClient::GetInstance();
-	if (realtimeClient && realtimeClient->IsInitialized()) {
-		realtimeClient->Shutdown();
+	if (realtimeClient) {
+		realtimeClient->SetNetworkWakeHandler(nullptr);
+		realtimeClient->SetInboundExecutor(nullptr);
+		if (realtimeClient->IsInitialized()) {
+			realtimeClient->Shutdown();
+		}
 	}
 
-	m_session.reset();
+	SetSession(nullptr);
 	m_client.reset();
+	m_httpTransport.reset();
 
 	m_authenticating = false;
-	m_syncing = false;
-	
-	// Only join the thread if it's joinable (not detached)
-	if (m_updaterThread.joinable()) {
-		m_updaterThread.join();
+	m_refreshingSession = false;
+	m_sessionRefreshAt = std::chrono::steady_clock::time_point::max();
+	{
+		std::lock_guard<std::mutex> lock(m_sessionMutex);
+		m_sessionDevice.clear();
+		m_refreshWaiters.clear();
 	}
+	m_mainThread.Clear();
+	m_pumped = false;
 
 	SetInitialized(false);
 	LogInfo("Nakama client shutdown complete");
 }
 
-std::thread NakamaX4Client::StartUpdater() {
-	return std::thread([this]() {
-		while (m_client != nullptr) {
-
-			auto currentTime = std::chrono::steady_clock::now();
-			std::chrono::duration<float> deltaTime = currentTime - m_lastUpdateTime;
-			m_lastUpdateTime = currentTime;
+// The network thread sleeps on the realtime socket (or a condition variable
+// without one) and runs a round when data arrives, work is queued or the
+// deadline returned by the previous round passes
+bool NakamaX4Client::StartUpdater() {
+	auto* realtimeClient = NakamaRealtimeClient::GetInstance();
+	if (realtimeClient) {
+		realtimeClient->SetNetworkWakeHandler([this]() { m_network.Wake(); });
+	}
+	if (m_httpTransport) {
+		m_httpTransport->SetWakeHandler([this]() { m_network.Wake(); });
+	}
 
-			m_client->tick();
-			Update(deltaTime.count());
-			std::this_thread::sleep_for(std::chrono::milliseconds(50));
-		}
+	m_lastUpdateTime = std::chrono::steady_clock::now();
+	return m_network.Start(
+		[this](std::chrono::steady_clock::time_point now) { return NetworkTick(now); },
+		[](std::chrono::milliseconds timeout) {
+			auto* realtimeClient = NakamaRealtimeClient::GetInstance();
+			return realtimeClient && realtimeClient->WaitForNetwork(timeout);
+		},
+		[]() {
+			auto* realtimeClient = NakamaRealtimeClient::GetInstance();
+			if (realtimeClient) {
+				realtimeClient->WakeNetwork();
+			}
 		});
 }
 
-void NakamaX4Client::Update(float deltaTime) {
-	// Call base class Update to handle callbacks
-	X4ScriptBase::Update(deltaTime);
+std::chrono::steady_clock::time_point NakamaX4Client::NetworkTick(std::chrono::steady_clock::time_point now) {
+	std::chrono::duration<float> deltaTime = now - m_lastUpdateTime;
+	m_lastUpdateTime = now;
 
-	// Update realtime client
+	m_client->tick();
+	const auto session = Session();
+	if (session && m_storage.ShouldFlush(now)) {
+		StartStorageFlush(session);
+	}
+	if (!m_journal.Sync(now)) {
+		LogWarning("Could not write the storage journal");
+	}
+	if (session && !m_refreshingSession && now >= m_sessionRefreshAt.load()) {
+		StartSessionRefresh(session);
+	}
 	auto* realtimeClient = NakamaRealtimeClient::GetInstance();
 	if (realtimeClient) {
-		realtimeClient->Update(deltaTime);
+		realtimeClient->Update(deltaTime.count());
 	}
 
-	// Process any pending async operations
-	// This could be expanded to handle timeouts, retries, etc.
+	// REST responses are delivered by tick(). Only the pooled transport can
+	// tell whether any are outstanding; the SDK transport is polled.
+	auto deadline = std::chrono::steady_clock::time_point::max();
+	if (!m_httpTransport) {
+		deadline = now + SDK_HTTP_POLL_INTERVAL;
+	}
+	else if (m_httpTransport->HasPendingRequests()) {
+		deadline = now + HTTP_POLL_INTERVAL;
+	}
+
+	if (realtimeClient) {
+		deadline = std::min(deadline, realtimeClient->NextNetworkDeadline(now));
+	}
+	if (session) {
+		deadline = std::min(deadline, m_storage.NextFlushDeadline());
+	}
+	deadline = std::min(deadline, m_journal.NextSyncDeadline());
+	if (session && !m_refreshingSession) {
+		deadline = std::min(deadline, m_sessionRefreshAt.load());
+	}
+	return std::min(deadline, m_operations.ExpireOverdue(now));
+}
+
+// Threaded: the network thread runs and inbound events are queued for Pump().
+// Frame-driven: the thread is stopped and Pump() does the I/O itself.
+void NakamaX4Client::ApplyExecutionMode() {
+	auto* realtimeClient = NakamaRealtimeClient::GetInstance();
+	if (m_executionMode == ExecutionMode::Threaded) {
+		// Without a Pump() caller queued events would never run
+		if (realtimeClient && m_pumped) {
+			realtimeClient->SetInboundExecutor([this](std::function<void()> work) {
+				m_mainThread.Post(std::move(work));
+			});
+		}
+		StartUpdater();
+		return;
+	}
+
+	m_network.Stop();
+	if (realtimeClient) {
+		realtimeClient->SetInboundExecutor(nullptr);
+	}
+	// Events the thread handed over before it stopped
+	m_mainThread.Drain();
+}
+
+void NakamaX4Client::Pump() {
+	if (!IsInitialized()) {
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const std::chrono::duration<float> frameTime = m_pumped ? start - m_lastPumpTime : std::chrono::duration<float>(0);
+	m_lastPumpTime = start;
+	if (!m_pumped) {
+		m_pumped = true;
+		ApplyExecutionMode();
+	}
+
+	if (m_executionMode == ExecutionMode::FrameDriven) {
+		m_network.RunPending(start);
+		NetworkTick(start);
+	}
+	m_mainThread.Drain();
+	Update(frameTime.count());
+	// Lua callbacks queued this frame (or by the network thread) in one pcall
+	LuaDispatchQueue::Instance().Drain();
+
+	m_lastPumpMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool NakamaX4Client::SetExecutionMode(const std::string& mode) {
+	ExecutionMode executionMode;
+	if (mode == "threaded") {
+		executionMode = ExecutionMode::Threaded;
+	}
+	else if (mode == "frame") {
+		executionMode = ExecutionMode::FrameDriven;
+	}
+	else {
+		LogWarning("Unknown execution mode '%s' (expected 'threaded' or 'frame')", mode.c_str());
+		return false;
+	}
+
+	if (executionMode == m_executionMode) {
+		return true;
+	}
+	LogInfo("Switching to %s execution", mode.c_str());
+	m_executionMode = executionMode;
+	m_config.executionMode = executionMode;
+	if (IsInitialized()) {
+		ApplyExecutionMode();
+	}
+	return true;
+}
+
+std::string NakamaX4Client::GetExecutionMode() const {
+	return m_executionMode == ExecutionMode::FrameDriven ? "frame" : "threaded";
+}
+
+float NakamaX4Client::GetPumpTimeMs() const {
+	return m_lastPumpMs;
+}
+
+float NakamaX4Client::GetMainThreadLatencyMs() const {
+	return static_cast<float>(m_mainThread.GetStats().AverageLatencyMs());
+}
+
+// Frame update from Pump(): registered callbacks run on the game thread
+void NakamaX4Client::Update(float deltaTime) {
+	X4ScriptBase::Update(deltaTime);
 }
 
 void NakamaX4Client::ConnectRealtimeClient(std::function<void(bool)> callback)
@@ -106,7 +280,8 @@ void NakamaX4Client::ConnectRealtimeClient(std::function<void(bool)> callback)
 	}
 
 	if (realtimeClient) {
-		realtimeClient->Initialize(m_session, m_client, callback);
+		realtimeClient->Initialize(Session(), m_client, callback,
+			m_config.eventDrivenTransport && !m_config.useSSL);
 	}
 	else {
 		callback(false);
@@ -117,7 +292,8 @@ bool NakamaX4Client::CreateClient(const Config& config) {
 	try {
 		// Reset state
 		m_client.reset();
-		m_session.reset();
+		SetSession(nullptr);
+		m_httpTransport.reset();
 
 		// Create Nakama client parameters
 		auto parameters = Nakama::DefaultClientParameters();
@@ -128,13 +304,26 @@ bool NakamaX4Client::CreateClient(const Config& config) {
 
 		LogInfo("Creating Nakama client...");
 
-		// Create the client
-		m_client = Nakama::createDefaultClient(parameters);
+		// Create the client. NClientParameters carries no transport, so the
+		// pooled one goes through the REST client factory.
+		if (config.pooledHttpTransport && !config.useSSL) {
+			m_httpTransport = std::make_shared<PooledHttpTransport>();
+			m_httpTransport->SetTimingObserver([this](const HttpRequestTiming& timing) {
+				if (timing.totalMs >= SLOW_HTTP_REQUEST_MS) {
+					LogWarning("Slow request %s: %d in %.0f ms (queued %.0f ms, %s connection)",
+						timing.path.c_str(), timing.statusCode, timing.totalMs, timing.queueMs,
+						timing.reusedConnection ? "reused" : "new");
+				}
+			});
+			m_client = Nakama::createRestClient(parameters, m_httpTransport);
+		}
+		else {
+			m_client = Nakama::createDefaultClient(parameters);
+		}
 
 		if (m_client) {
 			LogInfo("Nakama client created successfully");
-			m_updaterThread = StartUpdater();
-			m_updaterThread.detach();
+			ApplyExecutionMode();
 			return true;
 		}
 		else {
@@ -152,6 +341,18 @@ bool NakamaX4Client::CreateClient(const Config& config) {
 	}
 }
 
+float NakamaX4Client::GetHttpAverageLatencyMs() const {
+	return m_httpTransport ? static_cast<float>(m_httpTransport->GetStats().AverageMs()) : 0.0f;
+}
+
+int NakamaX4Client::GetHttpReusedRequests() const {
+	return m_httpTransport ? static_cast<int>(m_httpTransport->GetStats().reusedRequests) : 0;
+}
+
+int NakamaX4Client::GetNetworkTicks() const {
+	return static_cast<int>(m_network.GetStats().ticks);
+}
+
 NakamaX4Client::AuthResult
 NakamaX4Client::Authenticate(const std::string& deviceId,
 	const std::string& username) {
@@ -159,6 +360,11 @@ NakamaX4Client::Authenticate(const std::string& deviceId,
 		return { false, "Client not initialized" };
 	}
 
+	if (HasSessionFor(deviceId)) {
+		LogInfo("Using the restored session for device %s", deviceId.c_str());
+		return { true, "" };
+	}
+
 	if (m_authenticating) {
 		return { false, "Authentication already in progress" };
 	}
@@ -178,66 +384,188 @@ NakamaX4Client::PerformAuthentication(const std::string& deviceId,
 	m_authenticating = true;
 
 	try {
-		LogInfo("Authenticating with Nakama...");
-
-		auto future = std::make_shared<std::promise<AuthResult>>();
-
-		auto successCallback = [this, future](Nakama::NSessionPtr session) {
-			LogInfo("Authentication successful - Session created: %s",
-				session ? "YES" : "NO");
-			if (session) {
-				LogInfo("Session user ID: %s", session->getUserId().c_str());
-				LogInfo("Session username: %s", session->getUsername().c_str());
-				LogInfo("Session token: %s",
-					session->getAuthToken().substr(0, 20).c_str());
+		AdoptSession(RunTask(AuthenticateDevice(deviceId, username), AUTH_TIMEOUT), deviceId);
+		m_authenticating = false;
+		return { true, "" };
+	}
+	catch (const TaskTimeout&) {
+		LogError("Authentication timeout");
+		m_authenticating = false;
+		return { false, "Authentication timeout" };
+	}
+	catch (const NakamaError& e) {
+		LogError("Authentication failed: %s (code: %d)", e.what(), e.Code());
+		m_authenticating = false;
+		return { false, e.what() };
+	}
+	catch (const std::exception& e) {
+		LogError("Authentication exception: %s", e.what());
+		m_authenticating = false;
+		return { false, std::string("Exception: ") + e.what() };
+	}
+}
+
+Task<Nakama::NSessionPtr> NakamaX4Client::AuthenticateDevice(std::string deviceId, std::string username) {
+	LogInfo("Authenticating with Nakama...");
+
+	// Use device authentication
+	auto client = m_client;
+	Nakama::NSessionPtr session = co_await NakamaCall<Nakama::NSessionPtr>(
+		[client, deviceId, username](auto onSuccess, auto onError) {
+			client->authenticateDevice(deviceId, username, true, {}, onSuccess, onError);
+		});
+
+	LogInfo("Authentication successful - Session created: %s",
+		session ? "YES" : "NO");
+	if (session) {
+		LogInfo("Session user ID: %s", session->getUserId().c_str());
+		LogInfo("Session username: %s", session->getUsername().c_str());
+		LogInfo("Session token: %s",
+			session->getAuthToken().substr(0, 20).c_str());
+	}
+	co_return session;
+}
+
+std::string NakamaX4Client::ServerId() const {
+	return m_config.host + ":" + std::to_string(m_config.port);
+}
+
+// A session from an earlier game load skips authenticateDevice: the realtime
+// connect starts right away and Authenticate for the same device returns at
+// once. An expired session is refreshed first, in the background.
+void NakamaX4Client::RestoreSession() {
+	m_sessionStore.SetPath(LogToX4::GetDataDir() + "\\" + SESSION_FILE);
+	const auto stored = m_sessionStore.Load();
+	if (!stored || stored->server != ServerId()) {
+		return;
+	}
+
+	auto session = Nakama::restoreSession(stored->authToken, stored->refreshToken);
+	if (!session || session->isRefreshExpired()) {
+		LogInfo("Stored session can no longer be refreshed; authenticating again");
+		m_sessionStore.Clear();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_sessionMutex);
+		m_sessionDevice = stored->deviceId;
+	}
+	if (session->isExpired()) {
+		LogInfo("Stored session has expired; refreshing it");
+		StartSessionRefresh(session);
+		return;
+	}
+
+	LogInfo("Restored session for user %s", session->getUserId().c_str());
+	AdoptSession(session, stored->deviceId);
+}
+
+bool NakamaX4Client::AdoptSession(Nakama::NSessionPtr session, const std::string& deviceId,
+	Nakama::NSessionPtr onlyReplacing) {
+	if (!session) {
+		return false;
+	}
+	{
+		// Checked and swapped together, so a newer session is never overwritten
+		std::lock_guard<std::mutex> lock(m_sessionMutex);
+		if (onlyReplacing && m_session && m_session != onlyReplacing) {
+			return false;
+		}
+		m_session = session;
+		m_sessionDevice = deviceId;
+	}
+	if (!m_sessionStore.Save({ ServerId(), deviceId, session->getAuthToken(), session->getRefreshToken() })) {
+		LogWarning("Could not save the session; the next game load authenticates again");
+	}
+
+	const Nakama::NTimestamp nowMs = Nakama::getUnixTimestampMs();
+	const std::uint64_t refreshAtMs = SessionStore::RefreshAtMs(session->getCreateTime(), session->getExpireTime());
+	m_sessionRefreshAt = std::chrono::steady_clock::now() +
+		std::chrono::milliseconds(refreshAtMs > nowMs ? refreshAtMs - nowMs : 0);
+
+	auto* realtimeClient = NakamaRealtimeClient::GetInstance();
+	if (realtimeClient && realtimeClient->IsInitialized()) {
+		realtimeClient->SetSession(session);
+	}
+	else {
+		ConnectRealtimeClient([this](bool success) {
+			if (!success) {
+				LogWarning("Early realtime connect failed; joining a sector retries it");
 			}
-			m_session = session;
-			m_authenticating = false;
+		});
+	}
 
-			// LogInfo("Initializing realtime client...");
-			// auto* realtimeClient = NakamaRealtimeClient::GetInstance();
-			// if (realtimeClient->Initialize(m_session, m_client)) {
-			// 	LogInfo("Realtime client initialized successfully");
-
-			// 	// Initialize sector manager with local player ID
-			// 	auto* sectorManager = SectorMatchManager::GetInstance();
-			// 	if (sectorManager->Initialize(session->getUserId())) {
-			// 		LogInfo("Sector manager initialized successfully");
-			// 	}
-			// 	else {
-			// 		LogWarning("Failed to initialize sector manager");
-			// 	}
-			// }
-			// else {
-			// 	LogWarning("Failed to initialize realtime client");
-			// }
-
-			future->set_value({ true, "" });
-			};
-
-		auto errorCallback = [this, future](const Nakama::NError& error) {
-			LogError("Authentication failed: %s (code: %d)", error.message.c_str(),
-				error.code);
-			m_authenticating = false;
-			future->set_value({ false, error.message });
-			};
+	// Back online: send what piled up without waiting for the delay
+	m_storage.RequestFlush();
+	m_network.Wake();
+	return true;
+}
 
-		// Use device authentication
+bool NakamaX4Client::HasSessionFor(const std::string& deviceId) const {
+	const auto session = Session();
+	return session && !session->isExpired() && SessionDevice() == deviceId;
+}
 
-		m_client->authenticateDevice(deviceId, username, true, {}, successCallback,
-			errorCallback);
+std::string NakamaX4Client::SessionDevice() const {
+	std::lock_guard<std::mutex> lock(m_sessionMutex);
+	return m_sessionDevice;
+}
 
-		auto fut = future->get_future();
-		auto future_status = fut.wait_for(std::chrono::seconds(20));
+void NakamaX4Client::RefreshSessionNow(std::function<void(bool)> onDone) {
+	const auto session = Session();
+	if (!session) {
+		onDone(false);
+		return;
+	}
+	StartSessionRefresh(session, std::move(onDone));
+}
 
-		m_authenticating = false;
-		return fut.get();
+void NakamaX4Client::StartSessionRefresh(Nakama::NSessionPtr session, std::function<void(bool)> onDone) {
+	if (onDone) {
+		std::lock_guard<std::mutex> lock(m_sessionMutex);
+		m_refreshWaiters.push_back(std::move(onDone));
 	}
-	catch (const std::exception& e) {
-		LogError("Authentication exception: %s", e.what());
-		m_authenticating = false;
-		return { false, std::string("Exception: ") + e.what() };
+	if (m_refreshingSession.exchange(true)) {
+		return;
 	}
+
+	LogInfo("Refreshing session in the background");
+	StartTask(RefreshSession(session), [this, session](std::future<Nakama::NSessionPtr> result) {
+		bool success = false;
+		try {
+			auto refreshed = result.get();
+			// A full authentication meanwhile wins
+			AdoptSession(refreshed, SessionDevice(), session);
+			success = true;
+		}
+		catch (const std::exception& e) {
+			LogWarning("Session refresh failed: %s", e.what());
+			if (session->isRefreshExpired()) {
+				m_sessionStore.Clear();
+				m_sessionRefreshAt = std::chrono::steady_clock::time_point::max();
+			}
+			else {
+				m_sessionRefreshAt = std::chrono::steady_clock::now() + SESSION_REFRESH_RETRY;
+			}
+		}
+		m_refreshingSession = false;
+
+		std::vector<std::function<void(bool)>> waiters;
+		{
+			std::lock_guard<std::mutex> lock(m_sessionMutex);
+			waiters.swap(m_refreshWaiters);
+		}
+		for (auto& waiter : waiters) {
+			waiter(success);
+		}
+	});
+}
+
+Task<Nakama::NSessionPtr> NakamaX4Client::RefreshSession(Nakama::NSessionPtr session) {
+	auto client = m_client;
+	co_return co_await NakamaCall<Nakama::NSessionPtr>([client, session](auto onSuccess, auto onError) {
+		client->authenticateRefresh(session, onSuccess, onError);
+	});
 }
 
 NakamaX4Client::SyncResult
@@ -247,79 +575,263 @@ NakamaX4Client::SyncPlayerData(const std::string& playerName, long long credits,
 		return { false, "Client not initialized" };
 	}
 
-	if (m_syncing) {
-		return { false, "Sync already in progress" };
-	}
-
-	if (!m_session) {
+	if (!Session()) {
 		return { false, "Not authenticated" };
 	}
 
-	LogInfo("Starting data sync for player: %s", playerName.c_str());
-	return PerformDataSync(playerName, credits, playtime);
+	if (StagePlayerData(playerName, credits, playtime)) {
+		LogInfo("Starting data sync for player: %s", playerName.c_str());
+	}
+	return PerformDataSync();
 }
 
+// Waits for everything staged so far to be written. The caller is blocked,
+// so the batch goes out now rather than after the coalescing delay.
 NakamaX4Client::SyncResult
-NakamaX4Client::PerformDataSync(const std::string& playerName,
-	long long credits, long long playtime) {
-	m_syncing = true;
+NakamaX4Client::PerformDataSync() {
+	auto written = std::make_shared<std::promise<SyncResult>>();
+	auto future = written->get_future();
+	m_storage.WhenFlushed([written](bool success, const std::string& error) {
+		written->set_value({ success, error });
+	});
+	m_storage.RequestFlush();
+	m_network.Wake();
+
+	if (AwaitNetwork(future, SYNC_TIMEOUT) != std::future_status::ready) {
+		LogError("Data sync timeout");
+		return { false, "Sync timeout" };
+	}
+	SyncResult result = future.get();
+	if (!result.success) {
+		LogError("Data sync failed: %s", result.errorMessage.c_str());
+	}
+	return result;
+}
+
+bool NakamaX4Client::StagePlayerData(const std::string& playerName, long long credits, long long playtime) {
+	const auto now = std::chrono::steady_clock::now();
+	bool changed = m_storage.Set(PLAYER_DATA_COLLECTION, playerName, "credits", credits, now);
+	changed = m_storage.Set(PLAYER_DATA_COLLECTION, playerName, "playtime", playtime, now) || changed;
+	if (changed) {
+		m_storage.Set(PLAYER_DATA_COLLECTION, playerName, "last_update", static_cast<long long>(std::time(nullptr)), now);
+		m_journal.Append(PLAYER_DATA_COLLECTION, playerName, m_storage.Value(PLAYER_DATA_COLLECTION, playerName), now);
+	}
+	return changed;
+}
+
+// Writes that never reached the server last time go out with the first
+// flush after authentication
+void NakamaX4Client::OpenStorageJournal() {
+	const std::string path = LogToX4::GetLogDir() + "\\" + STORAGE_JOURNAL_FILE;
+	if (!m_journal.Open(path)) {
+		LogWarning("Could not open storage journal %s; unsent writes will not survive a restart", path.c_str());
+		return;
+	}
+
+	const auto pending = m_journal.Pending();
+	if (pending.empty()) {
+		return;
+	}
+	LogInfo("Replaying %zu journaled storage write(s)", pending.size());
+	const auto now = std::chrono::steady_clock::now();
+	for (const auto& entry : pending) {
+		m_storage.Restore(entry.collection, entry.key, entry.value, now);
+	}
+	m_storage.RequestFlush();
+}
+
+// Runs on the network thread; the cache allows one batch in flight
+void NakamaX4Client::StartStorageFlush(Nakama::NSessionPtr session) {
+	// Journal records appended from here on may not be in the batch
+	const std::uint64_t journaled = m_journal.LastSequence();
+	auto batch = m_storage.TakeBatch();
+	if (batch.empty()) {
+		return;
+	}
+	LogInfo("Writing %zu storage object(s)", batch.size());
+	StartTask(WriteStorageBatch(std::move(session), std::move(batch), journaled), [this](std::future<void> result) {
+		try {
+			result.get();
+		}
+		catch (const std::exception& e) {
+			LogError("Storage write failed: %s", e.what());
+			m_storage.FailBatch(false, e.what(), std::chrono::steady_clock::now());
+		}
+	});
+}
+
+Task<void> NakamaX4Client::WriteStorageBatch(Nakama::NSessionPtr session, std::vector<StorageCache::Write> batch,
+	std::uint64_t journaled) {
+	std::vector<Nakama::NStorageObjectWrite> objects;
+	objects.reserve(batch.size());
+	for (const auto& write : batch) {
+		Nakama::NStorageObjectWrite object;
+		object.collection = write.collection;
+		object.key = write.key;
+		object.value = write.value;
+		object.version = write.version;
+		object.permissionRead = Nakama::NStoragePermissionRead::OWNER_READ;
+		object.permissionWrite = Nakama::NStoragePermissionWrite::OWNER_WRITE;
+		objects.push_back(std::move(object));
+	}
 
+	auto client = m_client;
 	try {
-		LogInfo("Syncing player data...");
-
-		// Create JSON data
-		std::string json_data = "{"
-			"\"credits\":" +
-			std::to_string(credits) +
-			","
-			"\"playtime\":" +
-			std::to_string(playtime) +
-			","
-			"\"last_update\":" +
-			std::to_string(std::time(nullptr)) + "}";
-
-		auto future = std::make_shared<std::promise<SyncResult>>();
-
-		auto successCallback = [this,
-			future](const Nakama::NStorageObjectAcks& acks) {
-			LogInfo("Data sync successful");
-			m_syncing = false;
-			future->set_value({ true, "" });
-			};
-
-		auto errorCallback = [this, future](const Nakama::NError& error) {
-			LogError("Data sync failed: %s", error.message.c_str());
-			m_syncing = false;
-			future->set_value({ false, error.message });
-			};
-
-		Nakama::NStorageObjectWrite writeObject;
-		writeObject.collection = "player_data";
-		writeObject.key = playerName;
-		writeObject.value = json_data;
-		writeObject.permissionRead = Nakama::NStoragePermissionRead::OWNER_READ;
-		writeObject.permissionWrite = Nakama::NStoragePermissionWrite::OWNER_WRITE;
-
-		std::vector<Nakama::NStorageObjectWrite> objects = { writeObject };
-		m_client->writeStorageObjects(m_session, objects, successCallback,
-			errorCallback);
-
-		// Wait for result with timeout
-		auto fut = future->get_future();
-		auto future_status = fut.wait_for(std::chrono::seconds(5));
-		if (future_status == std::future_status::timeout) {
-			LogError("Data sync timeout");
-			m_syncing = false;
-			return { false, "Sync timeout" };
+		const Nakama::NStorageObjectAcks acks = co_await NakamaCall<Nakama::NStorageObjectAcks>(
+			[client, session, objects](auto onSuccess, auto onError) {
+				client->writeStorageObjects(session, objects, onSuccess, onError);
+			});
+		std::vector<StorageCache::Ack> cacheAcks;
+		cacheAcks.reserve(acks.size());
+		for (const auto& ack : acks) {
+			cacheAcks.push_back({ ack.collection, ack.key, ack.version });
+		}
+		m_storage.CompleteBatch(cacheAcks);
+		for (const auto& write : batch) {
+			m_journal.Acknowledge(write.collection, write.key, journaled);
 		}
+		LogInfo("Data sync successful");
+		co_return;
+	}
+	catch (const NakamaError& e) {
+		// The server rejects the whole batch when a version check fails;
+		// other invalid writes would fail the same way on every retry
+		if (e.Code() != static_cast<int>(Nakama::ErrorCode::InvalidArgument)
+			|| std::string(e.what()).find("version check failed") == std::string::npos) {
+			throw;
+		}
+	}
 
-		return fut.get();
+	// Written elsewhere since our last write. The game's copy stays
+	// authoritative: read the current versions and write over them.
+	LogWarning("Storage version conflict; refreshing %zu object version(s)", batch.size());
+	std::vector<Nakama::NReadStorageObjectId> ids;
+	ids.reserve(batch.size());
+	for (const auto& write : batch) {
+		ids.push_back({ write.collection, write.key, session->getUserId() });
 	}
-	catch (const std::exception& e) {
-		LogError("Data sync exception: %s", e.what());
-		m_syncing = false;
-		return { false, std::string("Exception: ") + e.what() };
+	const Nakama::NStorageObjects current = co_await NakamaCall<Nakama::NStorageObjects>(
+		[client, session, ids](auto onSuccess, auto onError) {
+			client->readStorageObjects(session, ids, onSuccess, onError);
+		});
+	for (const auto& write : batch) {
+		// Deleted objects are written unconditionally again
+		auto found = std::find_if(current.begin(), current.end(), [&write](const Nakama::NStorageObject& object) {
+			return object.collection == write.collection && object.key == write.key;
+		});
+		m_storage.SetVersion(write.collection, write.key, found != current.end() ? found->version : "");
+	}
+	m_storage.FailBatch(true, "version conflict", std::chrono::steady_clock::now());
+}
+
+int NakamaX4Client::AuthenticateAsync(const std::string& deviceId, const std::string& username) {
+	if (!IsInitialized() || !m_client) {
+		return FailedOperation("authenticate", "Client not initialized");
+	}
+	if (HasSessionFor(deviceId)) {
+		LogInfo("Using the restored session for device %s", deviceId.c_str());
+		return SucceededOperation("authenticate");
+	}
+	if (m_authenticating.exchange(true)) {
+		return FailedOperation("authenticate", "Authentication already in progress");
+	}
+
+	LogInfo("Starting authentication (device=%s, username=%s)", deviceId.c_str(),
+		username.c_str());
+	// Cancelling or timing out the operation cancels the task with it
+	CancellationSource cancel(m_tasks.Token());
+	const int handle = m_operations.Begin("authenticate", std::chrono::steady_clock::now() + AUTH_TIMEOUT,
+		[this, cancel]() mutable {
+			cancel.Cancel();
+			m_authenticating = false;
+		});
+	Spawn<Nakama::NSessionPtr>(m_network, AuthenticateDevice(deviceId, username),
+		[this, handle, deviceId](std::future<Nakama::NSessionPtr> result) {
+			try {
+				auto session = result.get();
+				// Only a still-running operation owns the flag and may apply
+				// the session
+				if (m_operations.Complete(handle, true, "", [&]() { SetSession(session); })) {
+					AdoptSession(session, deviceId);
+					m_authenticating = false;
+				}
+			}
+			catch (const TaskCancelled&) {
+				// The operation was cancelled or expired first
+			}
+			catch (const std::exception& e) {
+				LogError("Authentication failed: %s", e.what());
+				if (m_operations.Complete(handle, false, e.what())) {
+					m_authenticating = false;
+				}
+			}
+		},
+		cancel.Token());
+	m_operations.SetProgress(handle, REQUEST_SENT_PROGRESS);
+	return handle;
+}
+
+int NakamaX4Client::SyncPlayerDataAsync(const std::string& playerName, long long credits, long long playtime) {
+	if (!IsInitialized() || !m_client) {
+		return FailedOperation("sync", "Client not initialized");
 	}
+	if (!Session()) {
+		return FailedOperation("sync", "Not authenticated");
+	}
+
+	// Completes once the staged values are written: right away if nothing
+	// changed, otherwise with the next coalesced batch
+	if (StagePlayerData(playerName, credits, playtime)) {
+		LogInfo("Starting data sync for player: %s", playerName.c_str());
+	}
+	const int handle = m_operations.Begin("sync", std::chrono::steady_clock::now() + SYNC_TIMEOUT);
+	m_storage.WhenFlushed([this, handle](bool success, const std::string& error) {
+		m_operations.Complete(handle, success, error);
+	});
+	m_network.Wake();
+	return handle;
+}
+
+int NakamaX4Client::FailedOperation(const std::string& kind, const std::string& error) {
+	const int handle = m_operations.Begin(kind, std::chrono::steady_clock::time_point::max());
+	m_operations.Complete(handle, false, error);
+	return handle;
+}
+
+int NakamaX4Client::SucceededOperation(const std::string& kind) {
+	const int handle = m_operations.Begin(kind, std::chrono::steady_clock::time_point::max());
+	m_operations.Complete(handle, true);
+	return handle;
+}
+
+std::string NakamaX4Client::GetOperationState(int handle) const {
+	return AsyncOperationTable::StateName(m_operations.Get(handle).state);
+}
+
+float NakamaX4Client::GetOperationProgress(int handle) const {
+	return m_operations.Get(handle).progress;
+}
+
+std::string NakamaX4Client::GetOperationError(int handle) const {
+	return m_operations.Get(handle).error;
+}
+
+bool NakamaX4Client::CancelOperation(int handle) {
+	return m_operations.Cancel(handle);
+}
+
+void NakamaX4Client::ReleaseOperation(int handle) {
+	m_operations.Release(handle);
+}
+
+bool NakamaX4Client::IsAuthenticated() const { return Session() != nullptr; }
+
+Nakama::NSessionPtr NakamaX4Client::Session() const {
+	std::lock_guard<std::mutex> lock(m_sessionMutex);
+	return m_session;
 }
 
-bool NakamaX4Client::IsAuthenticated() const { return m_session != nullptr; }
\ No newline at end of file
+void NakamaX4Client::SetSession(Nakama::NSessionPtr session) {
+	std::lock_guard<std::mutex> lock(m_sessionMutex);
+	m_session = std::move(session);
+}
\ No newline at end of file
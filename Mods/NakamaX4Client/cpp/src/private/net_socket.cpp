@@ -0,0 +1,255 @@
+#include "../public/net_socket.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <mutex>
+
+namespace
+{
+#ifdef _WIN32
+    using NativeSocket = SOCKET;
+    using PollFd = WSAPOLLFD;
+    int NativePoll(PollFd* fds, size_t count, int timeoutMs) { return WSAPoll(fds, static_cast<ULONG>(count), timeoutMs); }
+    bool IsWouldBlock(int error) { return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS; }
+#else
+    using NativeSocket = int;
+    using PollFd = pollfd;
+    int NativePoll(PollFd* fds, size_t count, int timeoutMs) { return poll(fds, static_cast<nfds_t>(count), timeoutMs); }
+    bool IsWouldBlock(int error) { return error == EWOULDBLOCK || error == EAGAIN || error == EINPROGRESS; }
+#endif
+
+    NativeSocket Native(NetSocket::Handle socket) { return static_cast<NativeSocket>(socket); }
+    NetSocket::Handle Wrap(NativeSocket socket) { return static_cast<NetSocket::Handle>(socket); }
+
+    bool SetNonBlocking(NativeSocket socket) {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+        const int flags = fcntl(socket, F_GETFL, 0);
+        return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    sockaddr_in LoopbackAddress(std::uint16_t port) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        return address;
+    }
+}
+
+bool NetSocket::Startup() {
+#ifdef _WIN32
+    static std::once_flag once;
+    static bool started = false;
+    std::call_once(once, []() {
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    });
+    return started;
+#else
+    return true;
+#endif
+}
+
+void NetSocket::Close(Handle socket) {
+    if (socket == INVALID_HANDLE) {
+        return;
+    }
+#ifdef _WIN32
+    closesocket(Native(socket));
+#else
+    ::close(Native(socket));
+#endif
+}
+
+int NetSocket::LastError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+NetSocket::Handle NetSocket::ConnectNonBlocking(const std::string& host, int port, std::string& error) {
+    if (!Startup()) {
+        error = "socket startup failed";
+        return INVALID_HANDLE;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo* results = nullptr;
+    const std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &results) != 0 || !results) {
+        error = "cannot resolve " + host;
+        return INVALID_HANDLE;
+    }
+
+    Handle connected = INVALID_HANDLE;
+    for (addrinfo* it = results; it && connected == INVALID_HANDLE; it = it->ai_next) {
+        const NativeSocket socket = ::socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+        if (Wrap(socket) == INVALID_HANDLE) {
+            continue;
+        }
+        // Small frames must not wait for Nagle coalescing
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        if (!SetNonBlocking(socket) ||
+            (::connect(socket, it->ai_addr, static_cast<int>(it->ai_addrlen)) != 0 && !IsWouldBlock(LastError()))) {
+            Close(Wrap(socket));
+            continue;
+        }
+        connected = Wrap(socket);
+    }
+    freeaddrinfo(results);
+
+    if (connected == INVALID_HANDLE) {
+        error = "cannot connect to " + host + ":" + service;
+    }
+    return connected;
+}
+
+int NetSocket::ConnectError(Handle socket) {
+    int error = 0;
+#ifdef _WIN32
+    int length = sizeof(error);
+#else
+    socklen_t length = sizeof(error);
+#endif
+    if (getsockopt(Native(socket), SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) != 0) {
+        return LastError();
+    }
+    return error;
+}
+
+int NetSocket::Send(Handle socket, const char* data, size_t size, bool& wouldBlock) {
+#ifdef _WIN32
+    const int sent = ::send(Native(socket), data, static_cast<int>(size), 0);
+#else
+    const int sent = static_cast<int>(::send(Native(socket), data, size, MSG_NOSIGNAL));
+#endif
+    wouldBlock = sent < 0 && IsWouldBlock(LastError());
+    return sent;
+}
+
+int NetSocket::Recv(Handle socket, char* data, size_t size, bool& wouldBlock) {
+#ifdef _WIN32
+    const int received = ::recv(Native(socket), data, static_cast<int>(size), 0);
+#else
+    const int received = static_cast<int>(::recv(Native(socket), data, size, 0));
+#endif
+    wouldBlock = received < 0 && IsWouldBlock(LastError());
+    return received;
+}
+
+int NetSocket::Poll(PollEntry* entries, size_t count, int timeoutMs) {
+    // At most a handful of sockets per call; keeps the hot path off the heap
+    constexpr size_t MAX_ENTRIES = 8;
+    if (count > MAX_ENTRIES) {
+        return -1;
+    }
+    PollFd fds[MAX_ENTRIES]{};
+    for (size_t i = 0; i < count; ++i) {
+        fds[i].fd = Native(entries[i].socket);
+        fds[i].events = static_cast<short>((entries[i].wantRead ? POLLIN : 0) | (entries[i].wantWrite ? POLLOUT : 0));
+    }
+
+    const int ready = NativePoll(fds, count, timeoutMs);
+    for (size_t i = 0; i < count; ++i) {
+        entries[i].readable = ready > 0 && (fds[i].revents & POLLIN) != 0;
+        entries[i].writable = ready > 0 && (fds[i].revents & POLLOUT) != 0;
+        entries[i].failed = ready > 0 && (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+    }
+    return ready;
+}
+
+NetSocket::Handle NetSocket::CreateWakeSocket() {
+    if (!Startup()) {
+        return INVALID_HANDLE;
+    }
+    const NativeSocket socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (Wrap(socket) == INVALID_HANDLE) {
+        return INVALID_HANDLE;
+    }
+
+    sockaddr_in address = LoopbackAddress(0);
+#ifdef _WIN32
+    int length = sizeof(address);
+#else
+    socklen_t length = sizeof(address);
+#endif
+    if (::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) != 0 ||
+        ::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        !SetNonBlocking(socket)) {
+        Close(Wrap(socket));
+        return INVALID_HANDLE;
+    }
+    return Wrap(socket);
+}
+
+void NetSocket::SignalWake(Handle wakeSocket) {
+    const char byte = 1;
+    bool wouldBlock = false;
+    // A full buffer already means a wake is pending
+    Send(wakeSocket, &byte, 1, wouldBlock);
+}
+
+void NetSocket::DrainWake(Handle wakeSocket) {
+    char buffer[64];
+    bool wouldBlock = false;
+    while (Recv(wakeSocket, buffer, sizeof(buffer), wouldBlock) > 0) {
+    }
+}
+
+NetSocket::Handle NetSocket::ListenLoopback(int& port) {
+    if (!Startup()) {
+        return INVALID_HANDLE;
+    }
+    const NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (Wrap(socket) == INVALID_HANDLE) {
+        return INVALID_HANDLE;
+    }
+
+    sockaddr_in address = LoopbackAddress(0);
+#ifdef _WIN32
+    int length = sizeof(address);
+#else
+    socklen_t length = sizeof(address);
+#endif
+    if (::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(socket, 4) != 0 ||
+        getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        Close(Wrap(socket));
+        return INVALID_HANDLE;
+    }
+    port = ntohs(address.sin_port);
+    return Wrap(socket);
+}
+
+NetSocket::Handle NetSocket::Accept(Handle listener) {
+    const NativeSocket socket = ::accept(Native(listener), nullptr, nullptr);
+    if (Wrap(socket) != INVALID_HANDLE) {
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    }
+    return Wrap(socket);
+}
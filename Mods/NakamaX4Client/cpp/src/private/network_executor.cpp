@@ -0,0 +1,155 @@
+#include "../public/network_executor.h"
+#include <algorithm>
+
+// Longest single wait; bounds the cost of a lost wake signal
+constexpr auto MAX_WAIT = std::chrono::milliseconds(1000);
+
+NetworkExecutor::~NetworkExecutor() { Stop(); }
+
+bool NetworkExecutor::Start(TickFunction tick, SocketWait socketWait, SocketWake socketWake) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running || m_thread.joinable()) {
+        return false;
+    }
+    m_tick = std::move(tick);
+    m_socketWait = std::move(socketWait);
+    m_socketWake = std::move(socketWake);
+    m_stopRequested = false;
+    m_wakeRequested = true; // Tick once right away
+    m_running = true;
+    m_thread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void NetworkExecutor::Stop() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+        thread = std::move(m_thread);
+    }
+    if (!thread.joinable()) {
+        return;
+    }
+    Wake();
+
+    if (thread.get_id() == std::this_thread::get_id()) {
+        // Stopped from inside a tick or work item: cannot join ourselves
+        thread.detach();
+        return;
+    }
+    thread.join();
+}
+
+bool NetworkExecutor::IsRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+bool NetworkExecutor::IsExecutorThread() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_thread.get_id() == std::this_thread::get_id();
+}
+
+void NetworkExecutor::Post(Work work) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_work.push_back(std::move(work));
+    }
+    Wake();
+}
+
+void NetworkExecutor::PostAt(Clock::time_point when, Work work) {
+    bool earliest = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        earliest = m_timers.empty() || when < m_timers.top().when;
+        m_timers.push({ when, m_nextTimerSequence++, std::move(work) });
+    }
+    // A later timer is picked up when the current wait ends anyway
+    if (earliest) {
+        Wake();
+    }
+}
+
+void NetworkExecutor::Wake() {
+    SocketWake socketWake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeRequested = true;
+        ++m_stats.wakeups;
+        socketWake = m_socketWake;
+    }
+    m_condition.notify_one();
+    if (socketWake) {
+        socketWake();
+    }
+}
+
+NetworkExecutor::Stats NetworkExecutor::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+NetworkExecutor::Clock::time_point NetworkExecutor::RunPending(Clock::time_point now) {
+    std::vector<Work> work;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        work.swap(m_work);
+        while (!m_timers.empty() && m_timers.top().when <= now) {
+            work.push_back(m_timers.top().work);
+            m_timers.pop();
+        }
+        m_stats.workItems += work.size();
+    }
+    for (auto& item : work) {
+        item();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_timers.empty() ? Clock::time_point::max() : m_timers.top().when;
+}
+
+void NetworkExecutor::Run() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopRequested) {
+                break;
+            }
+            m_wakeRequested = false;
+        }
+
+        Clock::time_point deadline = RunPending(Clock::now());
+        deadline = std::min(deadline, m_tick(Clock::now()));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.ticks;
+        }
+
+        // Sleep until the deadline unless something arrived meanwhile
+        const auto now = Clock::now();
+        if (deadline <= now) {
+            continue;
+        }
+        const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(
+            std::min<Clock::duration>(deadline - now, MAX_WAIT));
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_wakeRequested || m_stopRequested) {
+                continue;
+            }
+        }
+        // A Wake after the check above still lands: the socket source keeps
+        // its wake signal readable and the condition checks the flag
+        if (m_socketWait && m_socketWait(timeout)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait_for(lock, timeout, [this]() { return m_wakeRequested || m_stopRequested; });
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+}
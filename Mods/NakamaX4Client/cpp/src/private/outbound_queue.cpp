@@ -0,0 +1,114 @@
+#include "../public/outbound_queue.h"
+#include <utility>
+
+void OutboundQueue::Enqueue(std::int64_t opCode, std::string_view payload, bool replaceable) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    OpCodeCounters& counters = m_counters[opCode];
+    ++counters.enqueued;
+
+    if (replaceable) {
+        for (auto& entry : m_pending) {
+            if (entry.replaceable && entry.opCode == opCode) {
+                // Keep the slot (and its order), overwrite in place
+                entry.payload.assign(payload.data(), payload.size());
+                ++counters.merged;
+                return;
+            }
+        }
+    }
+
+    std::string buffer = AcquireBuffer();
+    buffer.assign(payload.data(), payload.size());
+    m_pending.push_back({ opCode, replaceable, std::move(buffer) });
+}
+
+size_t OutboundQueue::Flush(const SendFunction& send) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending.empty()) {
+            return 0;
+        }
+        m_flushing.swap(m_pending);
+    }
+
+    // The socket write happens outside the lock so the game thread never
+    // waits on it. A failed send drops the rest of this batch; state updates
+    // are superseded next tick anyway.
+    std::map<std::int64_t, std::pair<std::uint64_t, std::uint64_t>> sentByOpCode;
+    size_t count = 0;
+    auto finish = [&]() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& pair : sentByOpCode) {
+            OpCodeCounters& counters = m_counters[pair.first];
+            counters.sent += pair.second.first;
+            counters.bytes += pair.second.second;
+        }
+        for (auto& entry : m_flushing) {
+            ReleaseBuffer(std::move(entry.payload));
+        }
+        m_flushing.clear();
+    };
+
+    try {
+        for (const auto& entry : m_flushing) {
+            send(entry.opCode, entry.payload);
+            auto& sent = sentByOpCode[entry.opCode];
+            ++sent.first;
+            sent.second += entry.payload.size();
+            ++count;
+        }
+    }
+    catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    return count;
+}
+
+void OutboundQueue::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_pending) {
+        ReleaseBuffer(std::move(entry.payload));
+    }
+    m_pending.clear();
+}
+
+size_t OutboundQueue::PendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+OpCodeCounters OutboundQueue::GetCounters(std::int64_t opCode) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_counters.find(opCode);
+    return it != m_counters.end() ? it->second : OpCodeCounters{};
+}
+
+std::map<std::int64_t, OpCodeCounters> OutboundQueue::GetAllCounters() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counters;
+}
+
+size_t OutboundQueue::PooledBufferCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pool.size();
+}
+
+// Caller holds m_mutex
+std::string OutboundQueue::AcquireBuffer() {
+    if (m_pool.empty()) {
+        return {};
+    }
+    std::string buffer = std::move(m_pool.back());
+    m_pool.pop_back();
+    return buffer;
+}
+
+// Caller holds m_mutex
+void OutboundQueue::ReleaseBuffer(std::string&& buffer) {
+    if (m_pool.size() < MAX_POOLED_BUFFERS) {
+        buffer.clear(); // keeps capacity
+        m_pool.push_back(std::move(buffer));
+    }
+}
@@ -0,0 +1,490 @@
+#include "../public/poll_websocket_transport.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using Nakama::NRtClientDisconnectInfo;
+using WebsocketCodec::Opcode;
+
+// Give up on a connect or upgrade that has not completed in this time
+constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(10);
+// Upper bound on the upgrade response header block
+constexpr size_t MAX_HANDSHAKE_SIZE = 16 * 1024;
+// Frame header (14 bytes max) on top of the largest payload we accept
+constexpr size_t MAX_FRAME_SIZE = PollWebsocketTransport::MAX_MESSAGE_SIZE + 14;
+
+namespace
+{
+    // Splits ws://host[:port][/target]; IPv6 hosts come in brackets
+    bool ParseUrl(const std::string& url, std::string& host, int& port, std::string& target, bool& secure) {
+        std::string_view rest(url);
+        if (rest.rfind("ws://", 0) == 0) {
+            secure = false;
+            rest.remove_prefix(5);
+        }
+        else if (rest.rfind("wss://", 0) == 0) {
+            secure = true;
+            rest.remove_prefix(6);
+        }
+        else {
+            return false;
+        }
+
+        const size_t slash = rest.find('/');
+        std::string_view authority = rest.substr(0, slash);
+        target = slash == std::string_view::npos ? "/" : std::string(rest.substr(slash));
+        port = secure ? 443 : 80;
+
+        size_t colon = std::string_view::npos;
+        if (!authority.empty() && authority.front() == '[') {
+            const size_t close = authority.find(']');
+            if (close == std::string_view::npos) {
+                return false;
+            }
+            host = std::string(authority.substr(1, close - 1));
+            colon = authority.find(':', close);
+        }
+        else {
+            colon = authority.find(':');
+            host = std::string(authority.substr(0, colon));
+        }
+        if (colon != std::string_view::npos) {
+            port = std::atoi(std::string(authority.substr(colon + 1)).c_str());
+        }
+        return !host.empty() && port > 0 && port < 65536;
+    }
+}
+
+PollWebsocketTransport::PollWebsocketTransport()
+    : m_wakeSocket(NetSocket::CreateWakeSocket()), m_rng(std::random_device{}()) {
+    m_receive.resize(RECEIVE_BUFFER_SIZE);
+    m_message.reserve(RECEIVE_BUFFER_SIZE);
+    m_sendBuffer.reserve(SEND_BUFFER_SIZE);
+}
+
+PollWebsocketTransport::~PollWebsocketTransport() {
+    CloseSocket();
+    NetSocket::Close(m_wakeSocket);
+}
+
+void PollWebsocketTransport::connect(const std::string& url, Nakama::NRtTransportType type) {
+    CloseSocket();
+    m_disconnectPending = false;
+    m_type = type;
+    m_connectStarted = std::chrono::steady_clock::now();
+    m_lastActivity = m_connectStarted;
+
+    bool secure = false;
+    if (!ParseUrl(url, m_host, m_port, m_target, secure)) {
+        ScheduleFailure(NRtClientDisconnectInfo::TRANSPORT_ERROR, "invalid websocket url");
+        return;
+    }
+    if (secure) {
+        ScheduleFailure(NRtClientDisconnectInfo::TLS_HANDSHAKE, "wss:// is not supported by this transport");
+        return;
+    }
+
+    std::string error;
+    const NetSocket::Handle socket = NetSocket::ConnectNonBlocking(m_host, m_port, error);
+    if (socket == NetSocket::INVALID_HANDLE) {
+        ScheduleFailure(NRtClientDisconnectInfo::TRANSPORT_ERROR, error);
+        return;
+    }
+
+    std::array<std::uint8_t, 16> nonce{};
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_socket = socket;
+        for (auto& byte : nonce) {
+            byte = static_cast<std::uint8_t>(m_rng());
+        }
+    }
+    m_clientKey = WebsocketCodec::MakeClientKey(nonce);
+    m_state = State::Connecting;
+}
+
+bool PollWebsocketTransport::isConnecting() {
+    const State state = m_state;
+    return state == State::Connecting || state == State::Handshaking;
+}
+
+void PollWebsocketTransport::disconnect() {
+    const State state = m_state;
+    if (state == State::Idle) {
+        return;
+    }
+    if (state == State::Open) {
+        // Best effort close frame with 1000 (normal closure)
+        const char code[2] = { static_cast<char>(0x03), static_cast<char>(0xE8) };
+        QueueFrame(Opcode::Close, std::string_view(code, sizeof(code)));
+        FlushSend();
+    }
+    CloseSocket();
+
+    // Reported from the next tick, never from inside disconnect(). A connect
+    // still in progress is cancelled without any callback.
+    if (state == State::Open) {
+        m_disconnectPending = true;
+        m_pendingDisconnect = NRtClientDisconnectInfo{};
+        m_pendingDisconnect.code = NRtClientDisconnectInfo::NORMAL_CLOSURE;
+        m_pendingError.clear();
+    }
+}
+
+bool PollWebsocketTransport::send(const Nakama::NBytes& data) {
+    if (m_state != State::Open) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (m_socket == NetSocket::INVALID_HANDLE) {
+        return false;
+    }
+    const WebsocketCodec::MaskKey mask = NextMaskLocked();
+    WebsocketCodec::AppendFrame(m_sendBuffer,
+        m_type == Nakama::NRtTransportType::Text ? Opcode::Text : Opcode::Binary, data, true, &mask);
+
+    // Write straight away; whatever the kernel does not take is finished by
+    // the network thread once the socket is writable again
+    FlushSendLocked();
+    if (m_sendOffset < m_sendBuffer.size() || m_sendFailed) {
+        NetSocket::SignalWake(m_wakeSocket);
+    }
+    return true;
+}
+
+void PollWebsocketTransport::tick() {
+    if (m_disconnectPending) {
+        m_disconnectPending = false;
+        if (!m_pendingError.empty()) {
+            fireOnError(m_pendingError);
+        }
+        fireOnDisconnected(m_pendingDisconnect);
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (m_state == State::Idle) {
+        return;
+    }
+
+    if (m_state == State::Connecting) {
+        NetSocket::PollEntry entry;
+        entry.socket = m_socket;
+        entry.wantWrite = true;
+        if (NetSocket::Poll(&entry, 1, 0) <= 0) {
+            if (now - m_connectStarted > CONNECT_TIMEOUT) {
+                Fail(NRtClientDisconnectInfo::TRANSPORT_ERROR, "connect timed out", false);
+            }
+            return;
+        }
+        const int error = NetSocket::ConnectError(m_socket);
+        if (error != 0 || entry.failed) {
+            Fail(NRtClientDisconnectInfo::TRANSPORT_ERROR,
+                "connect to " + m_host + ":" + std::to_string(m_port) + " failed (" + std::to_string(error) + ")", false);
+            return;
+        }
+
+        const std::string request = WebsocketCodec::BuildHandshakeRequest(m_host, m_port, m_target, m_clientKey);
+        {
+            std::lock_guard<std::mutex> lock(m_sendMutex);
+            m_sendBuffer.append(request);
+        }
+        m_state = State::Handshaking;
+    }
+
+    FlushSend();
+    if (m_sendFailed) {
+        Fail(NRtClientDisconnectInfo::TRANSPORT_ERROR, "socket write failed", false);
+        return;
+    }
+
+    ReadAvailable();
+    if (m_state == State::Idle) {
+        return;
+    }
+
+    if (m_state == State::Handshaking && now - m_connectStarted > CONNECT_TIMEOUT) {
+        Fail(NRtClientDisconnectInfo::TRANSPORT_ERROR, "websocket upgrade timed out", false);
+        return;
+    }
+    if (m_state == State::Open && m_activityTimeoutMs > 0 &&
+        now - m_lastActivity > std::chrono::milliseconds(m_activityTimeoutMs)) {
+        Fail(NRtClientDisconnectInfo::HEARTBEAT_FAILURE, "no data received within activity timeout", false);
+        return;
+    }
+
+    // Pongs and close replies queued while processing
+    FlushSend();
+}
+
+bool PollWebsocketTransport::WaitForActivity(std::chrono::milliseconds timeout) {
+    if (m_disconnectPending) {
+        return true;
+    }
+    if (m_wakeSocket == NetSocket::INVALID_HANDLE) {
+        // No wake socket (should not happen); degrade to a plain sleep
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+
+    NetSocket::PollEntry entries[2];
+    size_t count = 0;
+    entries[count].socket = m_wakeSocket;
+    entries[count].wantRead = true;
+    ++count;
+
+    const State state = m_state;
+    if (state != State::Idle && m_socket != NetSocket::INVALID_HANDLE) {
+        entries[count].socket = m_socket;
+        entries[count].wantRead = state != State::Connecting;
+        entries[count].wantWrite = state == State::Connecting || HasPendingSend();
+        ++count;
+    }
+
+    const int ready = NetSocket::Poll(entries, count, static_cast<int>(timeout.count()));
+    if (entries[0].readable) {
+        NetSocket::DrainWake(m_wakeSocket);
+    }
+    return ready > 0;
+}
+
+void PollWebsocketTransport::Wake() {
+    NetSocket::SignalWake(m_wakeSocket);
+}
+
+void PollWebsocketTransport::CloseSocket() {
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        NetSocket::Close(m_socket);
+        m_socket = NetSocket::INVALID_HANDLE;
+        m_sendBuffer.clear();
+        m_sendOffset = 0;
+        m_sendFailed = false;
+    }
+    m_state = State::Idle;
+    ++m_generation;
+    m_receiveUsed = 0;
+    m_inMessage = false;
+    m_message.clear();
+}
+
+void PollWebsocketTransport::Fail(std::uint16_t code, const std::string& reason, bool remote) {
+    CloseSocket();
+    NRtClientDisconnectInfo info;
+    info.code = code;
+    info.reason = reason;
+    info.remote = remote;
+    if (!remote) {
+        fireOnError(reason);
+    }
+    fireOnDisconnected(info);
+}
+
+void PollWebsocketTransport::ScheduleFailure(std::uint16_t code, const std::string& reason) {
+    CloseSocket();
+    m_disconnectPending = true;
+    m_pendingDisconnect = NRtClientDisconnectInfo{};
+    m_pendingDisconnect.code = code;
+    m_pendingDisconnect.reason = reason;
+    m_pendingError = reason;
+}
+
+void PollWebsocketTransport::ReadAvailable() {
+    while (m_state == State::Handshaking || m_state == State::Open) {
+        if (m_receiveUsed == m_receive.size()) {
+            // A single frame larger than the buffer; grow once for it
+            if (m_receive.size() >= MAX_FRAME_SIZE) {
+                Fail(NRtClientDisconnectInfo::MESSAGE_TOO_BIG, "frame too large", false);
+                return;
+            }
+            m_receive.resize(std::min(MAX_FRAME_SIZE, m_receive.size() * 2));
+        }
+
+        bool wouldBlock = false;
+        const int received = NetSocket::Recv(m_socket, m_receive.data() + m_receiveUsed,
+            m_receive.size() - m_receiveUsed, wouldBlock);
+        if (received > 0) {
+            m_receiveUsed += static_cast<size_t>(received);
+            m_lastActivity = std::chrono::steady_clock::now();
+            if (m_state == State::Handshaking) {
+                ProcessHandshake();
+            }
+            if (m_state == State::Open) {
+                ProcessFrames();
+            }
+            continue;
+        }
+        if (received == 0) {
+            Fail(NRtClientDisconnectInfo::ABNORMAL_CLOSURE, "connection closed by server", true);
+            return;
+        }
+        if (!wouldBlock) {
+            Fail(NRtClientDisconnectInfo::TRANSPORT_ERROR,
+                "socket read failed (" + std::to_string(NetSocket::LastError()) + ")", false);
+        }
+        return;
+    }
+}
+
+void PollWebsocketTransport::ProcessHandshake() {
+    const std::string_view received(m_receive.data(), m_receiveUsed);
+    const size_t end = received.find("\r\n\r\n");
+    if (end == std::string_view::npos) {
+        if (m_receiveUsed > MAX_HANDSHAKE_SIZE) {
+            Fail(NRtClientDisconnectInfo::PROTOCOL_ERROR, "websocket upgrade response too large", false);
+        }
+        return;
+    }
+
+    const size_t headerSize = end + 4;
+    if (!WebsocketCodec::ValidateHandshakeResponse(received.substr(0, headerSize), m_clientKey)) {
+        Fail(NRtClientDisconnectInfo::PROTOCOL_ERROR, "websocket upgrade rejected", false);
+        return;
+    }
+
+    // Frames may follow the header in the same read
+    std::memmove(m_receive.data(), m_receive.data() + headerSize, m_receiveUsed - headerSize);
+    m_receiveUsed -= headerSize;
+    m_state = State::Open;
+    fireOnConnected();
+}
+
+void PollWebsocketTransport::ProcessFrames() {
+    const std::uint64_t generation = m_generation;
+    size_t offset = 0;
+    while (offset < m_receiveUsed) {
+        WebsocketCodec::Frame frame;
+        const auto result = WebsocketCodec::ParseFrame(m_receive.data() + offset, m_receiveUsed - offset,
+            MAX_MESSAGE_SIZE, frame);
+        if (result == WebsocketCodec::ParseResult::NeedMore) {
+            break;
+        }
+        if (result == WebsocketCodec::ParseResult::Error) {
+            Fail(NRtClientDisconnectInfo::PROTOCOL_ERROR, "malformed websocket frame", false);
+            return;
+        }
+        offset += frame.frameSize;
+
+        // Callbacks may disconnect (or even reconnect) this transport; the
+        // buffer belongs to the new connection then
+        if (!HandleFrame(frame) || generation != m_generation) {
+            return;
+        }
+    }
+
+    if (offset > 0) {
+        std::memmove(m_receive.data(), m_receive.data() + offset, m_receiveUsed - offset);
+        m_receiveUsed -= offset;
+    }
+}
+
+bool PollWebsocketTransport::HandleFrame(const WebsocketCodec::Frame& frame) {
+    switch (frame.opcode) {
+    case Opcode::Text:
+    case Opcode::Binary:
+        if (m_inMessage) {
+            Fail(NRtClientDisconnectInfo::PROTOCOL_ERROR, "new message inside a fragmented one", false);
+            return false;
+        }
+        m_message.assign(frame.payload.data(), frame.payload.size());
+        m_inMessage = !frame.fin;
+        if (frame.fin) {
+            fireOnMessage(m_message);
+        }
+        return true;
+
+    case Opcode::Continuation:
+        if (!m_inMessage) {
+            Fail(NRtClientDisconnectInfo::PROTOCOL_ERROR, "continuation without a message", false);
+            return false;
+        }
+        if (m_message.size() + frame.payload.size() > MAX_MESSAGE_SIZE) {
+            Fail(NRtClientDisconnectInfo::MESSAGE_TOO_BIG, "message too large", false);
+            return false;
+        }
+        m_message.append(frame.payload.data(), frame.payload.size());
+        if (frame.fin) {
+            m_inMessage = false;
+            fireOnMessage(m_message);
+        }
+        return true;
+
+    case Opcode::Ping:
+        QueueFrame(Opcode::Pong, frame.payload);
+        return true;
+
+    case Opcode::Pong:
+        return true;
+
+    case Opcode::Close: {
+        NRtClientDisconnectInfo info;
+        info.remote = true;
+        info.code = NRtClientDisconnectInfo::NO_STATUS_RCVD;
+        if (frame.payload.size() >= 2) {
+            info.code = static_cast<std::uint16_t>((static_cast<std::uint8_t>(frame.payload[0]) << 8) |
+                static_cast<std::uint8_t>(frame.payload[1]));
+            info.reason.assign(frame.payload.substr(2));
+        }
+        // Echo the status code to complete the closing handshake
+        QueueFrame(Opcode::Close, frame.payload.substr(0, std::min<size_t>(2, frame.payload.size())));
+        FlushSend();
+        CloseSocket();
+        fireOnDisconnected(info);
+        return false;
+    }
+
+    default:
+        Fail(NRtClientDisconnectInfo::PROTOCOL_ERROR, "unknown websocket opcode", false);
+        return false;
+    }
+}
+
+void PollWebsocketTransport::QueueFrame(Opcode opcode, std::string_view payload) {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    const WebsocketCodec::MaskKey mask = NextMaskLocked();
+    WebsocketCodec::AppendFrame(m_sendBuffer, opcode, payload, true, &mask);
+}
+
+void PollWebsocketTransport::FlushSend() {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    FlushSendLocked();
+}
+
+void PollWebsocketTransport::FlushSendLocked() {
+    while (m_socket != NetSocket::INVALID_HANDLE && m_sendOffset < m_sendBuffer.size()) {
+        bool wouldBlock = false;
+        const int sent = NetSocket::Send(m_socket, m_sendBuffer.data() + m_sendOffset,
+            m_sendBuffer.size() - m_sendOffset, wouldBlock);
+        if (sent > 0) {
+            m_sendOffset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (!wouldBlock) {
+            m_sendFailed = true; // Reported by the network thread
+        }
+        break;
+    }
+
+    if (m_sendOffset == m_sendBuffer.size()) {
+        // clear() keeps the capacity
+        m_sendBuffer.clear();
+        m_sendOffset = 0;
+    }
+    else if (m_sendOffset > m_sendBuffer.size() / 2) {
+        m_sendBuffer.erase(0, m_sendOffset);
+        m_sendOffset = 0;
+    }
+}
+
+bool PollWebsocketTransport::HasPendingSend() {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    return m_sendOffset < m_sendBuffer.size();
+}
+
+WebsocketCodec::MaskKey PollWebsocketTransport::NextMaskLocked() {
+    const std::uint32_t value = m_rng();
+    return { static_cast<std::uint8_t>(value), static_cast<std::uint8_t>(value >> 8),
+        static_cast<std::uint8_t>(value >> 16), static_cast<std::uint8_t>(value >> 24) };
+}
@@ -0,0 +1,675 @@
+#include "../public/pooled_http_transport.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+using Nakama::NHttpReqMethod;
+using Nakama::NHttpResponse;
+using Nakama::NHttpResponsePtr;
+namespace InternalStatusCodes = Nakama::InternalStatusCodes;
+using Clock = std::chrono::steady_clock;
+
+// Upper bound on a response header block
+constexpr size_t MAX_HEADER_SIZE = 64 * 1024;
+// Initial per-connection receive buffer; kept across responses
+constexpr size_t RECEIVE_BUFFER_SIZE = 16 * 1024;
+
+namespace
+{
+    enum class Phase { Headers, Body, BodyUntilClose, ChunkSize, ChunkData, ChunkTrailer };
+
+    // Safe to resend or to pipeline (RFC 9110 9.2.2)
+    bool IsIdempotent(NHttpReqMethod method) {
+        return method != NHttpReqMethod::POST;
+    }
+
+    const char* MethodName(NHttpReqMethod method) {
+        switch (method) {
+        case NHttpReqMethod::GET: return "GET";
+        case NHttpReqMethod::PUT: return "PUT";
+        case NHttpReqMethod::DEL: return "DELETE";
+        default: return "POST";
+        }
+    }
+
+    void AppendUrlEncoded(std::string& out, const std::string& value) {
+        static constexpr char HEX[] = "0123456789ABCDEF";
+        for (unsigned char c : value) {
+            if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                out.push_back(static_cast<char>(c));
+            }
+            else {
+                out.push_back('%');
+                out.push_back(HEX[c >> 4]);
+                out.push_back(HEX[c & 0x0F]);
+            }
+        }
+    }
+
+    bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    bool ContainsIgnoreCase(std::string_view haystack, std::string_view needle) {
+        return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        }) != haystack.end();
+    }
+
+    std::string_view Trim(std::string_view value) {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    double Ms(Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+struct PooledHttpTransport::Connection
+{
+    NetSocket::Handle socket = NetSocket::INVALID_HANDLE;
+    bool connecting = true;
+    bool closed = false;
+    bool servedResponse = false;  // Later requests count as reused
+    Clock::time_point openedAt;
+    Clock::time_point lastUsed;
+
+    std::string sendBuffer;
+    size_t sendOffset = 0;
+    std::string receiveBuffer;
+    std::deque<PendingRequest> inFlight; // Responses arrive in this order
+
+    // Response parser state for inFlight.front()
+    Phase phase = Phase::Headers;
+    int status = 0;
+    size_t contentLength = 0;
+    size_t chunkRemaining = 0;
+    bool closeAfterResponse = false;
+    std::string body;
+
+    void ResetResponse() {
+        phase = Phase::Headers;
+        status = 0;
+        contentLength = 0;
+        chunkRemaining = 0;
+        body.clear();
+    }
+};
+
+PooledHttpTransport::PooledHttpTransport() : PooledHttpTransport(Config{}) {}
+
+PooledHttpTransport::PooledHttpTransport(const Config& config) : m_config(config) {
+    NetSocket::Startup();
+}
+
+PooledHttpTransport::~PooledHttpTransport() {
+    for (auto& connection : m_connections) {
+        NetSocket::Close(connection->socket);
+    }
+}
+
+void PooledHttpTransport::setBaseUri(const std::string& uri) {
+    std::string_view rest(uri);
+    m_baseUriValid = false;
+    if (rest.rfind("http://", 0) != 0) {
+        return; // https:// is not supported; requests fail with NOT_INITIALIZED_ERROR
+    }
+    rest.remove_prefix(7);
+
+    const size_t slash = rest.find('/');
+    const std::string_view authority = rest.substr(0, slash);
+    m_basePath = slash == std::string_view::npos ? "" : std::string(rest.substr(slash));
+    while (!m_basePath.empty() && m_basePath.back() == '/') {
+        m_basePath.pop_back();
+    }
+
+    const size_t colon = authority.rfind(':');
+    const bool hasPort = colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos;
+    m_host = std::string(authority.substr(0, hasPort ? colon : authority.size()));
+    if (m_host.size() > 2 && m_host.front() == '[' && m_host.back() == ']') {
+        m_host = m_host.substr(1, m_host.size() - 2);
+    }
+    m_port = hasPort ? std::atoi(std::string(authority.substr(colon + 1)).c_str()) : 80;
+    m_baseUriValid = !m_host.empty() && m_port > 0 && m_port < 65536;
+}
+
+void PooledHttpTransport::request(const Nakama::NHttpRequest& req, const Nakama::NHttpResponseCallback& callback) {
+    PendingRequest pending;
+    pending.method = req.method;
+    pending.path = req.path;
+    pending.wire = Serialize(req);
+    pending.callback = callback;
+    pending.queuedAt = Clock::now();
+
+    std::function<void()> wake;
+    {
+        std::lock_guard<std::mutex> lock(m_incomingMutex);
+        m_incoming.push_back(std::move(pending));
+        wake = m_wakeHandler;
+    }
+    if (wake) {
+        wake();
+    }
+}
+
+void PooledHttpTransport::cancelAllRequests() {
+    std::function<void()> wake;
+    {
+        std::lock_guard<std::mutex> lock(m_incomingMutex);
+        m_cancelRequested = true;
+        wake = m_wakeHandler;
+    }
+    if (wake) {
+        wake();
+    }
+}
+
+void PooledHttpTransport::SetWakeHandler(std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(m_incomingMutex);
+    m_wakeHandler = std::move(handler);
+}
+
+bool PooledHttpTransport::HasPendingRequests() const {
+    {
+        std::lock_guard<std::mutex> lock(m_incomingMutex);
+        if (!m_incoming.empty() || m_cancelRequested) {
+            return true;
+        }
+    }
+    if (!m_queue.empty()) {
+        return true;
+    }
+    return std::any_of(m_connections.begin(), m_connections.end(),
+        [](const std::unique_ptr<Connection>& connection) { return !connection->inFlight.empty(); });
+}
+
+void PooledHttpTransport::SetTimingObserver(TimingObserver observer) {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_observer = std::move(observer);
+}
+
+HttpTransportStats PooledHttpTransport::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+size_t PooledHttpTransport::OpenConnectionCount() const {
+    return m_connections.size();
+}
+
+std::string PooledHttpTransport::Serialize(const Nakama::NHttpRequest& req) const {
+    std::string wire;
+    wire.reserve(256 + req.path.size() + req.body.size());
+    wire.append(MethodName(req.method)).push_back(' ');
+    wire.append(m_basePath).append(req.path.empty() || req.path.front() != '/' ? "/" : "").append(req.path);
+
+    char separator = '?';
+    for (const auto& arg : req.queryArgs) {
+        wire.push_back(separator);
+        separator = '&';
+        AppendUrlEncoded(wire, arg.first);
+        wire.push_back('=');
+        AppendUrlEncoded(wire, arg.second);
+    }
+    wire.append(" HTTP/1.1\r\n");
+
+    wire.append("Host: ").append(m_host).append(":").append(std::to_string(m_port)).append("\r\n");
+    for (const auto& header : req.headers) {
+        if (EqualsIgnoreCase(header.first, "Content-Length") || EqualsIgnoreCase(header.first, "Connection") ||
+            EqualsIgnoreCase(header.first, "Host")) {
+            continue;
+        }
+        wire.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    if (!req.body.empty() || req.method == NHttpReqMethod::POST || req.method == NHttpReqMethod::PUT) {
+        wire.append("Content-Length: ").append(std::to_string(req.body.size())).append("\r\n");
+    }
+    wire.append("Connection: keep-alive\r\n\r\n");
+    wire.append(req.body);
+    return wire;
+}
+
+void PooledHttpTransport::tick() {
+    const auto now = Clock::now();
+    DrainIncoming();
+
+    for (auto& connection : m_connections) {
+        Service(*connection, now);
+    }
+    m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(),
+        [](const std::unique_ptr<Connection>& connection) { return connection->closed; }), m_connections.end());
+
+    Dispatch(now);
+}
+
+void PooledHttpTransport::DrainIncoming() {
+    std::vector<PendingRequest> incoming;
+    bool cancel = false;
+    {
+        std::lock_guard<std::mutex> lock(m_incomingMutex);
+        incoming.swap(m_incoming);
+        cancel = m_cancelRequested;
+        m_cancelRequested = false;
+    }
+
+    if (cancel) {
+        // In flight requests can only be cancelled by dropping the connection
+        std::vector<PendingRequest> cancelled;
+        for (auto& connection : m_connections) {
+            NetSocket::Close(connection->socket);
+            for (auto& request : connection->inFlight) {
+                cancelled.push_back(std::move(request));
+            }
+        }
+        m_connections.clear();
+        for (auto& request : m_queue) {
+            cancelled.push_back(std::move(request));
+        }
+        m_queue.clear();
+        for (auto& request : incoming) {
+            cancelled.push_back(std::move(request));
+        }
+        incoming.clear();
+
+        for (auto& request : cancelled) {
+            Fail(request, InternalStatusCodes::CANCELLED_BY_USER, "cancelled");
+        }
+    }
+
+    for (auto& request : incoming) {
+        m_queue.push_back(std::move(request));
+    }
+}
+
+void PooledHttpTransport::Dispatch(Clock::time_point now) {
+    while (!m_queue.empty()) {
+        if (!m_baseUriValid) {
+            PendingRequest request = std::move(m_queue.front());
+            m_queue.pop_front();
+            Fail(request, InternalStatusCodes::NOT_INITIALIZED_ERROR, "base uri missing or not plain http");
+            continue;
+        }
+
+        Connection* target = nullptr;
+        for (auto& connection : m_connections) {
+            if (!connection->connecting && connection->inFlight.empty() && !connection->closed) {
+                target = connection.get();
+                break;
+            }
+        }
+
+        if (!target && m_connections.size() < m_config.maxConnections) {
+            target = OpenConnection(now);
+            if (!target) {
+                PendingRequest request = std::move(m_queue.front());
+                m_queue.pop_front();
+                Fail(request, InternalStatusCodes::CONNECTION_ERROR, "cannot connect to " + m_host);
+                continue;
+            }
+        }
+
+        if (!target && IsIdempotent(m_queue.front().method)) {
+            for (auto& connection : m_connections) {
+                const bool canPipeline = !connection->closed && !connection->closeAfterResponse &&
+                    connection->inFlight.size() < m_config.maxPipelineDepth &&
+                    std::all_of(connection->inFlight.begin(), connection->inFlight.end(),
+                        [](const PendingRequest& request) { return IsIdempotent(request.method); });
+                if (canPipeline && (!target || connection->inFlight.size() < target->inFlight.size())) {
+                    target = connection.get();
+                }
+            }
+        }
+
+        if (!target) {
+            return; // Everything busy; keep FIFO order
+        }
+        PendingRequest request = std::move(m_queue.front());
+        m_queue.pop_front();
+        Assign(*target, std::move(request), now);
+    }
+}
+
+PooledHttpTransport::Connection* PooledHttpTransport::OpenConnection(Clock::time_point now) {
+    std::string error;
+    const NetSocket::Handle socket = NetSocket::ConnectNonBlocking(m_host, m_port, error);
+    if (socket == NetSocket::INVALID_HANDLE) {
+        return nullptr;
+    }
+
+    auto connection = std::make_unique<Connection>();
+    connection->socket = socket;
+    connection->openedAt = now;
+    connection->lastUsed = now;
+    connection->receiveBuffer.reserve(RECEIVE_BUFFER_SIZE);
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.connectionsOpened;
+    }
+    m_connections.push_back(std::move(connection));
+    return m_connections.back().get();
+}
+
+void PooledHttpTransport::Assign(Connection& connection, PendingRequest&& request, Clock::time_point now) {
+    request.reused = connection.servedResponse;
+    request.pipelined = !connection.inFlight.empty();
+    request.sentAt = now;
+    connection.sendBuffer.append(request.wire);
+    connection.inFlight.push_back(std::move(request));
+    connection.lastUsed = now;
+
+    if (!connection.connecting) {
+        Service(connection, now);
+    }
+}
+
+void PooledHttpTransport::Service(Connection& connection, Clock::time_point now) {
+    if (connection.closed) {
+        return;
+    }
+
+    if (connection.connecting) {
+        NetSocket::PollEntry entry;
+        entry.socket = connection.socket;
+        entry.wantWrite = true;
+        if (NetSocket::Poll(&entry, 1, 0) <= 0) {
+            if (now - connection.openedAt > m_config.connectTimeout) {
+                CloseConnection(connection, "connect timed out");
+            }
+            return;
+        }
+        if (entry.failed || NetSocket::ConnectError(connection.socket) != 0) {
+            CloseConnection(connection, "connect failed");
+            return;
+        }
+        connection.connecting = false;
+    }
+
+    while (connection.sendOffset < connection.sendBuffer.size()) {
+        bool wouldBlock = false;
+        const int sent = NetSocket::Send(connection.socket, connection.sendBuffer.data() + connection.sendOffset,
+            connection.sendBuffer.size() - connection.sendOffset, wouldBlock);
+        if (sent > 0) {
+            connection.sendOffset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (!wouldBlock) {
+            CloseConnection(connection, "send failed");
+            return;
+        }
+        break;
+    }
+    if (connection.sendOffset == connection.sendBuffer.size()) {
+        connection.sendBuffer.clear();
+        connection.sendOffset = 0;
+    }
+
+    char chunk[16 * 1024];
+    for (;;) {
+        bool wouldBlock = false;
+        const int received = NetSocket::Recv(connection.socket, chunk, sizeof(chunk), wouldBlock);
+        if (received > 0) {
+            if (!connection.inFlight.empty() && connection.inFlight.front().firstByteAt == Clock::time_point{}) {
+                connection.inFlight.front().firstByteAt = now;
+            }
+            connection.receiveBuffer.append(chunk, static_cast<size_t>(received));
+            continue;
+        }
+        if (received == 0) {
+            // Server closed: a body delimited by the close is now complete
+            if (connection.phase == Phase::BodyUntilClose && !connection.inFlight.empty()) {
+                ParseResponses(connection, now);
+                auto response = std::make_shared<NHttpResponse>();
+                response->statusCode = connection.status;
+                response->body = std::move(connection.body);
+                PendingRequest request = std::move(connection.inFlight.front());
+                connection.inFlight.pop_front();
+                connection.ResetResponse();
+                Complete(request, response);
+            }
+            else if (!ParseResponses(connection, now)) {
+                CloseConnection(connection, "malformed response");
+                return;
+            }
+            CloseConnection(connection, "connection closed by server");
+            return;
+        }
+        if (!wouldBlock) {
+            CloseConnection(connection, "receive failed");
+            return;
+        }
+        break;
+    }
+
+    if (!ParseResponses(connection, now)) {
+        CloseConnection(connection, "malformed response");
+        return;
+    }
+    if (connection.closeAfterResponse && connection.phase == Phase::Headers) {
+        CloseConnection(connection, "connection: close");
+        return;
+    }
+
+    if (connection.inFlight.empty()) {
+        if (now - connection.lastUsed > m_config.idleTimeout) {
+            CloseConnection(connection, "idle");
+        }
+    }
+    else if (now - connection.inFlight.front().sentAt > m_config.requestTimeout) {
+        CloseConnection(connection, "request timed out");
+    }
+}
+
+// Consumes complete responses from the receive buffer. Returns false on a
+// protocol error.
+bool PooledHttpTransport::ParseResponses(Connection& connection, Clock::time_point now) {
+    std::string& buffer = connection.receiveBuffer;
+    size_t offset = 0;
+    bool ok = true;
+
+    while (ok && !connection.inFlight.empty()) {
+        const std::string_view data(buffer.data() + offset, buffer.size() - offset);
+        bool complete = false;
+
+        if (connection.phase == Phase::Headers) {
+            const size_t end = data.find("\r\n\r\n");
+            if (end == std::string_view::npos) {
+                ok = data.size() <= MAX_HEADER_SIZE;
+                break;
+            }
+            const std::string_view header = data.substr(0, end + 2);
+            offset += end + 4;
+
+            // "HTTP/1.1 200 OK"
+            const size_t space = header.find(' ');
+            if (header.rfind("HTTP/1.", 0) != 0 || space == std::string_view::npos) {
+                ok = false;
+                break;
+            }
+            connection.status = std::atoi(std::string(header.substr(space + 1, 3)).c_str());
+            bool chunked = false;
+            bool hasLength = false;
+            bool close = header.rfind("HTTP/1.0", 0) == 0;
+
+            size_t lineStart = header.find("\r\n") + 2;
+            while (lineStart < header.size()) {
+                const size_t lineEnd = header.find("\r\n", lineStart);
+                const std::string_view line = header.substr(lineStart, lineEnd - lineStart);
+                lineStart = lineEnd + 2;
+                const size_t colon = line.find(':');
+                if (colon == std::string_view::npos) {
+                    continue;
+                }
+                const std::string_view name = Trim(line.substr(0, colon));
+                const std::string_view value = Trim(line.substr(colon + 1));
+                if (EqualsIgnoreCase(name, "Content-Length")) {
+                    connection.contentLength = static_cast<size_t>(std::strtoull(std::string(value).c_str(), nullptr, 10));
+                    hasLength = true;
+                }
+                else if (EqualsIgnoreCase(name, "Transfer-Encoding")) {
+                    chunked = ContainsIgnoreCase(value, "chunked");
+                }
+                else if (EqualsIgnoreCase(name, "Connection")) {
+                    close = ContainsIgnoreCase(value, "close") ||
+                        (close && !ContainsIgnoreCase(value, "keep-alive"));
+                }
+            }
+
+            if (connection.status >= 100 && connection.status < 200) {
+                connection.ResetResponse(); // Interim response; the real one follows
+                continue;
+            }
+            if (close) {
+                connection.closeAfterResponse = true;
+            }
+            if (connection.status == 204 || connection.status == 304 || (hasLength && connection.contentLength == 0 && !chunked)) {
+                complete = true;
+            }
+            else if (chunked) {
+                connection.phase = Phase::ChunkSize;
+            }
+            else if (hasLength) {
+                connection.phase = Phase::Body;
+            }
+            else {
+                connection.phase = Phase::BodyUntilClose;
+                connection.closeAfterResponse = true;
+            }
+        }
+        else if (connection.phase == Phase::Body) {
+            if (data.size() < connection.contentLength) {
+                break;
+            }
+            connection.body.assign(data.data(), connection.contentLength);
+            offset += connection.contentLength;
+            complete = true;
+        }
+        else if (connection.phase == Phase::BodyUntilClose) {
+            connection.body.append(data.data(), data.size());
+            offset += data.size();
+            break;
+        }
+        else if (connection.phase == Phase::ChunkSize) {
+            const size_t end = data.find("\r\n");
+            if (end == std::string_view::npos) {
+                break;
+            }
+            connection.chunkRemaining = static_cast<size_t>(std::strtoull(std::string(data.substr(0, end)).c_str(), nullptr, 16));
+            offset += end + 2;
+            connection.phase = connection.chunkRemaining == 0 ? Phase::ChunkTrailer : Phase::ChunkData;
+        }
+        else if (connection.phase == Phase::ChunkData) {
+            if (data.size() < connection.chunkRemaining + 2) {
+                break;
+            }
+            connection.body.append(data.data(), connection.chunkRemaining);
+            offset += connection.chunkRemaining + 2;
+            connection.phase = Phase::ChunkSize;
+        }
+        else if (connection.phase == Phase::ChunkTrailer) {
+            const size_t end = data.find("\r\n");
+            if (end == std::string_view::npos) {
+                break;
+            }
+            offset += end + 2;
+            complete = end == 0; // Blank line ends the trailers
+        }
+
+        if (complete) {
+            auto response = std::make_shared<NHttpResponse>();
+            response->statusCode = connection.status;
+            response->body = std::move(connection.body);
+            PendingRequest request = std::move(connection.inFlight.front());
+            connection.inFlight.pop_front();
+            connection.ResetResponse();
+            connection.servedResponse = true;
+            connection.lastUsed = now;
+            if (!connection.inFlight.empty() && offset < buffer.size()) {
+                connection.inFlight.front().firstByteAt = now;
+            }
+            Complete(request, response);
+            if (connection.closeAfterResponse) {
+                break; // Anything after this response is not ours
+            }
+        }
+    }
+
+    // clear()/erase keep the capacity for the next response
+    buffer.erase(0, offset);
+    return ok;
+}
+
+void PooledHttpTransport::CloseConnection(Connection& connection, const std::string& reason) {
+    NetSocket::Close(connection.socket);
+    connection.socket = NetSocket::INVALID_HANDLE;
+    connection.closed = true;
+
+    // Requests the server never started answering on a reused connection
+    // are resent if that is safe; the rest fail
+    std::vector<PendingRequest> retry;
+    for (auto& request : connection.inFlight) {
+        const bool untouched = request.firstByteAt == Clock::time_point{};
+        if (untouched && IsIdempotent(request.method) && !request.retried &&
+            (request.reused || request.pipelined)) {
+            request.retried = true;
+            retry.push_back(std::move(request));
+        }
+        else {
+            Fail(request, InternalStatusCodes::CONNECTION_ERROR, reason);
+        }
+    }
+    connection.inFlight.clear();
+
+    if (!retry.empty()) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.retries += retry.size();
+    }
+    for (auto it = retry.rbegin(); it != retry.rend(); ++it) {
+        m_queue.push_front(std::move(*it));
+    }
+}
+
+void PooledHttpTransport::Complete(PendingRequest& request, NHttpResponsePtr response) {
+    const auto now = Clock::now();
+    HttpRequestTiming timing;
+    timing.path = request.path;
+    timing.statusCode = response->statusCode;
+    timing.reusedConnection = request.reused;
+    timing.pipelined = request.pipelined;
+    timing.queueMs = request.sentAt == Clock::time_point{} ? 0.0 : Ms(request.sentAt - request.queuedAt);
+    timing.firstByteMs = request.firstByteAt == Clock::time_point{} ? 0.0 : Ms(request.firstByteAt - request.queuedAt);
+    timing.totalMs = Ms(now - request.queuedAt);
+
+    TimingObserver observer;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.requests;
+        m_stats.failures += response->statusCode >= InternalStatusCodes::CONNECTION_ERROR;
+        m_stats.reusedRequests += request.reused;
+        m_stats.pipelinedRequests += request.pipelined;
+        m_stats.totalMs += timing.totalMs;
+        m_stats.maxMs = std::max(m_stats.maxMs, timing.totalMs);
+        observer = m_observer;
+    }
+
+    if (request.callback) {
+        request.callback(response);
+    }
+    if (observer) {
+        observer(timing);
+    }
+}
+
+void PooledHttpTransport::Fail(PendingRequest& request, int statusCode, const std::string& message) {
+    auto response = std::make_shared<NHttpResponse>();
+    response->statusCode = statusCode;
+    response->errorMessage = message;
+    Complete(request, response);
+}
@@ -0,0 +1,20 @@
+#include "../public/reconnect_backoff.h"
+#include <algorithm>
+#include <cmath>
+
+ReconnectBackoff::ReconnectBackoff() : ReconnectBackoff(Config{}) {}
+
+ReconnectBackoff::ReconnectBackoff(const Config& config, std::uint32_t seed)
+    : m_config(config), m_rng(seed) {}
+
+std::chrono::milliseconds ReconnectBackoff::NextDelay() {
+    const double initial = static_cast<double>(m_config.initialDelay.count());
+    const double maximum = static_cast<double>(m_config.maxDelay.count());
+    const double base = std::min(maximum, initial * std::pow(m_config.multiplier, m_attempts));
+    ++m_attempts;
+
+    const double jitter = std::clamp(m_config.jitter, 0.0, 1.0);
+    std::uniform_real_distribution<double> spread(0.0, base * jitter);
+    const double delay = base * (1.0 - jitter) + spread(m_rng);
+    return std::chrono::milliseconds(static_cast<std::int64_t>(delay));
+}
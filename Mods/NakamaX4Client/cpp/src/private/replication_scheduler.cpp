@@ -0,0 +1,146 @@
+#include "../public/replication_scheduler.h"
+#include <algorithm>
+
+// A 100 m/s ship accrues priority twice as fast as a stationary one
+constexpr double SPEED_REFERENCE = 100.0;
+// An entity this far from the nearest observer accrues at half rate
+constexpr double DISTANCE_REFERENCE = 5000.0;
+// Unused budget carries over for at most this long
+constexpr double MAX_BURST_SECONDS = 0.2;
+// Longest gap between ticks that still counts towards priority and budget
+constexpr double MAX_TICK_SECONDS = 1.0;
+
+ReplicationScheduler::ReplicationScheduler(size_t budgetBytesPerSecond)
+    : m_budgetBytesPerSecond(budgetBytesPerSecond) {}
+
+double ReplicationScheduler::PriorityRate(const ReplicationHints& hints) {
+    const double speed = std::max(0.0f, hints.speed);
+    double rate = std::max(0.0f, hints.importance) * (1.0 + speed / SPEED_REFERENCE);
+    if (hints.observerDistance >= 0.0f) {
+        rate *= DISTANCE_REFERENCE / (DISTANCE_REFERENCE + hints.observerDistance);
+    }
+    return rate;
+}
+
+void ReplicationScheduler::Submit(const std::string& entityId, std::int64_t opCode,
+    std::string_view payload, const ReplicationHints& hints, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entity& entity = m_entities[{ entityId, opCode }];
+    if (!entity.Dirty()) {
+        entity.waitingSince = now;
+    }
+    if (hints.keyframe) {
+        // Supersedes everything unsent, including an older keyframe
+        entity.keyframe.assign(payload.data(), payload.size());
+        entity.keyframeHints = hints;
+        entity.keyframePending = true;
+        entity.payloadPending = false;
+    }
+    else {
+        entity.payload.assign(payload.data(), payload.size());
+        entity.hints = hints;
+        entity.payloadPending = true;
+    }
+}
+
+void ReplicationScheduler::Remove(const std::string& entityId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entities.begin(); it != m_entities.end();) {
+        it = it->first.first == entityId ? m_entities.erase(it) : std::next(it);
+    }
+}
+
+void ReplicationScheduler::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entities.clear();
+    m_credit = 0.0;
+    m_lastTick = {};
+}
+
+size_t ReplicationScheduler::Tick(Clock::time_point now, const SendFunction& send) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const double budgetPerSecond = static_cast<double>(m_budgetBytesPerSecond);
+    const double burst = budgetPerSecond * MAX_BURST_SECONDS;
+    double dt = 0.0;
+    if (m_lastTick == Clock::time_point{}) {
+        m_credit = burst; // First tick after start or Clear()
+    }
+    else {
+        dt = std::min(MAX_TICK_SECONDS, std::chrono::duration<double>(now - m_lastTick).count());
+        m_credit = std::min(burst, m_credit + budgetPerSecond * dt);
+    }
+    m_lastTick = now;
+
+    m_order.clear();
+    for (auto& pair : m_entities) {
+        Entity& entity = pair.second;
+        if (entity.Dirty()) {
+            entity.priority += PriorityRate(entity.keyframePending ? entity.keyframeHints : entity.hints) * dt;
+            m_order.push_back(&pair);
+        }
+    }
+    std::stable_sort(m_order.begin(), m_order.end(), [](const auto* a, const auto* b) {
+        return a->second.priority > b->second.priority;
+    });
+
+    size_t sent = 0;
+    for (auto* pair : m_order) {
+        Entity& entity = pair->second;
+        // A pending keyframe goes first; newer state waits for the next send
+        const std::string& payload = entity.keyframePending ? entity.keyframe : entity.payload;
+        const double size = static_cast<double>(payload.size());
+        // The top entity may overdraw a positive balance; the rest must fit
+        const bool fits = sent == 0 ? m_credit > 0.0 : size <= m_credit;
+        if (!fits) {
+            ++m_stats.deferred;
+            continue;
+        }
+
+        send(pair->first.second, payload);
+        m_credit -= size;
+        m_stats.peakWaitMs = std::max(m_stats.peakWaitMs,
+            std::chrono::duration<double, std::milli>(now - entity.waitingSince).count());
+        ++m_stats.sent;
+        m_stats.bytes += payload.size();
+        entity.priority = 0.0;
+        if (entity.keyframePending) {
+            entity.keyframePending = false;
+            entity.waitingSince = now;
+        }
+        else {
+            entity.payloadPending = false;
+        }
+        ++sent;
+    }
+    return sent;
+}
+
+void ReplicationScheduler::SetBudgetBytesPerSecond(size_t bytesPerSecond) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budgetBytesPerSecond = bytesPerSecond;
+}
+
+size_t ReplicationScheduler::GetBudgetBytesPerSecond() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budgetBytesPerSecond;
+}
+
+ReplicationStats ReplicationScheduler::GetStats(Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ReplicationStats stats = m_stats;
+    for (const auto& pair : m_entities) {
+        if (pair.second.Dirty()) {
+            ++stats.waiting;
+            stats.maxWaitMs = std::max(stats.maxWaitMs,
+                std::chrono::duration<double, std::milli>(now - pair.second.waitingSince).count());
+        }
+    }
+    stats.peakWaitMs = std::max(stats.peakWaitMs, stats.maxWaitMs);
+    return stats;
+}
+
+double ReplicationScheduler::GetPriority(const std::string& entityId, std::int64_t opCode) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_entities.find({ entityId, opCode });
+    return it == m_entities.end() ? 0.0 : it->second.priority;
+}
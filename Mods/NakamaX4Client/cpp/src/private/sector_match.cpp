@@ -3,20 +3,30 @@
 #include "../public/nakama_x4_client.h"
 #include "../public/nakama_realtime_client.h"
 #include "../public/player_ship.h"
+#include "../public/fleet_formation.h"
+#include "../public/match_opcodes.h"
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <msgpack.hpp>
 
 // Magic numbers as named constants
 constexpr float DEFAULT_INTERPOLATION_DELAY_MS = 100.0f;
 constexpr int DEFAULT_MAX_SNAPSHOT_AGE_MS = 1000;
 constexpr int DEFAULT_CLEANUP_INTERVAL_MS = 5000;
+// The server forwards at most 20 snapshots per second
+constexpr int DEFAULT_SEND_INTERVAL_MS = 50;
+// Replication weights; a formation keyframe matters more than a plain update
+constexpr float PLAYER_SHIP_IMPORTANCE = 1.0f;
+constexpr float FORMATION_KEYFRAME_IMPORTANCE = 2.0f;
 
 SectorMatchManager::SectorMatchManager()
 	: X4ScriptSingleton("SectorMatchManager"), m_localPlayerId(""),
-	m_currentSector(""), m_interpolationDelayMs(DEFAULT_INTERPOLATION_DELAY_MS),
+	m_currentSector(""), m_currentShard(-1), m_interpolationDelayMs(DEFAULT_INTERPOLATION_DELAY_MS),
+	m_linkDelayMarginMs(0.0f), m_sendIntervalMs(DEFAULT_SEND_INTERVAL_MS),
 	m_maxSnapshotAgeMs(DEFAULT_MAX_SNAPSHOT_AGE_MS), m_cleanupIntervalMs(DEFAULT_CLEANUP_INTERVAL_MS),
-	m_lastCleanupTime(std::chrono::steady_clock::now()) {
+	m_lastCleanupTime(std::chrono::steady_clock::now()),
+	m_localFormationVersion(0), m_fleetUpdatesSinceKeyframe(0) {
 }
 
 SectorMatchManager::~SectorMatchManager() { Shutdown(); }
@@ -66,26 +76,54 @@ void SectorMatchManager::Shutdown()
 
 	LogInfo("Shutting down SectorMatchManager");
 
+	auto* rtClient = NakamaRealtimeClient::GetInstance();
+	if (rtClient)
+	{
+		rtClient->StopReplicating(m_localPlayerId);
+	}
 	m_playerShips.clear();
 	m_localPlayerId.clear();
 	m_currentSector.clear();
+	m_currentShard = -1;
+	m_positionHint.clear();
+	m_localFormation.clear();
+	m_remoteFormationVersions.clear();
 
 	SetInitialized(false);
 	LogInfo("SectorMatchManager shutdown complete");
 }
 
-void SectorMatchManager::ChangeSector(const std::string& newSector)
+int SectorMatchManager::ChangeSector(const std::string& newSector)
+{
+	m_positionHint.clear();
+	return JoinSector(newSector);
+}
+
+int SectorMatchManager::ChangeSectorNear(const std::string& newSector, float x, float y, float z)
+{
+	m_positionHint = { x, y, z };
+	return JoinSector(newSector);
+}
+
+void SectorMatchManager::OnShardJoined(int shard)
+{
+	m_currentShard = shard;
+	LogInfo("In sector %s, shard %d", m_currentSector.c_str(), shard);
+}
+
+int SectorMatchManager::JoinSector(const std::string& newSector)
 {
+	auto* client = NakamaX4Client::GetInstance();
 	if (!IsInitialized())
 	{
 		LogError("SectorMatchManager not initialized");
-		return;
+		return client->FailedOperation("join_match", "SectorMatchManager not initialized");
 	}
 
 	if (m_currentSector == newSector)
 	{
 		LogInfo("Already in sector: %s", newSector.c_str());
-		return;
+		return client->SucceededOperation("join_match");
 	}
 
 	LogInfo("Changing sector from '%s' to '%s'", m_currentSector.c_str(),
@@ -95,35 +133,38 @@ void SectorMatchManager::ChangeSector(const std::string& newSector)
 	if (!m_currentSector.empty())
 	{
 		OnSectorLeft(m_currentSector);
-		// Leave the current match
+		// Leave the current match; our unsent state belongs to it
 		auto* rtClient = NakamaRealtimeClient::GetInstance();
 		if (rtClient)
 		{
+			rtClient->StopReplicating(m_localPlayerId);
 			rtClient->LeaveMatch();
 		}
 	}
 
 	// Clear all player ships for the new sector
 	m_playerShips.clear();
+	m_remoteFormationVersions.clear();
+	// Force a formation keyframe so the new sector learns our fleet layout
+	m_fleetUpdatesSinceKeyframe = FleetFormation::KEYFRAME_INTERVAL;
 	LogInfo("Cleared player ships map for new sector");
 
 	// Join new sector
 	m_currentSector = newSector;
+	m_currentShard = -1;
 
 	// Create local player ship
 	PlayerShip localShip(m_localPlayerId, "local_ship", false);
 	OnSectorJoined(newSector, localShip);
 
-	// Join the new match for this sector
+	// Join the new match for this sector without blocking the game thread;
+	// OnShardJoined reports when it is in
 	auto* rtClient = NakamaRealtimeClient::GetInstance();
-	if (rtClient && rtClient->IsConnected())
+	if (!rtClient)
 	{
-		if (rtClient->JoinOrCreateMatch(newSector))
-		{
-			LogInfo("Joined match for sector %s",
-				newSector.c_str());
-		}
+		return client->FailedOperation("join_match", "Realtime client not available");
 	}
+	return rtClient->JoinOrCreateMatchAsync(newSector);
 }
 
 void SectorMatchManager::OnSectorJoined(const std::string& sector,
@@ -164,6 +205,7 @@ void SectorMatchManager::OnSectorLeft(const std::string& sector)
 			++it;
 		}
 	}
+	m_remoteFormationVersions.clear();
 }
 
 void SectorMatchManager::UpdateRemotePlayer(
@@ -181,8 +223,172 @@ void SectorMatchManager::UpdateRemotePlayer(
 	}
 	else
 	{
-		// Update existing player
+		// Update existing player; an update from our own match means the
+		// player is in our shard now (ghost updates re-mark it afterwards)
 		it->second.UpdatePosition(position, rotation, velocity);
+		it->second.from_other_shard = false;
+	}
+}
+
+void SectorMatchManager::UpdateRemoteFleet(const FleetUpdate& update)
+{
+	// Leader is the player's own ship entry
+	UpdateRemotePlayer(update.player_id, update.position, update.rotation,
+		update.velocity);
+
+	if (update.formation_included)
+	{
+		// Formation changed (or keyframe): replace the member set
+		RemoveFleetMembers(update.player_id);
+		for (const auto& member : update.members)
+		{
+			const std::string key = FleetFormation::MemberKey(update.player_id, member.ship_id);
+			PlayerShip memberShip(update.player_id, member.ship_id, true);
+			memberShip.formation_leader_id = update.player_id;
+			memberShip.formation_offset = FleetFormation::DequantizeOffset(member.offset);
+			m_playerShips[key] = memberShip;
+		}
+		m_remoteFormationVersions[update.player_id] = update.formation_version;
+	}
+	else
+	{
+		auto versionIt = m_remoteFormationVersions.find(update.player_id);
+		if (versionIt != m_remoteFormationVersions.end() &&
+			versionIt->second != update.formation_version)
+		{
+			// Missed a formation change; keep the old offsets until the next keyframe
+			LogWarning("Fleet formation for %s is out of date (have v%u, got v%u)",
+				update.player_id.c_str(), versionIt->second, update.formation_version);
+		}
+	}
+
+	// Refresh member state so raw positions stay consistent and members do not go stale
+	for (auto& pair : m_playerShips)
+	{
+		PlayerShip& ship = pair.second;
+		if (ship.formation_leader_id != update.player_id)
+		{
+			continue;
+		}
+
+		const auto worldOffset = FleetFormation::LocalToWorld(ship.formation_offset, update.rotation);
+		std::vector<float> memberPosition(3);
+		for (size_t i = 0; i < 3 && i < update.position.size(); ++i)
+		{
+			memberPosition[i] = update.position[i] + worldOffset[i];
+		}
+		ship.UpdatePosition(memberPosition, update.rotation, update.velocity);
+	}
+}
+
+void SectorMatchManager::ApplySectorSnapshot(const std::vector<PositionUpdate>& players,
+	const std::vector<FleetUpdate>& fleets)
+{
+	size_t inserted = 0;
+	for (const auto& update : players)
+	{
+		if (update.player_id == m_localPlayerId)
+		{
+			continue;
+		}
+
+		auto it = m_playerShips.lower_bound(update.player_id);
+		if (it == m_playerShips.end() || it->first != update.player_id)
+		{
+			it = m_playerShips.emplace_hint(it, update.player_id, PlayerShip(update.player_id, "", true));
+			++inserted;
+		}
+		it->second.UpdatePosition(update.position, update.rotation, update.velocity);
+	}
+
+	for (const auto& fleet : fleets)
+	{
+		if (fleet.player_id == m_localPlayerId)
+		{
+			continue;
+		}
+		if (!HasPlayer(fleet.player_id))
+		{
+			++inserted;
+		}
+		UpdateRemoteFleet(fleet);
+	}
+
+	LogInfo("Applied sector snapshot for %s: %zu players, %zu fleets (%zu new)",
+		m_currentSector.c_str(), players.size(), fleets.size(), inserted);
+}
+
+bool SectorMatchManager::HasPlayer(const std::string& playerId) const
+{
+	return m_playerShips.find(playerId) != m_playerShips.end();
+}
+
+void SectorMatchManager::ClearRemotePlayers()
+{
+	for (auto it = m_playerShips.begin(); it != m_playerShips.end();)
+	{
+		if (it->second.is_remote)
+		{
+			it = m_playerShips.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	m_remoteFormationVersions.clear();
+}
+
+void SectorMatchManager::ApplyShardGhosts(const std::vector<PositionUpdate>& players,
+	const std::vector<FleetUpdate>& fleets)
+{
+	auto isLocalShardPlayer = [this](const std::string& playerId) {
+		auto it = m_playerShips.find(playerId);
+		return it != m_playerShips.end() && !it->second.from_other_shard;
+	};
+	auto markGhost = [this](const std::string& playerId) {
+		for (auto& pair : m_playerShips)
+		{
+			if (pair.second.player_id == playerId)
+			{
+				pair.second.from_other_shard = true;
+			}
+		}
+	};
+
+	for (const auto& update : players)
+	{
+		if (update.player_id == m_localPlayerId || isLocalShardPlayer(update.player_id))
+		{
+			continue;
+		}
+		UpdateRemotePlayer(update.player_id, update.position, update.rotation, update.velocity);
+		markGhost(update.player_id);
+	}
+
+	for (const auto& fleet : fleets)
+	{
+		if (fleet.player_id == m_localPlayerId || isLocalShardPlayer(fleet.player_id))
+		{
+			continue;
+		}
+		UpdateRemoteFleet(fleet);
+		markGhost(fleet.player_id);
+	}
+}
+
+void SectorMatchManager::RemoveFleetMembers(const std::string& playerId)
+{
+	for (auto it = m_playerShips.begin(); it != m_playerShips.end();)
+	{
+		if (it->second.formation_leader_id == playerId)
+		{
+			it = m_playerShips.erase(it);
+		}
+		else
+		{
+			++it;
+		}
 	}
 }
 
@@ -196,11 +402,29 @@ SectorMatchManager::GetInterpolatedPosition(const std::string& playerId) const
 {
 	auto it = m_playerShips.find(playerId);
 
-	if (it != m_playerShips.end())
+	if (it == m_playerShips.end())
+	{
+		return { 0.0f, 0.0f, 0.0f }; // Default position
+	}
+
+	// Fleet members: reconstruct from the leader's interpolated frame
+	if (!it->second.formation_leader_id.empty())
 	{
-		return it->second.GetInterpolatedPosition(m_interpolationDelayMs);
+		auto leaderIt = m_playerShips.find(it->second.formation_leader_id);
+		if (leaderIt != m_playerShips.end())
+		{
+			auto position = leaderIt->second.GetInterpolatedPosition(GetEffectiveInterpolationDelay());
+			const auto rotation = leaderIt->second.GetInterpolatedRotation(GetEffectiveInterpolationDelay());
+			const auto worldOffset = FleetFormation::LocalToWorld(it->second.formation_offset, rotation);
+			for (size_t i = 0; i < 3 && i < position.size(); ++i)
+			{
+				position[i] += worldOffset[i];
+			}
+			return position;
+		}
 	}
-	return { 0.0f, 0.0f, 0.0f }; // Default position
+
+	return it->second.GetInterpolatedPosition(GetEffectiveInterpolationDelay());
 }
 
 void SectorMatchManager::RemovePlayer(const std::string& playerId)
@@ -212,6 +436,8 @@ void SectorMatchManager::RemovePlayer(const std::string& playerId)
 			m_currentSector.c_str());
 		m_playerShips.erase(it);
 	}
+	RemoveFleetMembers(playerId);
+	m_remoteFormationVersions.erase(playerId);
 }
 
 void SectorMatchManager::SendLocalPosition(const std::vector<float>& position,
@@ -232,7 +458,7 @@ void SectorMatchManager::SendLocalPosition(const std::vector<float>& position,
 
 	// Send to realtime client
 	auto* rtClient = NakamaRealtimeClient::GetInstance();
-	if (rtClient && rtClient->IsConnected())
+	if (rtClient && rtClient->IsConnected() && SendDue(m_lastPositionSend))
 	{
 		// Create MessagePack message using PositionUpdate struct
 		PositionUpdate update;
@@ -244,9 +470,82 @@ void SectorMatchManager::SendLocalPosition(const std::vector<float>& position,
 		msgpack::sbuffer sbuf;
 		msgpack::pack(sbuf, update);
 
-		// Convert to string for SendPosition
-		std::string msgpackStr(sbuf.data(), sbuf.size());
-		rtClient->SendPosition(msgpackStr);
+		rtClient->Replicate(m_localPlayerId, MatchOpCode::Position, std::string(sbuf.data(), sbuf.size()),
+			MakeReplicationHints(position, velocity, PLAYER_SHIP_IMPORTANCE));
+	}
+}
+
+void SectorMatchManager::SendLocalFleet(const std::vector<float>& position,
+	const std::vector<float>& rotation,
+	const std::vector<float>& velocity,
+	const std::map<std::string, std::vector<float>>& memberPositions)
+{
+	if (!IsInitialized() || m_currentSector.empty())
+	{
+		return;
+	}
+
+	// Update local player ship (fleet leader)
+	auto it = m_playerShips.find(m_localPlayerId);
+	if (it != m_playerShips.end())
+	{
+		it->second.UpdatePosition(position, rotation, velocity);
+	}
+
+	// Rate limit before touching formation state, so a dropped update never
+	// consumes a formation change
+	if (!SendDue(m_lastFleetSend))
+	{
+		return;
+	}
+
+	// Convert member world positions to quantized leader-local offsets
+	std::map<std::string, std::vector<std::int16_t>> formation;
+	for (const auto& member : memberPositions)
+	{
+		std::vector<float> worldOffset(3, 0.0f);
+		for (size_t i = 0; i < 3 && i < member.second.size() && i < position.size(); ++i)
+		{
+			worldOffset[i] = member.second[i] - position[i];
+		}
+		formation[member.first] = FleetFormation::QuantizeOffset(
+			FleetFormation::WorldToLocal(worldOffset, rotation));
+	}
+
+	FleetUpdate update;
+	update.player_id = m_localPlayerId;
+	update.position = position;
+	update.rotation = rotation;
+	update.velocity = velocity;
+
+	const bool formationChanged = formation != m_localFormation;
+	if (formationChanged)
+	{
+		m_localFormation = std::move(formation);
+		++m_localFormationVersion;
+	}
+	update.formation_version = m_localFormationVersion;
+
+	if (formationChanged || ++m_fleetUpdatesSinceKeyframe >= FleetFormation::KEYFRAME_INTERVAL)
+	{
+		m_fleetUpdatesSinceKeyframe = 0;
+		update.formation_included = true;
+		update.members.reserve(m_localFormation.size());
+		for (const auto& member : m_localFormation)
+		{
+			update.members.push_back({ member.first, member.second });
+		}
+	}
+
+	auto* rtClient = NakamaRealtimeClient::GetInstance();
+	if (rtClient && rtClient->IsConnected())
+	{
+		msgpack::sbuffer sbuf;
+		msgpack::pack(sbuf, update);
+		ReplicationHints hints = MakeReplicationHints(position, velocity,
+			update.formation_included ? FORMATION_KEYFRAME_IMPORTANCE : PLAYER_SHIP_IMPORTANCE);
+		hints.keyframe = update.formation_included;
+		rtClient->Replicate(m_localPlayerId, MatchOpCode::Fleet, std::string(sbuf.data(), sbuf.size()), hints);
 	}
 }
 
@@ -285,6 +584,71 @@ void SectorMatchManager::CleanupStalePlayers()
 	}
 }
 
+void SectorMatchManager::SetLinkDelayMargin(float marginMs)
+{
+	m_linkDelayMarginMs = marginMs;
+}
+
+void SectorMatchManager::SetSendInterval(int intervalMs)
+{
+	m_sendIntervalMs = intervalMs;
+}
+
+float SectorMatchManager::GetEffectiveInterpolationDelay() const
+{
+	return m_interpolationDelayMs + m_linkDelayMarginMs;
+}
+
+// Rate limit for local sends; updates arriving faster are dropped since the
+// next one supersedes them anyway
+bool SectorMatchManager::SendDue(std::chrono::steady_clock::time_point& lastSend)
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (now - lastSend < std::chrono::milliseconds(m_sendIntervalMs.load()))
+	{
+		return false;
+	}
+	lastSend = now;
+	return true;
+}
+
+// Speed and distance to the nearest remote player weight how fast an
+// entity's priority accrues in the realtime client's scheduler
+ReplicationHints SectorMatchManager::MakeReplicationHints(const std::vector<float>& position,
+	const std::vector<float>& velocity, float importance) const
+{
+	ReplicationHints hints;
+	hints.importance = importance;
+
+	float speedSquared = 0.0f;
+	for (float component : velocity)
+	{
+		speedSquared += component * component;
+	}
+	hints.speed = std::sqrt(speedSquared);
+
+	for (const auto& pair : m_playerShips)
+	{
+		const PlayerShip& ship = pair.second;
+		if (!ship.is_remote || ship.position.size() < 3 || position.size() < 3)
+		{
+			continue;
+		}
+		float distanceSquared = 0.0f;
+		for (size_t i = 0; i < 3; ++i)
+		{
+			const float delta = ship.position[i] - position[i];
+			distanceSquared += delta * delta;
+		}
+		const float distance = std::sqrt(distanceSquared);
+		if (hints.observerDistance < 0.0f || distance < hints.observerDistance)
+		{
+			hints.observerDistance = distance;
+		}
+	}
+	return hints;
+}
+
 void SectorMatchManager::SetInterpolationDelay(float delayMs)
 {
 	m_interpolationDelayMs = delayMs;
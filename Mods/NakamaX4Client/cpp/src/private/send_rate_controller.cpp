@@ -0,0 +1,62 @@
+#include "../public/send_rate_controller.h"
+#include <algorithm>
+#include <cmath>
+
+// Minimum spacing between two rate cuts when there is no RTT estimate yet
+constexpr double MIN_DECREASE_SPACING_MS = 250.0;
+
+SendRateController::SendRateController() : SendRateController(Config{}) {}
+
+SendRateController::SendRateController(const Config& config)
+    : m_config(config), m_rateHz(config.maxRateHz) {}
+
+bool SendRateController::IsCongested(const Signals& signals) const {
+    // Nothing measured yet (e.g. right after joining a match)
+    if (signals.samples == 0) {
+        return false;
+    }
+
+    const double inflation = signals.smoothedRttMs - signals.minRttMs;
+    const bool rttInflated = signals.smoothedRttMs > signals.minRttMs * m_config.rttInflationRatio &&
+        inflation > m_config.rttInflationMinMs;
+
+    // A probe still unanswered well past the retransmit timeout is stuck
+    // behind queued data
+    const double overdueMs = std::max(m_config.backlogMinMs, signals.smoothedRttMs + 4.0 * signals.rttVarMs);
+    const bool backlogged = signals.oldestPendingMs > overdueMs;
+
+    return rttInflated || backlogged || signals.lossRate >= m_config.lossRate;
+}
+
+bool SendRateController::Update(const Signals& signals, Clock::time_point now) {
+    const double elapsedMs = m_lastUpdate == Clock::time_point{} ? 0.0
+        : std::chrono::duration<double, std::milli>(now - m_lastUpdate).count();
+    m_lastUpdate = now;
+
+    if (IsCongested(signals)) {
+        // One cut per round trip: the effect of the last cut cannot show up
+        // in the signals any sooner
+        const double spacingMs = std::max(MIN_DECREASE_SPACING_MS, signals.smoothedRttMs);
+        if (m_lastDecrease == Clock::time_point{} ||
+            std::chrono::duration<double, std::milli>(now - m_lastDecrease).count() >= spacingMs) {
+            m_rateHz = std::max(m_config.minRateHz, m_rateHz * m_config.decreaseFactor);
+            m_lastDecrease = now;
+            ++m_decreases;
+            return true;
+        }
+        return false;
+    }
+
+    m_rateHz = std::min(m_config.maxRateHz, m_rateHz + m_config.increaseHzPerSecond * elapsedMs / 1000.0);
+    return false;
+}
+
+void SendRateController::Reset() {
+    m_rateHz = m_config.maxRateHz;
+    m_lastUpdate = {};
+    m_lastDecrease = {};
+}
+
+int SendRateController::IntervalMs() const {
+    return static_cast<int>(std::lround(1000.0 / m_rateHz));
+}
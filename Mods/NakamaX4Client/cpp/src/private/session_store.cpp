@@ -0,0 +1,132 @@
+#include "../public/session_store.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <wincrypt.h>
+#endif
+
+// First line of the file; bumped if the layout changes
+constexpr const char* SESSION_FILE_HEADER = "nakama-session 1";
+
+#ifdef _WIN32
+// DPAPI with the current user's key: only this Windows account can decrypt
+static std::optional<std::string> Protect(const std::string& plain) {
+    DATA_BLOB in{ static_cast<DWORD>(plain.size()), reinterpret_cast<BYTE*>(const_cast<char*>(plain.data())) };
+    DATA_BLOB out{};
+    if (!CryptProtectData(&in, L"Nakama session", nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &out)) {
+        return std::nullopt;
+    }
+    std::string sealed(reinterpret_cast<const char*>(out.pbData), out.cbData);
+    LocalFree(out.pbData);
+    return sealed;
+}
+
+static std::optional<std::string> Unprotect(const std::string& sealed) {
+    DATA_BLOB in{ static_cast<DWORD>(sealed.size()), reinterpret_cast<BYTE*>(const_cast<char*>(sealed.data())) };
+    DATA_BLOB out{};
+    if (!CryptUnprotectData(&in, nullptr, nullptr, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &out)) {
+        return std::nullopt;
+    }
+    std::string plain(reinterpret_cast<const char*>(out.pbData), out.cbData);
+    SecureZeroMemory(out.pbData, out.cbData);
+    LocalFree(out.pbData);
+    return plain;
+}
+#else
+// No DPAPI; the file relies on the directory's permissions alone
+static std::optional<std::string> Protect(const std::string& plain) { return plain; }
+static std::optional<std::string> Unprotect(const std::string& sealed) { return sealed; }
+#endif
+
+std::optional<StoredSession> SessionStore::Load() const {
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    const auto plain = Unprotect(std::string(std::istreambuf_iterator<char>(file), {}));
+    if (!plain) {
+        return std::nullopt;
+    }
+
+    std::istringstream in(*plain);
+    std::string line;
+    if (!std::getline(in, line) || line != SESSION_FILE_HEADER) {
+        return std::nullopt;
+    }
+
+    StoredSession session;
+    while (std::getline(in, line)) {
+        const auto separator = line.find('=');
+        if (separator == std::string::npos) {
+            continue;
+        }
+        const std::string name = line.substr(0, separator);
+        std::string value = line.substr(separator + 1);
+        if (name == "server") {
+            session.server = std::move(value);
+        }
+        else if (name == "device") {
+            session.deviceId = std::move(value);
+        }
+        else if (name == "token") {
+            session.authToken = std::move(value);
+        }
+        else if (name == "refresh") {
+            session.refreshToken = std::move(value);
+        }
+    }
+
+    if (session.authToken.empty() || session.refreshToken.empty()) {
+        return std::nullopt;
+    }
+    return session;
+}
+
+bool SessionStore::Save(const StoredSession& session) const {
+    std::ostringstream plain;
+    plain << SESSION_FILE_HEADER << '\n'
+          << "server=" << session.server << '\n'
+          << "device=" << session.deviceId << '\n'
+          << "token=" << session.authToken << '\n'
+          << "refresh=" << session.refreshToken << '\n';
+    const auto sealed = Protect(plain.str());
+    if (!sealed) {
+        return false;
+    }
+
+    const std::string temporary = m_path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(sealed->data(), static_cast<std::streamsize>(sealed->size()));
+        if (!out.flush()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, m_path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+void SessionStore::Clear() const {
+    std::error_code error;
+    std::filesystem::remove(m_path, error);
+}
+
+std::uint64_t SessionStore::RefreshAtMs(std::uint64_t createMs, std::uint64_t expireMs) {
+    if (expireMs <= createMs) {
+        return createMs;
+    }
+    const std::uint64_t margin = std::max((expireMs - createMs) / 10, MIN_REFRESH_MARGIN_MS);
+    return expireMs - std::min(margin, expireMs - createMs);
+}
@@ -0,0 +1,266 @@
+#include "../public/storage_cache.h"
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+bool StorageCache::Set(const std::string& collection, const std::string& key, const std::string& field,
+    FieldValue value, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return SetLocked(m_records[{ collection, key }], field, std::move(value), now);
+}
+
+bool StorageCache::Restore(const std::string& collection, const std::string& key, const std::string& value,
+    Clock::time_point now) {
+    const nlohmann::json parsed = nlohmann::json::parse(value, nullptr, false);
+    if (!parsed.is_object()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Record& record = m_records[{ collection, key }];
+    for (const auto& [field, item] : parsed.items()) {
+        if (item.is_number_integer()) {
+            SetLocked(record, field, item.get<long long>(), now);
+        }
+        else if (item.is_number()) {
+            SetLocked(record, field, item.get<double>(), now);
+        }
+        else if (item.is_boolean()) {
+            SetLocked(record, field, item.get<bool>(), now);
+        }
+        else if (item.is_string()) {
+            SetLocked(record, field, item.get<std::string>(), now);
+        }
+    }
+    return true;
+}
+
+std::string StorageCache::Value(const std::string& collection, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto record = m_records.find({ collection, key });
+    return record == m_records.end() ? std::string() : Serialize(record->second);
+}
+
+bool StorageCache::SetLocked(Record& record, const std::string& field, FieldValue value, Clock::time_point now) {
+    auto it = record.fields.find(field);
+    if (it != record.fields.end() && it->second == value) {
+        return false;
+    }
+    record.fields[field] = std::move(value);
+
+    if (record.dirtyFields.empty()) {
+        ++m_dirtyRecords;
+        m_firstDirtyAt = std::min(m_firstDirtyAt, now);
+    }
+    if (std::find(record.dirtyFields.begin(), record.dirtyFields.end(), field) == record.dirtyFields.end()) {
+        record.dirtyFields.push_back(field);
+    }
+    return true;
+}
+
+std::optional<StorageCache::FieldValue> StorageCache::Get(const std::string& collection, const std::string& key,
+    const std::string& field) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto record = m_records.find({ collection, key });
+    if (record == m_records.end()) {
+        return std::nullopt;
+    }
+    auto it = record->second.fields.find(field);
+    if (it == record->second.fields.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void StorageCache::SetVersion(const std::string& collection, const std::string& key, const std::string& version) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_records[{ collection, key }].version = version;
+}
+
+std::string StorageCache::GetVersion(const std::string& collection, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto record = m_records.find({ collection, key });
+    return record == m_records.end() ? std::string() : record->second.version;
+}
+
+void StorageCache::RequestFlush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_flushRequested = true;
+}
+
+bool StorageCache::ShouldFlush(Clock::time_point now) const {
+    return now >= NextFlushDeadline();
+}
+
+StorageCache::Clock::time_point StorageCache::NextFlushDeadline() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_batchInFlight || m_dirtyRecords == 0) {
+        return Clock::time_point::max();
+    }
+    const bool due = m_flushRequested || m_dirtyRecords >= m_options.flushThreshold;
+    return std::max(due ? Clock::time_point::min() : m_firstDirtyAt + m_options.flushDelay, m_retryAt);
+}
+
+std::vector<StorageCache::Write> StorageCache::TakeBatch() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Write> batch;
+    if (m_batchInFlight || m_dirtyRecords == 0) {
+        return batch;
+    }
+
+    batch.reserve(std::min(m_dirtyRecords, m_options.maxBatchSize));
+    for (auto& [id, record] : m_records) {
+        if (record.dirtyFields.empty()) {
+            continue;
+        }
+        if (batch.size() == m_options.maxBatchSize) {
+            break;
+        }
+        batch.push_back({ id.first, id.second, Serialize(record), record.version });
+        m_inFlightFields[id] = std::move(record.dirtyFields);
+        record.dirtyFields.clear();
+    }
+
+    m_dirtyRecords -= batch.size();
+    m_batchInFlight = true;
+    ++m_batchesTaken;
+    if (m_dirtyRecords == 0) {
+        m_firstDirtyAt = Clock::time_point::max();
+        m_flushRequested = false;
+    }
+    else {
+        // The rest go out as soon as this batch is acknowledged; waiters
+        // cannot tell which batch has their record, so they wait for both
+        m_flushRequested = true;
+        for (auto& waiter : m_waiters) {
+            waiter.batch = std::max(waiter.batch, m_batchesTaken + 1);
+        }
+    }
+    return batch;
+}
+
+void StorageCache::CompleteBatch(const std::vector<Ack>& acks) {
+    std::vector<FlushCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& ack : acks) {
+            auto record = m_records.find({ ack.collection, ack.key });
+            if (record != m_records.end()) {
+                record->second.version = ack.version;
+            }
+        }
+        m_inFlightFields.clear();
+        m_batchInFlight = false;
+        m_retryAt = Clock::time_point::min();
+        m_conflictRetries = 0;
+        callbacks = TakeWaitersLocked(m_batchesTaken);
+    }
+    for (auto& callback : callbacks) {
+        callback(true, "");
+    }
+}
+
+void StorageCache::FailBatch(bool versionConflict, const std::string& error, Clock::time_point now) {
+    std::vector<FlushCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [id, fields] : m_inFlightFields) {
+            Record& record = m_records[id];
+            if (record.dirtyFields.empty()) {
+                ++m_dirtyRecords;
+            }
+            for (auto& field : fields) {
+                if (std::find(record.dirtyFields.begin(), record.dirtyFields.end(), field) ==
+                    record.dirtyFields.end()) {
+                    record.dirtyFields.push_back(std::move(field));
+                }
+            }
+        }
+        m_inFlightFields.clear();
+        m_batchInFlight = false;
+        m_firstDirtyAt = std::min(m_firstDirtyAt, now);
+
+        if (versionConflict && m_conflictRetries < m_options.maxConflictRetries) {
+            // The versions were refreshed; the retry carries the same data
+            ++m_conflictRetries;
+            m_flushRequested = true;
+            for (auto& waiter : m_waiters) {
+                waiter.batch = std::max(waiter.batch, m_batchesTaken + 1);
+            }
+        }
+        else {
+            m_conflictRetries = 0;
+            m_retryAt = now + m_options.retryDelay;
+            callbacks = TakeWaitersLocked(m_batchesTaken);
+        }
+    }
+    for (auto& callback : callbacks) {
+        callback(false, error);
+    }
+}
+
+void StorageCache::WhenFlushed(FlushCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_dirtyRecords > 0 || m_batchInFlight) {
+            m_waiters.push_back({ m_dirtyRecords > 0 ? m_batchesTaken + 1 : m_batchesTaken, std::move(callback) });
+            return;
+        }
+    }
+    callback(true, "");
+}
+
+size_t StorageCache::DirtyCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dirtyRecords;
+}
+
+std::vector<std::string> StorageCache::DirtyFields(const std::string& collection, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto record = m_records.find({ collection, key });
+    return record == m_records.end() ? std::vector<std::string>() : record->second.dirtyFields;
+}
+
+bool StorageCache::IsFlushing() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_batchInFlight;
+}
+
+void StorageCache::Clear() {
+    std::vector<FlushCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_records.clear();
+        m_inFlightFields.clear();
+        m_dirtyRecords = 0;
+        m_firstDirtyAt = Clock::time_point::max();
+        m_retryAt = Clock::time_point::min();
+        m_flushRequested = false;
+        m_batchInFlight = false;
+        for (auto& waiter : m_waiters) {
+            callbacks.push_back(std::move(waiter.callback));
+        }
+        m_waiters.clear();
+    }
+    for (auto& callback : callbacks) {
+        callback(false, "cleared");
+    }
+}
+
+std::string StorageCache::Serialize(const Record& record) {
+    nlohmann::json value = nlohmann::json::object();
+    for (const auto& [name, field] : record.fields) {
+        std::visit([&value, &name](const auto& v) { value[name] = v; }, field);
+    }
+    return value.dump();
+}
+
+std::vector<StorageCache::FlushCallback> StorageCache::TakeWaitersLocked(std::uint64_t upToBatch) {
+    std::vector<FlushCallback> callbacks;
+    auto done = std::stable_partition(m_waiters.begin(), m_waiters.end(),
+        [upToBatch](const Waiter& waiter) { return waiter.batch > upToBatch; });
+    for (auto it = done; it != m_waiters.end(); ++it) {
+        callbacks.push_back(std::move(it->callback));
+    }
+    m_waiters.erase(done, m_waiters.end());
+    return callbacks;
+}
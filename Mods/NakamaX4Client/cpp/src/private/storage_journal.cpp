@@ -0,0 +1,377 @@
+#include "../public/storage_journal.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Frame header: payload length, then CRC-32 of the payload
+constexpr size_t FRAME_HEADER_BYTES = 8;
+
+void PutU32(std::string& out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void PutU64(std::string& out, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void PutString(std::string& out, const std::string& value) {
+    PutU32(out, static_cast<std::uint32_t>(value.size()));
+    out.append(value);
+}
+
+// Bounds-checked little-endian reader over one payload
+class PayloadReader
+{
+public:
+    PayloadReader(const std::string& data, size_t offset, size_t end) : m_data(data), m_offset(offset), m_end(end) {}
+
+    bool U8(std::uint8_t& value) {
+        if (m_end - m_offset < 1) {
+            return false;
+        }
+        value = static_cast<std::uint8_t>(m_data[m_offset++]);
+        return true;
+    }
+
+    bool U32(std::uint32_t& value) {
+        std::uint64_t wide = 0;
+        if (!Little(4, wide)) {
+            return false;
+        }
+        value = static_cast<std::uint32_t>(wide);
+        return true;
+    }
+
+    bool U64(std::uint64_t& value) { return Little(8, value); }
+
+    bool String(std::string& value) {
+        std::uint32_t size = 0;
+        if (!U32(size) || m_end - m_offset < size) {
+            return false;
+        }
+        value.assign(m_data, m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    bool AtEnd() const { return m_offset == m_end; }
+
+private:
+    bool Little(int bytes, std::uint64_t& value) {
+        if (m_end - m_offset < static_cast<size_t>(bytes)) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(m_data[m_offset++])) << (8 * i);
+        }
+        return true;
+    }
+
+    const std::string& m_data;
+    size_t m_offset;
+    size_t m_end;
+};
+
+bool FlushToDisk(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+std::string Frame(const std::string& payload) {
+    std::string frame;
+    frame.reserve(FRAME_HEADER_BYTES + payload.size());
+    PutU32(frame, static_cast<std::uint32_t>(payload.size()));
+    PutU32(frame, StorageJournal::Crc32(payload));
+    frame.append(payload);
+    return frame;
+}
+
+std::string WritePayload(std::uint64_t sequence, const std::string& collection, const std::string& key,
+    const std::string& value) {
+    std::string payload;
+    payload.push_back('W');
+    PutU64(payload, sequence);
+    PutString(payload, collection);
+    PutString(payload, key);
+    PutString(payload, value);
+    return payload;
+}
+
+}
+
+StorageJournal::~StorageJournal() {
+    Close();
+}
+
+bool StorageJournal::Open(const std::string& path) {
+    Close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+
+    std::string contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+    }
+    Load(contents);
+
+    // Cut off a torn or corrupt tail so new records follow valid ones
+    if (m_fileBytes < contents.size()) {
+        std::error_code error;
+        std::filesystem::resize_file(path, m_fileBytes, error);
+        if (error) {
+            return false;
+        }
+    }
+    return ReopenLocked("ab");
+}
+
+void StorageJournal::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file) {
+        WriteBufferLocked();
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_buffer.clear();
+    m_bufferedSince = Clock::time_point::max();
+    m_fileBytes = 0;
+    m_live.clear();
+}
+
+bool StorageJournal::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file != nullptr;
+}
+
+std::uint64_t StorageJournal::Append(const std::string& collection, const std::string& key,
+    const std::string& value, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::uint64_t sequence = ++m_lastSequence;
+    m_live[{ collection, key }] = { sequence, collection, key, value };
+    m_buffer.append(Frame(WritePayload(sequence, collection, key, value)));
+    m_bufferedSince = std::min(m_bufferedSince, now);
+    return sequence;
+}
+
+std::uint64_t StorageJournal::LastSequence() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastSequence;
+}
+
+void StorageJournal::Acknowledge(const std::string& collection, const std::string& key,
+    std::uint64_t upToSequence) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto live = m_live.find({ collection, key });
+    // A newer write of the object is still pending
+    if (live == m_live.end() || live->second.sequence > upToSequence) {
+        return;
+    }
+    m_live.erase(live);
+
+    if (m_live.empty()) {
+        // Nothing left to replay; start over with an empty file
+        m_buffer.clear();
+        m_bufferedSince = Clock::time_point::max();
+        if (m_fileBytes > 0 && ReopenLocked("wb")) {
+            m_fileBytes = 0;
+        }
+        return;
+    }
+
+    std::string payload;
+    payload.push_back('A');
+    PutU64(payload, upToSequence);
+    PutString(payload, collection);
+    PutString(payload, key);
+    m_buffer.append(Frame(payload));
+    m_bufferedSince = std::min(m_bufferedSince, Clock::now());
+
+    if (m_fileBytes + m_buffer.size() >= m_options.compactBytes) {
+        CompactLocked();
+    }
+}
+
+std::vector<StorageJournal::Entry> StorageJournal::Pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return PendingLocked();
+}
+
+std::vector<StorageJournal::Entry> StorageJournal::PendingLocked() const {
+    std::vector<Entry> pending;
+    pending.reserve(m_live.size());
+    for (const auto& [id, entry] : m_live) {
+        pending.push_back(entry);
+    }
+    std::sort(pending.begin(), pending.end(),
+        [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+    return pending;
+}
+
+bool StorageJournal::Sync(Clock::time_point now, bool force) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_buffer.empty() || (!force && now < m_bufferedSince + m_options.syncInterval)) {
+        return true;
+    }
+    return WriteBufferLocked();
+}
+
+StorageJournal::Clock::time_point StorageJournal::NextSyncDeadline() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bufferedSince == Clock::time_point::max() ? m_bufferedSince : m_bufferedSince + m_options.syncInterval;
+}
+
+std::uint64_t StorageJournal::FileBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_fileBytes;
+}
+
+std::uint32_t StorageJournal::Crc32(const std::string& data) {
+    static const auto table = []() {
+        std::array<std::uint32_t, 256> entries{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (char c : data) {
+        crc = table[(crc ^ static_cast<std::uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Replays the file into m_live; m_fileBytes ends at the last valid record
+void StorageJournal::Load(const std::string& contents) {
+    m_live.clear();
+    m_fileBytes = 0;
+    size_t offset = 0;
+    while (contents.size() - offset >= FRAME_HEADER_BYTES) {
+        PayloadReader header(contents, offset, offset + FRAME_HEADER_BYTES);
+        std::uint32_t length = 0;
+        std::uint32_t crc = 0;
+        header.U32(length);
+        header.U32(crc);
+        const size_t start = offset + FRAME_HEADER_BYTES;
+        if (contents.size() - start < length || Crc32(contents.substr(start, length)) != crc) {
+            break;
+        }
+
+        PayloadReader payload(contents, start, start + length);
+        std::uint8_t type = 0;
+        Entry entry;
+        if (!payload.U8(type) || !payload.U64(entry.sequence) || !payload.String(entry.collection) ||
+            !payload.String(entry.key)) {
+            break;
+        }
+        if (type == WriteRecord) {
+            if (!payload.String(entry.value) || !payload.AtEnd()) {
+                break;
+            }
+            m_live[{ entry.collection, entry.key }] = entry;
+        }
+        else if (type == AckRecord) {
+            auto live = m_live.find({ entry.collection, entry.key });
+            if (live != m_live.end() && live->second.sequence <= entry.sequence) {
+                m_live.erase(live);
+            }
+        }
+        else {
+            break;
+        }
+
+        m_lastSequence = std::max(m_lastSequence, entry.sequence);
+        offset = start + length;
+        m_fileBytes = offset;
+    }
+}
+
+bool StorageJournal::WriteBufferLocked() {
+    bool written = true;
+    if (m_file && !m_buffer.empty()) {
+        written = std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) == m_buffer.size() &&
+            FlushToDisk(m_file);
+        if (written) {
+            m_fileBytes += m_buffer.size();
+        }
+    }
+    // Without a file the journal only tracks writes in memory
+    if (written || !m_file) {
+        m_buffer.clear();
+        m_bufferedSince = Clock::time_point::max();
+    }
+    return written;
+}
+
+// Rewrites the journal with only the live writes, if those are less than
+// half of it. The new file is fsynced before it replaces the old one.
+void StorageJournal::CompactLocked() {
+    std::string contents;
+    for (const auto& entry : PendingLocked()) {
+        contents.append(Frame(WritePayload(entry.sequence, entry.collection, entry.key, entry.value)));
+    }
+    if (!m_file || contents.size() * 2 >= m_fileBytes + m_buffer.size()) {
+        return;
+    }
+
+    const std::string temporary = m_path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    const bool written = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size() &&
+        FlushToDisk(file);
+    std::fclose(file);
+
+    std::error_code error;
+    if (written) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        std::filesystem::rename(temporary, m_path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporary, error);
+        ReopenLocked("ab");
+        return;
+    }
+
+    m_fileBytes = contents.size();
+    m_buffer.clear();
+    m_bufferedSince = Clock::time_point::max();
+    ReopenLocked("ab");
+}
+
+bool StorageJournal::ReopenLocked(const char* mode) {
+    if (m_file) {
+        std::fclose(m_file);
+    }
+    m_file = std::fopen(m_path.c_str(), mode);
+    return m_file != nullptr;
+}
@@ -0,0 +1,243 @@
+#include "../public/websocket_codec.h"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    constexpr std::string_view WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    std::uint32_t RotateLeft(std::uint32_t value, int bits) {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    std::string_view Trim(std::string_view value) {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+}
+
+void WebsocketCodec::AppendFrame(std::string& out, Opcode opcode, std::string_view payload, bool fin,
+    const MaskKey* mask) {
+    const size_t size = payload.size();
+    out.push_back(static_cast<char>((fin ? 0x80 : 0x00) | static_cast<std::uint8_t>(opcode)));
+
+    const std::uint8_t maskBit = mask ? 0x80 : 0x00;
+    if (size < 126) {
+        out.push_back(static_cast<char>(maskBit | size));
+    }
+    else if (size <= 0xFFFF) {
+        out.push_back(static_cast<char>(maskBit | 126));
+        out.push_back(static_cast<char>((size >> 8) & 0xFF));
+        out.push_back(static_cast<char>(size & 0xFF));
+    }
+    else {
+        out.push_back(static_cast<char>(maskBit | 127));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<char>((static_cast<std::uint64_t>(size) >> shift) & 0xFF));
+        }
+    }
+
+    if (!mask) {
+        out.append(payload.data(), size);
+        return;
+    }
+    out.append(reinterpret_cast<const char*>(mask->data()), mask->size());
+    const size_t start = out.size();
+    out.resize(start + size);
+    for (size_t i = 0; i < size; ++i) {
+        out[start + i] = static_cast<char>(payload[i] ^ (*mask)[i & 3]);
+    }
+}
+
+WebsocketCodec::ParseResult WebsocketCodec::ParseFrame(char* data, size_t size, size_t maxPayload, Frame& frame) {
+    if (size < 2) {
+        return ParseResult::NeedMore;
+    }
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(data);
+    if (bytes[0] & 0x70) {
+        return ParseResult::Error; // No extensions negotiated
+    }
+    frame.fin = (bytes[0] & 0x80) != 0;
+    frame.opcode = static_cast<Opcode>(bytes[0] & 0x0F);
+    const bool isControl = (bytes[0] & 0x08) != 0;
+    const bool masked = (bytes[1] & 0x80) != 0;
+
+    size_t header = 2;
+    std::uint64_t length = bytes[1] & 0x7F;
+    if (length == 126) {
+        header = 4;
+        if (size < header) {
+            return ParseResult::NeedMore;
+        }
+        length = (static_cast<std::uint64_t>(bytes[2]) << 8) | bytes[3];
+    }
+    else if (length == 127) {
+        header = 10;
+        if (size < header) {
+            return ParseResult::NeedMore;
+        }
+        length = 0;
+        for (size_t i = 2; i < 10; ++i) {
+            length = (length << 8) | bytes[i];
+        }
+    }
+
+    if (isControl && (!frame.fin || length > 125)) {
+        return ParseResult::Error;
+    }
+    if (length > maxPayload) {
+        return ParseResult::Error;
+    }
+
+    const size_t maskOffset = header;
+    if (masked) {
+        header += 4;
+    }
+    if (size < header + length) {
+        return ParseResult::NeedMore;
+    }
+
+    char* payload = data + header;
+    if (masked) {
+        const std::uint8_t* key = bytes + maskOffset;
+        for (size_t i = 0; i < length; ++i) {
+            payload[i] = static_cast<char>(payload[i] ^ key[i & 3]);
+        }
+    }
+    frame.payload = std::string_view(payload, static_cast<size_t>(length));
+    frame.frameSize = header + static_cast<size_t>(length);
+    return ParseResult::Complete;
+}
+
+std::string WebsocketCodec::BuildHandshakeRequest(std::string_view host, int port, std::string_view target,
+    std::string_view key) {
+    std::string request;
+    request.reserve(256 + target.size());
+    request.append("GET ").append(target.empty() ? "/" : target).append(" HTTP/1.1\r\n");
+    request.append("Host: ").append(host).append(":").append(std::to_string(port)).append("\r\n");
+    request.append("Upgrade: websocket\r\nConnection: Upgrade\r\n");
+    request.append("Sec-WebSocket-Key: ").append(key).append("\r\n");
+    request.append("Sec-WebSocket-Version: 13\r\n\r\n");
+    return request;
+}
+
+std::string WebsocketCodec::MakeClientKey(const std::array<std::uint8_t, 16>& nonce) {
+    return Base64Encode(nonce.data(), nonce.size());
+}
+
+std::string WebsocketCodec::AcceptKey(std::string_view key) {
+    std::string input(key);
+    input.append(WEBSOCKET_GUID);
+    const auto digest = Sha1(input);
+    return Base64Encode(digest.data(), digest.size());
+}
+
+bool WebsocketCodec::ValidateHandshakeResponse(std::string_view response, std::string_view key) {
+    const size_t statusEnd = response.find("\r\n");
+    if (statusEnd == std::string_view::npos) {
+        return false;
+    }
+    // "HTTP/1.1 101 Switching Protocols"
+    const std::string_view status = response.substr(0, statusEnd);
+    const size_t codeStart = status.find(' ');
+    if (codeStart == std::string_view::npos || status.substr(codeStart + 1, 3) != "101") {
+        return false;
+    }
+
+    const std::string expected = AcceptKey(key);
+    size_t lineStart = statusEnd + 2;
+    while (lineStart < response.size()) {
+        size_t lineEnd = response.find("\r\n", lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = response.size();
+        }
+        const std::string_view line = response.substr(lineStart, lineEnd - lineStart);
+        const size_t colon = line.find(':');
+        if (colon != std::string_view::npos &&
+            EqualsIgnoreCase(Trim(line.substr(0, colon)), "Sec-WebSocket-Accept")) {
+            return Trim(line.substr(colon + 1)) == expected;
+        }
+        lineStart = lineEnd + 2;
+    }
+    return false;
+}
+
+std::string WebsocketCodec::Base64Encode(const std::uint8_t* data, size_t size) {
+    static constexpr char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3) {
+        const std::uint32_t chunk = (static_cast<std::uint32_t>(data[i]) << 16) |
+            (i + 1 < size ? static_cast<std::uint32_t>(data[i + 1]) << 8 : 0) |
+            (i + 2 < size ? static_cast<std::uint32_t>(data[i + 2]) : 0);
+        out.push_back(ALPHABET[(chunk >> 18) & 0x3F]);
+        out.push_back(ALPHABET[(chunk >> 12) & 0x3F]);
+        out.push_back(i + 1 < size ? ALPHABET[(chunk >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < size ? ALPHABET[chunk & 0x3F] : '=');
+    }
+    return out;
+}
+
+// FIPS 180-1; only used for the handshake accept key
+std::array<std::uint8_t, 20> WebsocketCodec::Sha1(std::string_view data) {
+    std::uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    std::string message(data);
+    const std::uint64_t bitLength = static_cast<std::uint64_t>(data.size()) * 8;
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56) {
+        message.push_back('\0');
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message.push_back(static_cast<char>((bitLength >> shift) & 0xFF));
+    }
+
+    for (size_t block = 0; block < message.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const std::uint8_t*>(message.data() + block + i * 4);
+            w[i] = (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+                (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f = 0;
+            std::uint32_t k = 0;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            const std::uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = RotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    std::array<std::uint8_t, 20> digest{};
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<std::uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<std::uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<std::uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<std::uint8_t>(h[i]);
+    }
+    return digest;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+enum class AsyncOperationState { Unknown, Running, Succeeded, Failed, Cancelled };
+
+struct AsyncOperationStatus
+{
+    AsyncOperationState state = AsyncOperationState::Unknown;
+    float progress = 0.0f; // 0-1
+    std::string error;
+
+    bool IsFinished() const {
+        return state == AsyncOperationState::Succeeded || state == AsyncOperationState::Failed ||
+            state == AsyncOperationState::Cancelled;
+    }
+};
+
+// Handles for client operations started from Lua without blocking the
+// caller. The network side reports progress and completion, the game side
+// polls or cancels by handle; any thread may call any method. Cancelling
+// only detaches the caller: the SDK has no per-request cancel, so a result
+// that arrives later is discarded.
+class AsyncOperationTable
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using CompletionObserver = std::function<void(int handle, const AsyncOperationStatus& status)>;
+
+    // Finished operations kept for polling until released
+    static constexpr size_t MAX_FINISHED = 64;
+
+    // Returns a new handle (> 0). The operation fails with "timeout" if it
+    // has not finished by the deadline.
+    int Begin(const std::string& kind, Clock::time_point deadline, std::function<void()> onCancel = nullptr);
+    void SetProgress(int handle, float progress);
+    // Finishes a running operation. commit runs under the table lock, only
+    // if the operation was still running, so results of a cancelled
+    // operation are never applied. Returns false if it had already finished.
+    bool Complete(int handle, bool success, const std::string& error = "",
+        const std::function<void()>& commit = nullptr);
+    bool Cancel(int handle);
+    // Fails operations past their deadline; returns the next deadline
+    Clock::time_point ExpireOverdue(Clock::time_point now);
+    void Release(int handle);
+    // Cancels everything still running
+    void CancelAll();
+
+    AsyncOperationStatus Get(int handle) const;
+    size_t RunningCount() const;
+    // Called outside the lock whenever an operation finishes
+    void SetCompletionObserver(CompletionObserver observer);
+
+    static const char* StateName(AsyncOperationState state);
+
+private:
+    struct Operation
+    {
+        std::string kind;
+        AsyncOperationStatus status;
+        Clock::time_point deadline;
+        std::uint64_t finishedOrder = 0;
+        std::function<void()> onCancel;
+    };
+
+    void FinishLocked(Operation& operation, AsyncOperationState state, const std::string& error);
+    void PruneLocked();
+    void Notify(int handle, const AsyncOperationStatus& status);
+
+    mutable std::mutex m_mutex;
+    std::map<int, Operation> m_operations;
+    int m_nextHandle = 1;
+    std::uint64_t m_finishedCount = 0;
+    CompletionObserver m_observer;
+};
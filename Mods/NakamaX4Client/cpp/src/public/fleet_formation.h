@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <msgpack.hpp>
+
+// Formation member as sent on the wire: offset from the leader expressed in
+// the leader's local frame, quantized to FleetFormation::OFFSET_QUANTUM_M.
+// Small integers pack into 1-3 bytes each with MessagePack.
+struct FormationMember
+{
+    std::string ship_id;
+    std::vector<std::int16_t> offset;
+
+    MSGPACK_DEFINE(ship_id, offset);
+};
+
+// Fleet update data structure for MessagePack serialization.
+// Carries the leader's absolute state; member offsets are only included when
+// the formation changed (or on a periodic keyframe), otherwise receivers keep
+// the formation identified by formation_version.
+struct FleetUpdate
+{
+    std::string player_id;
+    std::vector<float> position;
+    std::vector<float> rotation;
+    std::vector<float> velocity;
+    std::uint32_t formation_version = 0;
+    bool formation_included = false; // members is authoritative (may be empty)
+    std::vector<FormationMember> members;
+
+    MSGPACK_DEFINE(player_id, position, rotation, velocity, formation_version,
+        formation_included, members);
+};
+
+namespace FleetFormation {
+    // Offset resolution in metres; int16 range gives roughly +/-16 km.
+    constexpr float OFFSET_QUANTUM_M = 0.5f;
+
+    // Resend member offsets every N fleet updates even if unchanged, so
+    // receivers that missed a formation change recover.
+    constexpr int KEYFRAME_INTERVAL = 20;
+
+    // Rotation is (pitch, yaw, roll) in radians, X4 convention (y up, z forward).
+    std::vector<float> WorldToLocal(const std::vector<float>& worldOffset,
+        const std::vector<float>& rotation);
+    std::vector<float> LocalToWorld(const std::vector<float>& localOffset,
+        const std::vector<float>& rotation);
+
+    std::vector<std::int16_t> QuantizeOffset(const std::vector<float>& localOffset);
+    std::vector<float> DequantizeOffset(const std::vector<std::int16_t>& offset);
+
+    // Member key used in SectorMatchManager's player map
+    std::string MemberKey(const std::string& playerId, const std::string& shipId);
+}
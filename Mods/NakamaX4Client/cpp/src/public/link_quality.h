@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Rolling round-trip time, jitter and loss estimate from ping/pong probes
+// over the match channel. RTT and jitter follow RFC 6298 (SRTT / RTTVAR);
+// loss is the fraction of the last WINDOW resolved probes that were not
+// answered within the loss timeout.
+class LinkQualityEstimator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t WINDOW = 64;
+
+    explicit LinkQualityEstimator(std::chrono::milliseconds lossTimeout = std::chrono::milliseconds(2000));
+
+    // Returns the sequence number to put in the ping
+    std::uint32_t OnPingSent(Clock::time_point now);
+    // Returns false for unknown, duplicate or late pongs
+    bool OnPong(std::uint32_t sequence, Clock::time_point now);
+    // Marks unanswered probes older than the loss timeout as lost
+    void Expire(Clock::time_point now);
+    void Reset();
+
+    double SmoothedRttMs() const { return m_srttMs; }
+    double JitterMs() const { return m_rttVarMs; }
+    double LossRate() const;
+    std::uint64_t Samples() const { return m_samples; }
+    // Lowest RTT among answered probes in the window (0 if none)
+    double MinRttMs() const;
+    // Age of the oldest probe still waiting for its pong (0 if none). On a
+    // TCP link a send backlog delays probes instead of dropping them.
+    double OldestPendingMs(Clock::time_point now) const;
+
+    // Extra interpolation delay that covers arrival jitter on this link
+    float JitterMarginMs() const;
+
+private:
+    enum class ProbeState { Empty, Pending, Acked, Lost };
+    struct Probe
+    {
+        std::uint32_t sequence = 0;
+        Clock::time_point sentAt;
+        double rttMs = 0.0;
+        ProbeState state = ProbeState::Empty;
+    };
+
+    std::chrono::milliseconds m_lossTimeout;
+    std::array<Probe, WINDOW> m_probes{};
+    std::uint32_t m_nextSequence = 1;
+    double m_srttMs = 0.0;
+    double m_rttVarMs = 0.0;
+    std::uint64_t m_samples = 0;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "nakama_x4_client.h"
 #include "player_ship.h"
+#include "lua_dispatch_queue.h"
 
 // Lua C API headers
 extern "C" {
@@ -14,9 +15,10 @@ extern "C" {
 // Global Lua state for callbacks (set during DLL initialization)
 extern lua_State* g_luaState;
 
-// Set the Lua state for callback use
+// Set the Lua state for callback use (called by each generated luaopen_*)
 inline void SetLuaState(lua_State* L) {
     g_luaState = L;
+    LuaDispatchQueue::Instance().Attach(L);
 }
 
 // Get the Lua state for callbacks
@@ -24,6 +26,23 @@ inline lua_State* GetLuaState() {
     return g_luaState;
 }
 
+// Raises a Lua error unless called from inside a coroutine (the main
+// thread cannot yield)
+inline void RequireLuaCoroutine(lua_State* L, const char* name) {
+    if (lua_pushthread(L)) {
+        lua_pop(L, 1);
+        luaL_error(L, "%s must be called from a coroutine", name);
+    }
+    lua_pop(L, 1);
+}
+
+// Tail of a generated *Await binding: yields the calling coroutine until the
+// async operation behind handle finishes, then resumes it from the dispatch
+// queue on the Lua thread. The coroutine receives (success, error) and the
+// handle is released; if the operation has already finished, those are
+// returned without yielding.
+int AwaitOperation(lua_State* L, int handle);
+
 // Helper to push AuthResult to Lua
 inline void PushAuthResult(lua_State* L, const NakamaX4Client::AuthResult& result) {
     lua_newtable(L);
@@ -76,6 +95,9 @@ inline void PushPlayerShip(lua_State* L, const PlayerShip& ship) {
     
     lua_pushboolean(L, ship.is_remote);
     lua_setfield(L, -2, "is_remote");
+
+    lua_pushboolean(L, ship.from_other_shard);
+    lua_setfield(L, -2, "from_other_shard");
 }
 
 // Register a Lua callback with X4ScriptBase using the global Lua state
@@ -97,23 +119,10 @@ inline int RegisterLuaCallback(X4ScriptBase* script, int funcIndex) {
     // Store it in the Lua registry and get a reference
     int luaFuncRef = luaL_ref(L, LUA_REGISTRYINDEX);
     
-    // Register a C++ callback that will call the Lua function
+    // Update callbacks may run on the network thread, which must not enter
+    // Lua; queue the call for the next Pump() on the Lua thread instead
     int callbackId = script->RegisterUpdateCallback([luaFuncRef](float deltaTime) {
-        lua_State* L = GetLuaState();
-        if (!L) return;
-        
-        // Push the Lua function onto the stack
-        lua_rawgeti(L, LUA_REGISTRYINDEX, luaFuncRef);
-        
-        // Push deltaTime as argument
-        lua_pushnumber(L, deltaTime);
-        
-        // Call the Lua function (1 arg, 0 returns, 0 error handler)
-        if (lua_pcall(L, 1, 0, 0) != 0) {
-            const char* error = lua_tostring(L, -1);
-            LogToX4::Log("Error in Lua callback: %s", error);
-            lua_pop(L, 1); // Remove error message
-        }
+        LuaDispatchQueue::Instance().Post(luaFuncRef, { static_cast<double>(deltaTime) });
     });
     
     return callbackId;
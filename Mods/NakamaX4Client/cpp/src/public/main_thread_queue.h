@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Queue/run statistics for the main thread queue
+struct MainThreadQueueStats
+{
+    std::uint64_t posted = 0;
+    std::uint64_t run = 0;
+    std::uint64_t failures = 0;  // Work items that threw
+    double totalLatencyMs = 0.0; // Post to start of run, summed
+    double maxLatencyMs = 0.0;
+    double lastDrainMs = 0.0;    // Time spent in the last Drain
+
+    double AverageLatencyMs() const { return run ? totalLatencyMs / static_cast<double>(run) : 0.0; }
+};
+
+// Work handed from the network thread to the game (Lua) thread.
+// Any thread posts; the game thread runs everything queued so far in Drain,
+// once per frame, in post order.
+class MainThreadQueue
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Work = std::function<void()>;
+
+    void Post(Work work);
+    // Runs the work queued before the call; work posted while draining waits
+    // for the next frame. Returns the number of items run.
+    size_t Drain();
+    void Clear();
+    size_t PendingCount() const;
+    MainThreadQueueStats GetStats() const;
+
+private:
+    struct Item
+    {
+        Work work;
+        Clock::time_point postedAt;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<Item> m_pending;
+    std::vector<Item> m_draining; // Kept to reuse its capacity
+    MainThreadQueueStats m_stats;
+};
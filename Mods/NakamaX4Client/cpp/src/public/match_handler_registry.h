@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <msgpack.hpp>
+#include <string>
+#include <utility>
+
+// Traffic and decode-time statistics for one opcode
+struct MatchOpCodeStats
+{
+    // Bucket 0 counts decodes under 1 us, bucket i counts [2^(i-1), 2^i) us,
+    // the last bucket everything slower
+    static constexpr size_t HISTOGRAM_BUCKETS = 16;
+
+    std::string name;
+    std::uint64_t messages = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t failures = 0; // Malformed payloads or handler exceptions
+    std::array<std::uint64_t, HISTOGRAM_BUCKETS> decodeHistogram{};
+
+    // Upper bound (us) of the bucket containing the given percentile (0-100)
+    double DecodePercentileUs(double percentile) const;
+};
+
+// Inbound match data dispatch.
+// Subsystems register a handler per opcode, either raw (bytes in, returns
+// false if malformed) or typed with a codec that decodes into T first.
+// Dispatch is a bounds check and an index into a flat table; per-opcode
+// counters and decode-time histograms are collected for every handler.
+// Register handlers before the realtime connection starts delivering data.
+class MatchHandlerRegistry
+{
+public:
+    static constexpr std::int64_t MAX_OPCODES = 64;
+
+    using RawHandler = std::function<bool(const char* data, size_t size)>;
+    template <typename T>
+    using Decoder = std::function<bool(const char* data, size_t size, T& out)>;
+
+    enum class DispatchResult { Handled, Malformed, Unknown };
+
+    // Raw handlers decode inline; the whole call is timed
+    bool RegisterRaw(std::int64_t opCode, const std::string& name, RawHandler handler);
+
+    // Typed handler: only decode is timed, then handle runs with the result
+    template <typename T>
+    bool Register(std::int64_t opCode, const std::string& name, Decoder<T> decode,
+        std::function<void(const T&)> handle);
+
+    // Typed handler using msgpack-c (MSGPACK_DEFINE types)
+    template <typename T>
+    bool Register(std::int64_t opCode, const std::string& name,
+        std::function<void(const T&)> handle);
+
+    void Unregister(std::int64_t opCode);
+    bool IsRegistered(std::int64_t opCode) const;
+
+    // Handler exceptions are counted as failures and rethrown
+    DispatchResult Dispatch(std::int64_t opCode, const char* data, size_t size);
+
+    MatchOpCodeStats GetStats(std::int64_t opCode) const;
+    std::uint64_t GetUnknownCount() const { return m_unknown.load(std::memory_order_relaxed); }
+
+    // Default codec for msgpack-c types
+    template <typename T>
+    static bool DecodeMsgPack(const char* data, size_t size, T& out);
+
+private:
+    struct Slot
+    {
+        std::string name;
+        RawHandler handler;
+        bool timesWholeCall = true; // Typed handlers record decode time themselves
+        std::atomic<std::uint64_t> messages{ 0 };
+        std::atomic<std::uint64_t> bytes{ 0 };
+        std::atomic<std::uint64_t> failures{ 0 };
+        std::array<std::atomic<std::uint64_t>, MatchOpCodeStats::HISTOGRAM_BUCKETS> histogram{};
+    };
+
+    static bool InRange(std::int64_t opCode) { return opCode >= 0 && opCode < MAX_OPCODES; }
+    bool Install(std::int64_t opCode, const std::string& name, RawHandler handler, bool timesWholeCall);
+    void RecordDecode(std::int64_t opCode, std::chrono::steady_clock::duration elapsed);
+
+    std::array<Slot, MAX_OPCODES> m_slots;
+    std::atomic<std::uint64_t> m_unknown{ 0 };
+};
+
+template <typename T>
+bool MatchHandlerRegistry::Register(std::int64_t opCode, const std::string& name,
+    Decoder<T> decode, std::function<void(const T&)> handle) {
+    auto handler = [this, opCode, decode = std::move(decode), handle = std::move(handle)](
+        const char* data, size_t size) {
+        T value{};
+        const auto start = std::chrono::steady_clock::now();
+        const bool decoded = decode(data, size, value);
+        RecordDecode(opCode, std::chrono::steady_clock::now() - start);
+        if (!decoded) {
+            return false;
+        }
+        handle(value);
+        return true;
+    };
+    return Install(opCode, name, std::move(handler), false);
+}
+
+template <typename T>
+bool MatchHandlerRegistry::Register(std::int64_t opCode, const std::string& name,
+    std::function<void(const T&)> handle) {
+    return Register<T>(opCode, name, Decoder<T>(&MatchHandlerRegistry::DecodeMsgPack<T>),
+        std::move(handle));
+}
+
+template <typename T>
+bool MatchHandlerRegistry::DecodeMsgPack(const char* data, size_t size, T& out) {
+    msgpack::object_handle oh = msgpack::unpack(data, size);
+    oh.get().convert(out);
+    return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+// Match data opcodes shared with server/modules/sector_match_handler.lua.
+// Keep both sides in sync when adding a new message type.
+namespace MatchOpCode {
+    constexpr std::int64_t Position = 1; // PositionUpdate (single ship)
+    constexpr std::int64_t Fleet = 2;    // FleetUpdate (leader + formation offsets)
+    constexpr std::int64_t Snapshot = 3; // Server tick aggregate: [tick, [[opCode, payload], ...]]
+    constexpr std::int64_t FullSnapshot = 4; // Late-join state of every presence, same layout
+    constexpr std::int64_t ShardGhosts = 5;  // Coarse state from sibling shards, same layout
+    constexpr std::int64_t Ping = 6;         // Client probe: [sequence]
+    constexpr std::int64_t Pong = 7;         // Server echo of a Ping, to the sender only
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Forward-only MessagePack reader over a borrowed buffer.
+// Used on the hot inbound path instead of msgpack::unpack, which builds a
+// zone and an object tree per message: this reader never allocates, and
+// strings come back as views into the source buffer. Every Read* returns
+// false (and leaves the reader failed) on malformed or unexpected input.
+class MsgPackReader
+{
+public:
+    MsgPackReader(const char* data, size_t size) : m_pos(data), m_end(data + size) {}
+
+    bool ReadArrayHeader(std::uint32_t& count);
+    bool ReadMapHeader(std::uint32_t& count);
+    bool ReadString(std::string_view& out);
+    bool ReadInt(std::int64_t& out);
+    bool ReadBool(bool& out);
+    // Accepts float32, float64 and integers
+    bool ReadFloat(float& out);
+
+    // Skip one complete value, including nested arrays and maps
+    bool Skip();
+    // Bytes of the next complete value, for handing to another decoder
+    bool ReadRaw(std::string_view& out);
+
+    bool Ok() const { return !m_failed; }
+    bool AtEnd() const { return m_pos == m_end; }
+
+private:
+    bool Fail() { m_failed = true; return false; }
+    bool Take(size_t n, const char*& out);
+    bool ReadBigEndian(size_t n, std::uint64_t& out);
+    // tag8 is -1 for types without an 8-bit length form (array, map)
+    bool ReadLength(std::uint8_t tag, int tag8, std::uint8_t tag16, std::uint8_t tag32,
+        std::uint32_t& length);
+
+    const char* m_pos;
+    const char* m_end;
+    bool m_failed = false;
+};
+
+// Fixed-size view of a PositionUpdate (see sector_match.h). player_id points
+// into the message buffer and is only valid while that buffer is alive.
+struct PositionUpdateView
+{
+    std::string_view player_id;
+    std::array<float, 3> position{};
+    std::array<float, 3> rotation{};
+    std::array<float, 3> velocity{};
+};
+
+namespace MatchDecode {
+    // [player_id, position, rotation, velocity]; vectors shorter than 3 are
+    // zero-filled, extra components are ignored
+    bool ReadPositionUpdate(MsgPackReader& reader, PositionUpdateView& out);
+    bool ReadFloat3(MsgPackReader& reader, std::array<float, 3>& out);
+}
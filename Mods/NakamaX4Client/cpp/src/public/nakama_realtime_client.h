@@ -1,25 +1,192 @@
 #pragma once
 #include "x4_script_base.h"
+#include "outbound_queue.h"
+#include "msgpack_reader.h"
+#include "match_handler_registry.h"
+#include "reconnect_backoff.h"
+#include "link_quality.h"
+#include "send_rate_controller.h"
+#include "replication_scheduler.h"
+#include "poll_websocket_transport.h"
+#include "nakama_tasks.h"
 #include <nakama-cpp/Nakama.h>
 #include <nakama-cpp/realtime/NRtClientListenerInterface.h>
+#include <msgpack.hpp>
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Latency statistics (per RPC transport path, reconnect recovery)
+struct LatencyStats {
+    std::uint64_t calls = 0;
+    std::uint64_t failures = 0;
+    double totalMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double lastMs = 0.0;
+
+    void Record(double ms) {
+        minMs = calls == 0 ? ms : std::min(minMs, ms);
+        maxMs = std::max(maxMs, ms);
+        lastMs = ms;
+        totalMs += ms;
+        ++calls;
+    }
+    double AverageMs() const { return calls ? totalMs / static_cast<double>(calls) : 0.0; }
+};
+
+// Result of resolving and joining a sector's match; matchId is empty when
+// the server has no match for the sector
+struct SectorMatchJoin {
+    std::string matchId;
+    int shard = 0;
+};
+
+// Realtime connection lifecycle
+enum class RealtimeConnectionState {
+    Disconnected,       // Not started or shut down
+    Connecting,         // Initial connect in flight
+    Connected,
+    WaitingToReconnect, // Connection lost, backoff timer running
+    Reconnecting        // Session refresh / connect / rejoin in flight
+};
 
 // Nakama Realtime Client class - handles realtime connections and matchmaking
 class NakamaRealtimeClient : public X4ScriptSingleton<NakamaRealtimeClient>, public Nakama::NRtClientListenerInterface {
 public:
     friend class X4ScriptSingleton<NakamaRealtimeClient>;
 
-    bool Initialize(std::shared_ptr<Nakama::NSessionInterface> session, std::shared_ptr<Nakama::NClientInterface> client, std::function<void(bool)> callback = nullptr);
+    // eventDrivenTransport selects PollWebsocketTransport over the SDK's
+    // default websocket (plain ws:// only)
+    bool Initialize(std::shared_ptr<Nakama::NSessionInterface> session, std::shared_ptr<Nakama::NClientInterface> client, std::function<void(bool)> callback = nullptr, bool eventDrivenTransport = false);
     void Shutdown();
+    // Session for later reconnects, e.g. after a background refresh. Any
+    // thread.
+    void SetSession(std::shared_ptr<Nakama::NSessionInterface> session);
+
+    // Blocks the network thread until realtime socket activity, WakeNetwork
+    // or the timeout. Returns false without waiting when there is no socket
+    // to wait on (SDK transport or not connected).
+    bool WaitForNetwork(std::chrono::milliseconds timeout);
+    // Interrupts WaitForNetwork from any thread
+    void WakeNetwork();
+    // When the network thread next needs to run Update if no socket activity
+    // arrives first
+    std::chrono::steady_clock::time_point NextNetworkDeadline(std::chrono::steady_clock::time_point now) const;
+    // Called from any thread when work is queued for the network thread
+    void SetNetworkWakeHandler(std::function<void()> handler);
+    // Runs inbound events that touch game state (match data, presences) on
+    // another thread, e.g. posts them to the game thread. Null handles them
+    // on the thread that ticks the socket. Pongs are always handled there so
+    // RTT samples exclude the hand-off.
+    using InboundExecutor = std::function<void(std::function<void()>)>;
+    void SetInboundExecutor(InboundExecutor executor);
 
     // LUA_EXPORT
     bool IsConnected() const;
+    // True while the client is recovering a dropped connection
+    // LUA_EXPORT
+    bool IsReconnecting() const;
+    RealtimeConnectionState GetConnectionState() const { return m_state; }
+
+    // Time from losing the connection to being back in the match
+    // LUA_EXPORT
+    float GetLastRecoveryMs() const;
+    // LUA_EXPORT
+    int GetReconnectCount() const;
+    LatencyStats GetRecoveryStats() const;
+
+    // Link quality from ping/pong probes over the match channel
+    // LUA_EXPORT
+    float GetRttMs() const;
+    // LUA_EXPORT
+    float GetJitterMs() const;
+    // Fraction (0-1) of recent probes that went unanswered
+    // LUA_EXPORT
+    float GetPacketLoss() const;
+    LinkQualityEstimator GetLinkQuality() const;
+
+    // Local state send rate chosen by the congestion controller
+    // LUA_EXPORT
+    float GetSendRateHz() const;
+    // Times the send rate was cut because the link looked congested
+    // LUA_EXPORT
+    int GetCongestionEvents() const;
+    // Blocks until the sector's match is joined (up to the RPC and join
+    // timeouts); the game thread uses JoinOrCreateMatchAsync instead
     // LUA_EXPORT
     bool JoinOrCreateMatch(const std::string& matchId = "");
+    // Non-blocking JoinOrCreateMatch: returns an operation handle (see
+    // NakamaX4Client::GetOperationState). The match is applied where inbound
+    // events are, and dropped if the sector changed meanwhile.
+    // LUA_EXPORT_AWAIT
+    int JoinOrCreateMatchAsync(const std::string& sectorName);
     // LUA_EXPORT
     void SendPosition(const std::string& data);
+    // Queues match data; it is written to the socket on the next network tick.
+    // A pending replaceable message is superseded by a newer one with the same
+    // opcode; pass replaceable = false for data that must arrive, such as a
+    // formation keyframe.
+    void SendMatchData(std::int64_t opCode, const std::string& data, bool replaceable = true);
+    // Hands the latest state of a replicated entity to the scheduler, which
+    // decides when it is sent within the connection's bandwidth budget
+    void Replicate(const std::string& entityId, std::int64_t opCode, const std::string& data,
+        const ReplicationHints& hints);
+    // Drops the entity's unsent state, e.g. when it leaves the match
+    void StopReplicating(const std::string& entityId);
+
+    // Replication bandwidth budget for this connection
+    // LUA_EXPORT
+    void SetReplicationBudget(int bytesPerSecond);
+    // LUA_EXPORT
+    int GetReplicationBudget() const;
+    // Longest time an entity has currently been waiting for a send
+    // LUA_EXPORT
+    float GetReplicationStarvationMs() const;
+    // Entity updates left waiting because the budget ran out, summed per tick
+    // LUA_EXPORT
+    int GetDeferredReplicationCount() const;
+    ReplicationStats GetReplicationStats() const;
+
+    // Outbound traffic per opcode since startup
+    // LUA_EXPORT
+    int GetSentMessageCount(int opCode) const;
+    // LUA_EXPORT
+    int GetSentBytes(int opCode) const;
+    OpCodeCounters GetOutboundCounters(std::int64_t opCode) const;
+
+    // Inbound match data handlers; subsystems register their opcodes here
+    MatchHandlerRegistry& GetMatchHandlers() { return m_matchHandlers; }
+    MatchOpCodeStats GetInboundStats(std::int64_t opCode) const;
+    // LUA_EXPORT
+    int GetReceivedMessageCount(int opCode) const;
+    // Decode time (us) at the given percentile (0-100), histogram resolution
+    // LUA_EXPORT
+    float GetDecodePercentileUs(int opCode, float percentile) const;
+
+    // Call a server RPC over the realtime socket when connected, falling back
+    // to the HTTP client otherwise. A socket call that fails or times out may
+    // still have run on the server, so it is only repeated over HTTP if the
+    // RPC is idempotent. Blocks until the response arrives; throws if the
+    // call fails.
+    Nakama::NRpc CallRpc(const std::string& id, const std::string& payload, bool idempotent = false);
+    // Non-blocking CallRpc, run on the network executor
+    Task<Nakama::NRpc> CallRpcAsync(std::string id, std::string payload, bool idempotent = false);
+    // Resolves the sector's match (request is BuildMatchRequest's JSON) and
+    // joins it. The caller applies the result with ApplyMatchJoin.
+    Task<SectorMatchJoin> JoinSectorMatchAsync(std::string sectorName, std::string request);
+
+    // RPC latency per path: "socket" or "http"
+    // LUA_EXPORT
+    float GetRpcAverageLatencyMs(const std::string& path) const;
+    // LUA_EXPORT
+    int GetRpcCallCount(const std::string& path) const;
+    LatencyStats GetRpcStats(const std::string& path) const;
     // LUA_EXPORT
     void LeaveMatch();
 
@@ -37,13 +204,86 @@ public:
 
 private:
     std::shared_ptr<Nakama::NRtClientInterface> m_rtClient;
-    std::shared_ptr<Nakama::NSessionInterface> m_session;
+    std::shared_ptr<PollWebsocketTransport> m_transport; // Null with the SDK transport
+    mutable std::mutex m_transportMutex;
+    std::function<void()> m_networkWakeHandler; // Guarded by m_transportMutex
+    InboundExecutor m_inboundExecutor;          // Guarded by m_transportMutex
+    // Replaced on the game and network threads, read by inbound handlers:
+    // only accessed through Session() / StoreSession() / IsSelf()
+    mutable std::mutex m_sessionMutex;
+    std::shared_ptr<Nakama::NSessionInterface> m_session; // Guarded by m_sessionMutex
+    std::string m_userId;                                 // m_session's user, likewise
     std::shared_ptr<Nakama::NClientInterface> m_client;
-    std::string m_currentMatchId;
+    // Set on the game thread (join, leave) and the network thread (rejoin,
+    // disconnect), read by both: only accessed through CurrentMatchId() /
+    // InMatch() / SetCurrentMatchId()
+    mutable std::mutex m_matchMutex;
+    std::string m_currentMatchId; // Guarded by m_matchMutex
     std::atomic<bool> m_connected;
+    std::atomic<RealtimeConnectionState> m_state;
+    std::int64_t m_lastServerTick; // Last applied snapshot tick
+    OutboundQueue m_outbound;
+    ReplicationScheduler m_replication;
+    MatchHandlerRegistry m_matchHandlers;
+
+    // Reused by the position hot path so decoding and applying an update
+    // does not allocate once warmed up
+    std::string m_scratchPlayerId;
+    std::vector<float> m_scratchPosition;
+    std::vector<float> m_scratchRotation;
+    std::vector<float> m_scratchVelocity;
+
+    mutable std::mutex m_rpcStatsMutex;
+    LatencyStats m_socketRpcStats;
+    LatencyStats m_httpRpcStats;
+    LatencyStats m_recoveryStats; // Guarded by m_rpcStatsMutex as well
 
+    // Reconnect state; only touched on the network thread
+    ReconnectBackoff m_backoff;
+    std::chrono::steady_clock::time_point m_nextReconnectAttempt;
+    std::chrono::steady_clock::time_point m_disconnectedAt;
+    std::string m_rejoinSector; // Sector match to rejoin after reconnecting
+
+    mutable std::mutex m_linkMutex;
+    LinkQualityEstimator m_linkQuality;
+    SendRateController m_sendRate; // Guarded by m_linkMutex
+    std::chrono::steady_clock::time_point m_lastPingSent;
+
+    std::shared_ptr<Nakama::NSessionInterface> Session() const;
+    void StoreSession(std::shared_ptr<Nakama::NSessionInterface> session);
+    // Whether playerId is the local player
+    bool IsSelf(std::string_view playerId) const;
+    std::string CurrentMatchId() const;
+    bool InMatch() const;
+    void SetCurrentMatchId(std::string matchId);
     void OnRealtimeConnected();
     void OnRealtimeDisconnected();
     void OnMatchJoined(const std::string& matchId);
+    void ApplyMatchJoin(const SectorMatchJoin& match);
     void OnMatchLeft();
+    void RegisterSectorHandlers();
+    bool HandleSnapshot(MsgPackReader& reader);
+    bool HandleBulkSnapshot(std::int64_t opCode, const msgpack::object& obj);
+    void ApplyPosition(const PositionUpdateView& update);
+    void DispatchMatchData(std::int64_t opCode, const char* data, size_t size);
+    void ApplyPresence(const Nakama::NMatchPresenceEvent& matchPresence);
+    InboundExecutor GetInboundExecutor() const;
+    // Runs work through the inbound executor, or right away without one
+    void RunInbound(std::function<void()> work);
+    void FinishMatchJoin(int handle, const std::string& sectorName, const SectorMatchJoin& match);
+    void FlushOutbound();
+    void ScheduleReplication();
+    void RecordRpc(LatencyStats& stats, std::chrono::steady_clock::time_point start, bool success);
+    std::string BuildMatchRequest(const std::string& sectorName) const;
+
+    void ScheduleReconnect();
+    void AttemptReconnect();
+    void ConnectSocket();
+    void RejoinSector();
+    void RecordRecovery();
+
+    void NotifyNetwork();
+    void SendPingIfDue();
+    void OnPong(std::uint32_t sequence);
+    void AdaptToLink();
 };
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "coro_task.h"
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Failed Nakama request (NError from the REST client, NRtError from the
+// realtime socket), as thrown into an awaiting task
+class NakamaError : public std::runtime_error
+{
+public:
+    NakamaError(const std::string& message, int code) : std::runtime_error(message), m_code(code) {}
+
+    int Code() const { return m_code; }
+
+private:
+    int m_code;
+};
+
+// Awaits an SDK call that takes a success/error callback pair:
+//   auto session = co_await NakamaCall<Nakama::NSessionPtr>(
+//       [&](auto onSuccess, auto onError) { client->authenticateDevice(..., onSuccess, onError); });
+// The SDK calls back from its tick; the task resumes on its scheduler.
+template <typename T, typename Start>
+auto NakamaCall(Start start) {
+    return FromCallbacks<T>(std::move(start), [](const auto& error) {
+        return std::make_exception_ptr(NakamaError(error.message, static_cast<int>(error.code)));
+    });
+}
@@ -1,22 +1,48 @@
 #pragma once
 #include "x4_script_base.h"
 #include "nakama_realtime_client.h"
+#include "pooled_http_transport.h"
+#include "network_executor.h"
+#include "main_thread_queue.h"
+#include "async_operation.h"
+#include "storage_cache.h"
+#include "storage_journal.h"
+#include "session_store.h"
+#include "nakama_tasks.h"
 #include <nakama-cpp/Nakama.h>
 #include <string>
 #include <memory>
 #include <future>
 #include <atomic>
 #include <functional>
+#include <stdexcept>
+#include <vector>
 
 // Nakama X4 Client class - encapsulates all Nakama functionality
 class NakamaX4Client : public X4ScriptSingleton<NakamaX4Client> {
 public:
+    // Where network I/O runs. Lua calls Pump() every frame in both modes.
+    enum class ExecutionMode {
+        // A dedicated network thread does all I/O; inbound match events are
+        // queued and applied on the game thread by Pump()
+        Threaded,
+        // Pump() ticks the network on the game thread; no extra thread
+        FrameDriven
+    };
+
     // Configuration structure
     struct Config {
         std::string host;
         int port;
         std::string serverKey;
         bool useSSL = false;
+        // Use the readiness-driven websocket transport (plain ws:// only;
+        // the SDK transport is always used with SSL)
+        bool eventDrivenTransport = true;
+        // Route REST calls through the keep-alive connection pool (plain
+        // http:// only; the SDK transport is always used with SSL)
+        bool pooledHttpTransport = true;
+        ExecutionMode executionMode = ExecutionMode::Threaded;
     };
 
     // Authentication result
@@ -42,27 +68,188 @@ public:
     // LUA_EXPORT
     void Shutdown() override;
     
+    // A session restored at Initialize for the same device is reused without
+    // a request; it is refreshed in the background as it nears expiry.
     // LUA_EXPORT
     AuthResult Authenticate(const std::string& deviceId, const std::string& username);
+    // Player data goes through a write-behind cache: a sync with unchanged
+    // values sends nothing, changes are coalesced into one batched write.
     // LUA_EXPORT
     SyncResult SyncPlayerData(const std::string& playerName, long long credits, long long playtime);
+
+    // Non-blocking variants: return an operation handle right away; poll it
+    // with GetOperationState. The blocking calls above wait up to 20 s / 5 s.
+    // Also exported as AuthenticateAwait / SyncPlayerDataAwait, which yield
+    // the calling Lua coroutine until the result is in.
+    // LUA_EXPORT_AWAIT
+    int AuthenticateAsync(const std::string& deviceId, const std::string& username);
+    // LUA_EXPORT_AWAIT
+    int SyncPlayerDataAsync(const std::string& playerName, long long credits, long long playtime);
+    // "running", "succeeded", "failed", "cancelled" or "unknown"
+    // LUA_EXPORT
+    std::string GetOperationState(int handle) const;
+    // LUA_EXPORT
+    float GetOperationProgress(int handle) const;
+    // LUA_EXPORT
+    std::string GetOperationError(int handle) const;
+    // The caller stops waiting; a late result is discarded
+    // LUA_EXPORT
+    bool CancelOperation(int handle);
+    // Forgets a finished operation
+    // LUA_EXPORT
+    void ReleaseOperation(int handle);
+    AsyncOperationTable& GetOperations() { return m_operations; }
+    // Handles of operations that finish at once, e.g. rejected up front
+    int FailedOperation(const std::string& kind, const std::string& error);
+    int SucceededOperation(const std::string& kind);
+    // Refreshes the current session now, joining a refresh already running,
+    // and adopts the result like any other (persisted, handed to the realtime
+    // client). onDone(success) runs on the network thread afterwards.
+    void RefreshSessionNow(std::function<void(bool)> onDone);
+
+    // Mean latency of REST calls through the pooled transport (0 without it)
+    // LUA_EXPORT
+    float GetHttpAverageLatencyMs() const;
+    // REST calls that skipped connection setup by reusing a pooled connection
+    // LUA_EXPORT
+    int GetHttpReusedRequests() const;
+    // Network thread rounds since startup; stays low while idle
+    // LUA_EXPORT
+    int GetNetworkTicks() const;
+
+    // Called by Lua once per frame: runs frame callbacks and the events the
+    // network thread queued, and in frame-driven mode ticks the network
+    // LUA_EXPORT
+    void Pump();
+    // "threaded" or "frame"; can be switched at any time
+    // LUA_EXPORT
+    bool SetExecutionMode(const std::string& mode);
+    // LUA_EXPORT
+    std::string GetExecutionMode() const;
+    // Time the last Pump() took on the game thread
+    // LUA_EXPORT
+    float GetPumpTimeMs() const;
+    // Average time inbound events waited for Pump() in threaded mode
+    // LUA_EXPORT
+    float GetMainThreadLatencyMs() const;
+    MainThreadQueueStats GetMainThreadStats() const { return m_mainThread.GetStats(); }
+
+    // Waits for a future completed by a network callback. In frame-driven
+    // mode nothing else ticks the network, so the wait pumps it.
+    template <typename T>
+    std::future_status AwaitNetwork(std::future<T>& future, std::chrono::milliseconds timeout) {
+        if (m_executionMode != ExecutionMode::FrameDriven || !m_client) {
+            return future.wait_for(timeout);
+        }
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            const auto now = std::chrono::steady_clock::now();
+            m_network.RunPending(now);
+            NetworkTick(now);
+            if (future.wait_for(std::chrono::milliseconds(1)) == std::future_status::ready) {
+                return std::future_status::ready;
+            }
+            if (now >= deadline) {
+                return std::future_status::timeout;
+            }
+        }
+    }
+
+    // Starts a task on the network executor (run by Pump() in frame-driven
+    // mode). Shutdown cancels it.
+    template <typename T>
+    std::future<T> StartTask(Task<T> task) {
+        return Spawn(m_network, std::move(task), m_tasks.Token());
+    }
+    // done gets the finished task's result on the network thread
+    template <typename T>
+    void StartTask(Task<T> task, std::type_identity_t<std::function<void(std::future<T>)>> done) {
+        Spawn<T>(m_network, std::move(task), std::move(done), m_tasks.Token());
+    }
+
+    // Runs a task to completion from outside the network thread. Throws
+    // TaskTimeout, and cancels the task, if it takes longer than timeout.
+    template <typename T>
+    T RunTask(Task<T> task, std::chrono::milliseconds timeout) {
+        if (m_network.IsExecutorThread()) {
+            throw std::logic_error("RunTask would block the network thread");
+        }
+        CancellationSource source(m_tasks.Token());
+        auto future = Spawn(m_network, std::move(task), source.Token());
+        if (AwaitNetwork(future, timeout) != std::future_status::ready) {
+            source.Cancel();
+            throw TaskTimeout();
+        }
+        return future.get();
+    }
     
 
 private:
-    std::thread StartUpdater();
+    bool StartUpdater();
+    void ApplyExecutionMode();
+    std::chrono::steady_clock::time_point NetworkTick(std::chrono::steady_clock::time_point now);
     // Nakama SDK objects
     std::shared_ptr<Nakama::NClientInterface> m_client;
+    // Written on the network thread, read from the game thread: only
+    // accessed under m_sessionMutex (Session(), SetSession(), AdoptSession())
     std::shared_ptr<Nakama::NSessionInterface> m_session;
+    std::shared_ptr<PooledHttpTransport> m_httpTransport;
 
-    std::thread m_updaterThread;
+    Config m_config;
     std::chrono::steady_clock::time_point m_lastUpdateTime;
 
     // Async operation handling
     std::atomic<bool> m_authenticating;
-    std::atomic<bool> m_syncing;
+    // Flushed from the network tick
+    StorageCache m_storage;
+    // Staged writes not yet acknowledged, replayed after a restart
+    StorageJournal m_journal;
+
+    // Tokens of the current session, persisted across game loads
+    SessionStore m_sessionStore;
+    mutable std::mutex m_sessionMutex;
+    std::string m_sessionDevice; // Guarded by m_sessionMutex
+    std::atomic<bool> m_refreshingSession{ false };
+    std::vector<std::function<void(bool)>> m_refreshWaiters; // Guarded by m_sessionMutex
+    std::atomic<std::chrono::steady_clock::time_point> m_sessionRefreshAt{
+        std::chrono::steady_clock::time_point::max() };
+
+    std::atomic<ExecutionMode> m_executionMode{ ExecutionMode::Threaded };
+    MainThreadQueue m_mainThread;
+    std::chrono::steady_clock::time_point m_lastPumpTime;
+    std::atomic<float> m_lastPumpMs{ 0.0f };
+    bool m_pumped = false; // Pump() seen; inbound events are only queued once it is
+
+    // Declared after everything its thread touches, so it is stopped first
+    NetworkExecutor m_network;
+
+    AsyncOperationTable m_operations;
+    // Parent of every task started through StartTask / RunTask
+    CancellationSource m_tasks;
 
+    Nakama::NSessionPtr Session() const;
+    void SetSession(Nakama::NSessionPtr session);
     AuthResult PerformAuthentication(const std::string& deviceId, const std::string& username);
-    SyncResult PerformDataSync(const std::string& playerName, long long credits, long long playtime);
+    SyncResult PerformDataSync();
+    Task<Nakama::NSessionPtr> AuthenticateDevice(std::string deviceId, std::string username);
+    std::string ServerId() const;
+    void RestoreSession();
+    // Makes session current: persists it, schedules its refresh and starts
+    // (or updates) the realtime connection. With onlyReplacing set, gives up
+    // (returning false) unless the current session is still that one or none.
+    bool AdoptSession(Nakama::NSessionPtr session, const std::string& deviceId,
+        Nakama::NSessionPtr onlyReplacing = nullptr);
+    bool HasSessionFor(const std::string& deviceId) const;
+    std::string SessionDevice() const;
+    void StartSessionRefresh(Nakama::NSessionPtr session, std::function<void(bool)> onDone = nullptr);
+    Task<Nakama::NSessionPtr> RefreshSession(Nakama::NSessionPtr session);
+    // Returns true if any value changed
+    bool StagePlayerData(const std::string& playerName, long long credits, long long playtime);
+    void OpenStorageJournal();
+    void StartStorageFlush(Nakama::NSessionPtr session);
+    // journaled: last journal sequence before the batch was taken
+    Task<void> WriteStorageBatch(Nakama::NSessionPtr session, std::vector<StorageCache::Write> batch,
+        std::uint64_t journaled);
 public:
     NakamaX4Client();
     ~NakamaX4Client() override = default;
@@ -77,7 +264,7 @@ public:
     bool IsAuthenticated() const;
 
     #ifdef UNIT_TESTS
-    std::shared_ptr<Nakama::NSessionInterface> GetSession() const { return m_session; }
+    std::shared_ptr<Nakama::NSessionInterface> GetSession() const { return Session(); }
     std::shared_ptr<Nakama::NClientInterface> GetClient() const { return m_client; }
     #endif
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Thin portability layer over Winsock / BSD sockets for the realtime
+// transport: non-blocking TCP, readiness polling (WSAPoll / poll) and a
+// loopback wake socket to interrupt a blocked poll from another thread.
+namespace NetSocket
+{
+#ifdef _WIN32
+    using Handle = std::uintptr_t; // SOCKET
+#else
+    using Handle = int;
+#endif
+    constexpr Handle INVALID_HANDLE = static_cast<Handle>(-1);
+
+    struct PollEntry
+    {
+        Handle socket = INVALID_HANDLE;
+        bool wantRead = false;
+        bool wantWrite = false;
+        // Results
+        bool readable = false;
+        bool writable = false;
+        bool failed = false; // Error or hang-up
+    };
+
+    // Initializes Winsock once per process; no-op elsewhere
+    bool Startup();
+    void Close(Handle socket);
+
+    // Resolves host and starts a non-blocking connect with TCP_NODELAY set.
+    // Completion is signalled by the socket becoming writable; check it with
+    // ConnectError. Returns INVALID_HANDLE and fills error on failure.
+    Handle ConnectNonBlocking(const std::string& host, int port, std::string& error);
+    // Pending socket error after a non-blocking connect (0 = connected)
+    int ConnectError(Handle socket);
+
+    // Returns bytes transferred, 0 on orderly shutdown (Recv only), or -1 on
+    // error; wouldBlock is set when the call should be retried later
+    int Send(Handle socket, const char* data, size_t size, bool& wouldBlock);
+    int Recv(Handle socket, char* data, size_t size, bool& wouldBlock);
+
+    // Waits up to timeoutMs (-1 = forever) for any entry to become ready.
+    // Returns the number of ready entries, 0 on timeout, -1 on error.
+    int Poll(PollEntry* entries, size_t count, int timeoutMs);
+
+    // UDP socket on 127.0.0.1 connected to itself. Signal writes one byte,
+    // which makes it readable; Drain empties it again.
+    Handle CreateWakeSocket();
+    void SignalWake(Handle wakeSocket);
+    void DrainWake(Handle wakeSocket);
+
+    // Blocking listener on 127.0.0.1 with an OS-assigned port (loopback
+    // stand-ins in tests)
+    Handle ListenLoopback(int& port);
+    Handle Accept(Handle listener);
+
+    int LastError();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "coro_task.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Runs the client's network work on one thread that sleeps until there is
+// something to do: socket activity, a due timer, posted work or an explicit
+// Wake. Each round runs due work, then the tick function, which returns when
+// it next needs to run. While a socket source is installed the thread blocks
+// in it (its wake signal interrupts the wait); otherwise it waits on a
+// condition variable. Tasks spawned on it resume on the network thread.
+class NetworkExecutor : public TaskScheduler
+{
+public:
+    // One round of network work; returns the time it next needs to run
+    // (Clock::time_point::max() for "only when woken")
+    using TickFunction = std::function<Clock::time_point(Clock::time_point now)>;
+    // Blocks until socket activity, its wake signal or the timeout. Returns
+    // false without waiting when there is no socket to wait on.
+    using SocketWait = std::function<bool(std::chrono::milliseconds timeout)>;
+    // Interrupts SocketWait from any thread
+    using SocketWake = std::function<void()>;
+    using Work = std::function<void()>;
+
+    struct Stats
+    {
+        std::uint64_t ticks = 0;
+        std::uint64_t wakeups = 0; // Wake() calls, including from Post
+        std::uint64_t workItems = 0;
+    };
+
+    NetworkExecutor() = default;
+    ~NetworkExecutor() override;
+    NetworkExecutor(const NetworkExecutor&) = delete;
+    NetworkExecutor& operator=(const NetworkExecutor&) = delete;
+
+    // Starts the thread; returns false if it is already running
+    bool Start(TickFunction tick, SocketWait socketWait = nullptr, SocketWake socketWake = nullptr);
+    // Stops and joins the thread. From the executor thread itself the loop
+    // exits after the current round and the thread is detached instead.
+    void Stop();
+    // True until the thread has left its loop
+    bool IsRunning() const;
+    bool IsExecutorThread() const;
+
+    // Runs work on the executor thread before its next tick
+    void Post(Work work) override;
+    // Runs work on the executor thread once the time has come
+    void PostAt(Clock::time_point when, Work work) override;
+    // Runs posted work and due timers on the calling thread, for driving the
+    // executor while its thread is stopped. Returns when the next timer is due.
+    Clock::time_point RunPending(Clock::time_point now);
+    // Makes the executor run a round now
+    void Wake();
+
+    Stats GetStats() const;
+
+private:
+    struct Timer
+    {
+        Clock::time_point when;
+        std::uint64_t sequence = 0; // Keeps same-time timers in post order
+        Work work;
+        bool operator>(const Timer& other) const {
+            return when != other.when ? when > other.when : sequence > other.sequence;
+        }
+    };
+
+    void Run();
+
+    TickFunction m_tick;
+    SocketWait m_socketWait;
+    SocketWake m_socketWake;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<Work> m_work;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+    std::uint64_t m_nextTimerSequence = 0;
+    bool m_wakeRequested = false;
+    bool m_stopRequested = false;
+    bool m_running = false;
+    Stats m_stats;
+    std::thread m_thread;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Per-opcode traffic counters for the outbound queue
+struct OpCodeCounters
+{
+    std::uint64_t enqueued = 0; // Messages handed to the queue
+    std::uint64_t merged = 0;   // Messages replaced by a newer one before flush
+    std::uint64_t sent = 0;     // Messages written to the socket
+    std::uint64_t bytes = 0;    // Payload bytes written to the socket
+};
+
+// Outbound match data queue.
+// The game thread enqueues; the network thread flushes once per tick. Messages
+// on the same channel (opcode) that are still pending are merged so only the
+// latest state goes out. Payload buffers are pooled and reused between ticks.
+class OutboundQueue
+{
+public:
+    using SendFunction = std::function<void(std::int64_t opCode, const std::string& payload)>;
+
+    // Queue a payload. Replaceable messages overwrite a pending replaceable
+    // message with the same opcode. Others, such as a FleetUpdate formation
+    // keyframe, are never overwritten and are always sent in order.
+    void Enqueue(std::int64_t opCode, std::string_view payload, bool replaceable = true);
+
+    // Send everything queued so far, in enqueue order. Called on the network
+    // thread; send runs without the queue lock held. Returns messages sent.
+    size_t Flush(const SendFunction& send);
+
+    // Drop pending messages (e.g. when leaving a match)
+    void Clear();
+
+    size_t PendingCount() const;
+    OpCodeCounters GetCounters(std::int64_t opCode) const;
+    std::map<std::int64_t, OpCodeCounters> GetAllCounters() const;
+
+    // Buffers currently idle in the pool (for tests / diagnostics)
+    size_t PooledBufferCount() const;
+
+private:
+    struct Entry
+    {
+        std::int64_t opCode;
+        bool replaceable;
+        std::string payload;
+    };
+
+    std::string AcquireBuffer();
+    void ReleaseBuffer(std::string&& buffer);
+
+    mutable std::mutex m_mutex;
+    std::vector<Entry> m_pending;
+    std::vector<Entry> m_flushing; // Swapped with m_pending on flush, reused
+    std::vector<std::string> m_pool;
+    std::map<std::int64_t, OpCodeCounters> m_counters;
+
+    static constexpr size_t MAX_POOLED_BUFFERS = 64;
+};
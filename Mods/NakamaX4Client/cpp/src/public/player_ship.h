@@ -23,6 +23,14 @@ public:
     std::vector<float> velocity; // vx, vy, vz
     bool is_remote;
 
+    // Formation data (fleet members only): world position is reconstructed
+    // from the leader's interpolated state plus this leader-local offset
+    std::string formation_leader_id;
+    std::vector<float> formation_offset;
+
+    // True for players relayed from a sibling shard of the same sector
+    bool from_other_shard = false;
+
     // Snapshot interpolation data
     std::vector<float> previous_position;
     std::vector<float> previous_rotation;
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "net_socket.h"
+#include "websocket_codec.h"
+#include <nakama-cpp/realtime/NRtTransportInterface.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// Plain ws:// realtime transport driven by socket readiness.
+// The network thread blocks in WaitForActivity until the socket is readable
+// (or writable with output pending), a timeout passes, or Wake is called, so
+// inbound frames are handled as soon as they arrive instead of on the next
+// fixed sleep. Receive, send and message buffers are allocated once and
+// reused; they only grow for frames larger than the initial size.
+//
+// tick, connect and disconnect run on the network thread; send may be called
+// from any thread. TLS is not supported; use the SDK transport for wss://.
+class PollWebsocketTransport : public Nakama::NRtTransportInterface
+{
+public:
+    static constexpr size_t RECEIVE_BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t SEND_BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+    PollWebsocketTransport();
+    ~PollWebsocketTransport() override;
+
+    // NRtTransportInterface
+    void setActivityTimeout(uint32_t timeoutMs) override { m_activityTimeoutMs = timeoutMs; }
+    uint32_t getActivityTimeout() const override { return m_activityTimeoutMs; }
+    void tick() override;
+    void connect(const std::string& url, Nakama::NRtTransportType type) override;
+    bool isConnecting() override;
+    void disconnect() override;
+    bool send(const Nakama::NBytes& data) override;
+
+    // Blocks until there is socket work for tick(), Wake() is called or the
+    // timeout passes. Returns true unless it timed out.
+    bool WaitForActivity(std::chrono::milliseconds timeout);
+    // Interrupts WaitForActivity from any thread
+    void Wake();
+
+    // Current buffer capacities, to verify they stay preallocated
+    size_t ReceiveCapacity() const { return m_receive.size(); }
+    size_t MessageCapacity() const { return m_message.capacity(); }
+
+private:
+    enum class State { Idle, Connecting, Handshaking, Open };
+
+    void CloseSocket();
+    void Fail(std::uint16_t code, const std::string& reason, bool remote);
+    void ScheduleFailure(std::uint16_t code, const std::string& reason);
+    void ReadAvailable();
+    void ProcessHandshake();
+    void ProcessFrames();
+    bool HandleFrame(const WebsocketCodec::Frame& frame);
+    void QueueFrame(WebsocketCodec::Opcode opcode, std::string_view payload);
+    void FlushSend();
+    void FlushSendLocked();
+    bool HasPendingSend();
+    WebsocketCodec::MaskKey NextMaskLocked();
+
+    std::atomic<State> m_state{ State::Idle };
+    // Bumped whenever the socket is closed, so frame processing can tell a
+    // callback tore the connection down underneath it
+    std::uint64_t m_generation = 0;
+    NetSocket::Handle m_socket = NetSocket::INVALID_HANDLE;
+    NetSocket::Handle m_wakeSocket = NetSocket::INVALID_HANDLE;
+    Nakama::NRtTransportType m_type = Nakama::NRtTransportType::Binary;
+
+    std::string m_host;
+    int m_port = 0;
+    std::string m_target;
+    std::string m_clientKey;
+
+    // Network thread only
+    std::vector<char> m_receive;
+    size_t m_receiveUsed = 0;
+    Nakama::NBytes m_message;           // Reassembled (possibly fragmented) message
+    bool m_inMessage = false;
+    std::chrono::steady_clock::time_point m_connectStarted;
+    std::chrono::steady_clock::time_point m_lastActivity;
+    std::uint32_t m_activityTimeoutMs = 0;
+
+    // Disconnects requested locally are reported on the next tick
+    bool m_disconnectPending = false;
+    Nakama::NRtClientDisconnectInfo m_pendingDisconnect;
+    std::string m_pendingError;
+
+    // Guarded by m_sendMutex (send is callable from any thread)
+    std::mutex m_sendMutex;
+    std::string m_sendBuffer;
+    size_t m_sendOffset = 0;
+    std::atomic<bool> m_sendFailed{ false };
+    std::mt19937 m_rng;
+};
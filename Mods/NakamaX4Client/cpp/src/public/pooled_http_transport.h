@@ -0,0 +1,129 @@
+#pragma once
+
+#include "net_socket.h"
+#include <nakama-cpp/NHttpTransportInterface.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timing of one completed (or failed) HTTP request
+struct HttpRequestTiming
+{
+    std::string path;
+    int statusCode = 0;
+    bool reusedConnection = false; // Sent on a keep-alive connection
+    bool pipelined = false;        // Sent behind another request on the same connection
+    double queueMs = 0.0;          // request() until the bytes were queued on a connection
+    double firstByteMs = 0.0;      // request() until the first response byte
+    double totalMs = 0.0;          // request() until the callback
+};
+
+// Aggregate counters for the pooled HTTP transport
+struct HttpTransportStats
+{
+    std::uint64_t requests = 0;
+    std::uint64_t failures = 0;          // Local failures (status >= 600)
+    std::uint64_t connectionsOpened = 0;
+    std::uint64_t reusedRequests = 0;
+    std::uint64_t pipelinedRequests = 0;
+    std::uint64_t retries = 0;           // Idempotent requests resent after a dropped keep-alive
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+
+    double AverageMs() const { return requests ? totalMs / static_cast<double>(requests) : 0.0; }
+};
+
+// HTTP/1.1 transport for the Nakama REST client with a keep-alive
+// connection pool. Requests are queued from any thread and driven by tick()
+// on the network thread: each goes to an idle pooled connection, a new one
+// while under maxConnections, or — for idempotent methods only — is
+// pipelined behind requests already in flight. An idempotent request lost
+// to a keep-alive connection the server closed is retried once. Plain
+// http:// only; use the SDK transport with SSL.
+class PooledHttpTransport : public Nakama::NHttpTransportInterface
+{
+public:
+    struct Config
+    {
+        size_t maxConnections = 4;
+        size_t maxPipelineDepth = 4;
+        // Below Nakama's default idle timeout so we close first
+        std::chrono::milliseconds idleTimeout{ 30000 };
+        std::chrono::milliseconds connectTimeout{ 10000 };
+        std::chrono::milliseconds requestTimeout{ 30000 };
+    };
+
+    using TimingObserver = std::function<void(const HttpRequestTiming&)>;
+
+    PooledHttpTransport();
+    explicit PooledHttpTransport(const Config& config);
+    ~PooledHttpTransport() override;
+
+    // NHttpTransportInterface
+    void setBaseUri(const std::string& uri) override;
+    void tick() override;
+    void request(const Nakama::NHttpRequest& req, const Nakama::NHttpResponseCallback& callback = nullptr) override;
+    void cancelAllRequests() override;
+
+    // Called on the network thread after every request completes
+    void SetTimingObserver(TimingObserver observer);
+    // Called on the requesting thread after request() queues work, so an
+    // idle network thread can be woken to tick
+    void SetWakeHandler(std::function<void()> handler);
+    // Requests queued or in flight, so tick() has work (network thread)
+    bool HasPendingRequests() const;
+    HttpTransportStats GetStats() const;
+    size_t OpenConnectionCount() const;
+
+private:
+    struct PendingRequest
+    {
+        Nakama::NHttpReqMethod method = Nakama::NHttpReqMethod::POST;
+        std::string path;
+        std::string wire; // Serialized request
+        Nakama::NHttpResponseCallback callback;
+        std::chrono::steady_clock::time_point queuedAt;
+        std::chrono::steady_clock::time_point sentAt;
+        std::chrono::steady_clock::time_point firstByteAt;
+        bool reused = false;
+        bool pipelined = false;
+        bool retried = false;
+    };
+
+    struct Connection;
+
+    std::string Serialize(const Nakama::NHttpRequest& req) const;
+    void DrainIncoming();
+    void Dispatch(std::chrono::steady_clock::time_point now);
+    Connection* OpenConnection(std::chrono::steady_clock::time_point now);
+    void Assign(Connection& connection, PendingRequest&& request, std::chrono::steady_clock::time_point now);
+    void Service(Connection& connection, std::chrono::steady_clock::time_point now);
+    bool ParseResponses(Connection& connection, std::chrono::steady_clock::time_point now);
+    void CloseConnection(Connection& connection, const std::string& reason);
+    void Complete(PendingRequest& request, Nakama::NHttpResponsePtr response);
+    void Fail(PendingRequest& request, int statusCode, const std::string& message);
+
+    Config m_config;
+    std::string m_host;
+    int m_port = 80;
+    std::string m_basePath;
+    bool m_baseUriValid = false;
+
+    // request() may run on any thread; everything else is network thread only
+    mutable std::mutex m_incomingMutex;
+    std::vector<PendingRequest> m_incoming;
+    bool m_cancelRequested = false;
+    std::function<void()> m_wakeHandler; // Guarded by m_incomingMutex
+
+    std::deque<PendingRequest> m_queue;
+    std::vector<std::unique_ptr<Connection>> m_connections;
+
+    mutable std::mutex m_statsMutex;
+    HttpTransportStats m_stats;
+    TimingObserver m_observer;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Jittered exponential backoff for realtime reconnect attempts.
+// The n-th delay is min(maxDelay, initialDelay * multiplier^n); a random
+// fraction (jitter) of it is redrawn each time so clients dropped by the
+// same outage do not reconnect in lockstep.
+class ReconnectBackoff
+{
+public:
+    struct Config
+    {
+        std::chrono::milliseconds initialDelay{ 500 };
+        std::chrono::milliseconds maxDelay{ 30000 };
+        double multiplier = 2.0;
+        double jitter = 0.5; // 0 = fixed delays, 1 = anywhere in [0, delay]
+    };
+
+    ReconnectBackoff();
+    explicit ReconnectBackoff(const Config& config, std::uint32_t seed = std::random_device{}());
+
+    // Delay before the next attempt; counts the attempt
+    std::chrono::milliseconds NextDelay();
+    void Reset() { m_attempts = 0; }
+    int Attempts() const { return m_attempts; }
+
+private:
+    Config m_config;
+    int m_attempts = 0;
+    std::mt19937 m_rng;
+};
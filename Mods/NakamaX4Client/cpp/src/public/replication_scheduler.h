@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// How urgently an entity's state needs to reach observers
+struct ReplicationHints
+{
+    float speed = 0.0f;             // m/s; fast movers go stale sooner
+    float observerDistance = -1.0f; // Distance to the nearest observer, < 0 if unknown
+    float importance = 1.0f;        // Relative weight (player ship = 1)
+    // Carries state later updates do not repeat (a formation keyframe); it is
+    // sent even if newer state is submitted before it goes out
+    bool keyframe = false;
+};
+
+// Starvation and throughput metrics for the replication scheduler
+struct ReplicationStats
+{
+    std::uint64_t sent = 0;        // Entity updates handed to the socket
+    std::uint64_t bytes = 0;       // Payload bytes sent
+    std::uint64_t deferred = 0;    // Per-tick count of entities left waiting
+    size_t waiting = 0;            // Entities with unsent state right now
+    double maxWaitMs = 0.0;        // Longest current wait for a send
+    double peakWaitMs = 0.0;       // Longest wait ever observed
+};
+
+// Priority accumulator scheduler.
+// Every replicated entity with unsent state accrues priority each tick at a
+// rate weighted by speed, proximity to observers and importance. Each network
+// tick fills a per-connection byte budget with the highest-priority entities;
+// sent entities drop back to zero, the rest keep accruing so nothing starves.
+// The budget is a token bucket: unused bytes carry over for a short burst and
+// the top entity may overdraw it, so a payload larger than one tick's budget
+// still goes out.
+class ReplicationScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    // Called under the scheduler lock; must not call back into the scheduler
+    using SendFunction = std::function<void(std::int64_t opCode, std::string_view payload)>;
+
+    static constexpr size_t DEFAULT_BUDGET_BYTES_PER_SECOND = 32 * 1024;
+
+    explicit ReplicationScheduler(size_t budgetBytesPerSecond = DEFAULT_BUDGET_BYTES_PER_SECOND);
+
+    // Store the latest state for an entity channel, replacing any unsent
+    // state. An unsent keyframe is kept, with its hints, and goes out before
+    // the newer state.
+    void Submit(const std::string& entityId, std::int64_t opCode, std::string_view payload,
+        const ReplicationHints& hints, Clock::time_point now = Clock::now());
+    // Drop every channel of an entity, e.g. when it leaves the match
+    void Remove(const std::string& entityId);
+    void Clear();
+
+    // Accrue priority and send what fits in this tick's budget. Returns the
+    // number of entity updates sent.
+    size_t Tick(Clock::time_point now, const SendFunction& send);
+
+    void SetBudgetBytesPerSecond(size_t bytesPerSecond);
+    size_t GetBudgetBytesPerSecond() const;
+
+    ReplicationStats GetStats(Clock::time_point now = Clock::now()) const;
+    // Priority accrued by an entity channel so far (0 if unknown)
+    double GetPriority(const std::string& entityId, std::int64_t opCode) const;
+
+private:
+    using Key = std::pair<std::string, std::int64_t>;
+    struct Entity
+    {
+        std::string payload;
+        ReplicationHints hints;
+        bool payloadPending = false;
+        std::string keyframe;
+        ReplicationHints keyframeHints;
+        bool keyframePending = false;
+        double priority = 0.0;
+        Clock::time_point waitingSince;
+
+        bool Dirty() const { return payloadPending || keyframePending; }
+    };
+
+    static double PriorityRate(const ReplicationHints& hints);
+
+    mutable std::mutex m_mutex;
+    std::map<Key, Entity> m_entities;
+    std::vector<std::pair<const Key, Entity>*> m_order; // Reused each tick
+    size_t m_budgetBytesPerSecond;
+    double m_credit = 0.0;
+    Clock::time_point m_lastTick{};
+    ReplicationStats m_stats;
+};
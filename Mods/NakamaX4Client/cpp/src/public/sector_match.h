@@ -3,9 +3,11 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <atomic>
 #include <chrono>
 #include <msgpack.hpp>
 #include "nakama_realtime_client.h"
+#include "fleet_formation.h"
 #include "player_ship.h"
 #include "x4_script_base.h"
 
@@ -30,8 +32,17 @@ public:
     // @return true if initialization succeeds, false otherwise.
     bool Initialize(const std::string& localPlayerId);
 
-    // LUA_EXPORT
-    void ChangeSector(const std::string& newSector);
+    // Switches sector without waiting for the new match: returns an
+    // operation handle that finishes once it is joined (ChangeSectorAwait
+    // yields the calling coroutine until then)
+    // LUA_EXPORT_AWAIT
+    int ChangeSector(const std::string& newSector);
+    // Change sector with a position hint, used by the server to pick the
+    // nearest shard when the sector is sharded
+    // LUA_EXPORT_AWAIT
+    int ChangeSectorNear(const std::string& newSector, float x, float y, float z);
+    // Called once the match for the current sector is joined
+    void OnShardJoined(int shard);
     void OnSectorJoined(const std::string& sector, const PlayerShip& playerShip);
     void Shutdown();
 
@@ -41,6 +52,24 @@ public:
         const std::vector<float>& rotation,
         const std::vector<float>& velocity);
 
+    // Update a remote fleet: leader absolute state plus formation offsets
+    void UpdateRemoteFleet(const FleetUpdate& update);
+
+    // Bulk insert of a full sector snapshot (late join). Known players are
+    // updated in place, the rest are inserted without per-player logging.
+    void ApplySectorSnapshot(const std::vector<PositionUpdate>& players,
+        const std::vector<FleetUpdate>& fleets);
+
+    bool HasPlayer(const std::string& playerId) const;
+
+    // Drop every remote player (e.g. before rejoining after a reconnect;
+    // the late-join snapshot repopulates them)
+    void ClearRemotePlayers();
+
+    // Players relayed from sibling shards; never replaces players in our shard
+    void ApplyShardGhosts(const std::vector<PositionUpdate>& players,
+        const std::vector<FleetUpdate>& fleets);
+
     // Get all players currently in the sector
     // LUA_EXPORT
     const std::map<std::string, PlayerShip>& GetPlayersInSector() const;
@@ -49,6 +78,13 @@ public:
     // LUA_EXPORT
     const std::string& GetCurrentSector() const { return m_currentSector; }
 
+    // Shard of the current sector this client is in (-1 if not joined)
+    // LUA_EXPORT
+    int GetCurrentShard() const { return m_currentShard; }
+
+    // Position hint for shard selection (empty if none)
+    const std::vector<float>& GetPositionHint() const { return m_positionHint; }
+
     // Remove a player from the sector
     void RemovePlayer(const std::string& playerId);
 
@@ -61,8 +97,26 @@ public:
         const std::vector<float>& rotation,
         const std::vector<float>& velocity);
 
+    // Send local fleet using formation-relative encoding. Member positions are
+    // world positions keyed by ship ID; they are converted to offsets in the
+    // leader's local frame and only resent when the formation changes.
+    // LUA_EXPORT
+    void SendLocalFleet(const std::vector<float>& position,
+        const std::vector<float>& rotation,
+        const std::vector<float>& velocity,
+        const std::map<std::string, std::vector<float>>& memberPositions);
+
     // Configuration
     void SetInterpolationDelay(float delayMs);
+    // Link adaptation (set by the realtime client from its link estimate):
+    // extra interpolation delay on top of the configured one, and the
+    // minimum interval between local position/fleet sends
+    void SetLinkDelayMargin(float marginMs);
+    void SetSendInterval(int intervalMs);
+    // LUA_EXPORT
+    float GetEffectiveInterpolationDelay() const;
+    // LUA_EXPORT
+    int GetSendInterval() const { return m_sendIntervalMs; }
     void SetMaxSnapshotAge(int ageMs);
     void SetCleanupInterval(int intervalMs);
 
@@ -73,14 +127,33 @@ private:
     void Update(float deltaTime) override;
     void CleanupStalePlayers();
     void OnSectorLeft(const std::string& sector);
+    void RemoveFleetMembers(const std::string& playerId);
+    int JoinSector(const std::string& newSector);
+    bool SendDue(std::chrono::steady_clock::time_point& lastSend);
+    ReplicationHints MakeReplicationHints(const std::vector<float>& position,
+        const std::vector<float>& velocity, float importance) const;
 
     std::map<std::string, PlayerShip> m_playerShips; // Keyed by player ID
     std::string m_localPlayerId;
     std::string m_currentSector;
+    int m_currentShard;
+    std::vector<float> m_positionHint;
 
     // Snapshot interpolation settings
     float m_interpolationDelayMs;
+    std::atomic<float> m_linkDelayMarginMs;
+    std::atomic<int> m_sendIntervalMs;
+    std::chrono::steady_clock::time_point m_lastPositionSend;
+    std::chrono::steady_clock::time_point m_lastFleetSend;
     int m_maxSnapshotAgeMs;
     int m_cleanupIntervalMs;
     std::chrono::steady_clock::time_point m_lastCleanupTime;
+
+    // Formation state for the local fleet (ship ID -> quantized offset)
+    std::map<std::string, std::vector<std::int16_t>> m_localFormation;
+    std::uint32_t m_localFormationVersion;
+    int m_fleetUpdatesSinceKeyframe;
+
+    // Last formation version applied per remote player
+    std::map<std::string, std::uint32_t> m_remoteFormationVersions;
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// AIMD controller for the local state send rate.
+// The websocket runs over TCP, so a congested uplink shows up as queueing
+// delay rather than loss: RTT rises above the link's baseline and probes sit
+// unanswered. While either signal is present the rate is cut multiplicatively
+// (at most once per RTT); otherwise it climbs back linearly to the maximum.
+class SendRateController
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        double minRateHz = 2.0;
+        double maxRateHz = 20.0;            // Server snapshot rate
+        double increaseHzPerSecond = 2.0;   // Additive increase
+        double decreaseFactor = 0.5;        // Multiplicative decrease
+        double rttInflationRatio = 2.0;     // Smoothed RTT vs. baseline RTT...
+        double rttInflationMinMs = 80.0;    // ...and at least this much above it
+        double backlogMinMs = 500.0;        // Floor for the "probe overdue" age
+        double lossRate = 0.1;              // Probe loss that counts as congestion
+    };
+
+    // One reading of the link, taken from the ping/pong estimator
+    struct Signals
+    {
+        double smoothedRttMs = 0.0;
+        double rttVarMs = 0.0;
+        double minRttMs = 0.0;
+        double oldestPendingMs = 0.0;
+        double lossRate = 0.0;
+        std::uint64_t samples = 0;
+    };
+
+    SendRateController();
+    explicit SendRateController(const Config& config);
+
+    // Feed the latest link reading; returns true if the rate was cut
+    bool Update(const Signals& signals, Clock::time_point now);
+    void Reset();
+
+    bool IsCongested(const Signals& signals) const;
+    double RateHz() const { return m_rateHz; }
+    int IntervalMs() const;
+    std::uint64_t Decreases() const { return m_decreases; }
+
+private:
+    Config m_config;
+    double m_rateHz;
+    std::uint64_t m_decreases = 0;
+    Clock::time_point m_lastUpdate{};
+    Clock::time_point m_lastDecrease{};
+};
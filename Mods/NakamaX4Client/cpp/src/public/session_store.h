@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+// Session and refresh tokens of the last authentication, kept on disk so a
+// game load can resume the session instead of authenticating again. The
+// file lives in the local app data folder, not with the logs, and on Windows
+// is encrypted with DPAPI for the current user.
+struct StoredSession
+{
+    std::string server;   // host:port the tokens were issued by
+    std::string deviceId; // Device the session authenticated
+    std::string authToken;
+    std::string refreshToken;
+};
+
+class SessionStore
+{
+public:
+    // Below this much remaining lifetime a session is always refreshed
+    static constexpr std::uint64_t MIN_REFRESH_MARGIN_MS = 10 * 60 * 1000;
+
+    explicit SessionStore(std::string path = "") : m_path(std::move(path)) {}
+
+    void SetPath(const std::string& path) { m_path = path; }
+    std::optional<StoredSession> Load() const;
+    // Replaces the file in one rename, so a crash leaves the old or new copy
+    bool Save(const StoredSession& session) const;
+    void Clear() const;
+
+    // When to refresh a session valid from createMs to expireMs (Unix ms):
+    // once a tenth of its lifetime, and at least MIN_REFRESH_MARGIN_MS, is left
+    static std::uint64_t RefreshAtMs(std::uint64_t createMs, std::uint64_t expireMs);
+
+private:
+    std::string m_path;
+};
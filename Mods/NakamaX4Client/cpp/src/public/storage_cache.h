@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Client-side copy of the player's storage objects. Writes go to the cache
+// and only records with changed fields are sent, coalesced into one
+// writeStorageObjects batch once the oldest change is flushDelay old or
+// flushThreshold records are dirty. Each write carries the object version of
+// the last acknowledged write, so an object changed elsewhere is rejected
+// instead of overwritten; while the version is unknown (e.g. after a restart)
+// the write is unconditional. Any thread may call any method.
+class StorageCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using FieldValue = std::variant<long long, double, bool, std::string>;
+    // Called outside the lock once the data dirty at registration is written
+    using FlushCallback = std::function<void(bool success, const std::string& error)>;
+
+    struct Options
+    {
+        std::chrono::milliseconds flushDelay{ 2000 };
+        size_t flushThreshold = 8;
+        // Records per writeStorageObjects call; the rest follow right after
+        size_t maxBatchSize = 64;
+        // Before retrying a batch that failed for any reason but a conflict
+        std::chrono::milliseconds retryDelay{ 5000 };
+        // Consecutive conflicts retried at once; the next counts as a failure
+        int maxConflictRetries = 3;
+    };
+
+    struct Write
+    {
+        std::string collection;
+        std::string key;
+        std::string value; // JSON object of all the record's fields
+        std::string version;
+    };
+
+    struct Ack
+    {
+        std::string collection;
+        std::string key;
+        std::string version;
+    };
+
+    StorageCache() = default;
+    explicit StorageCache(Options options) : m_options(options) {}
+
+    // Returns false, and leaves the record clean, if the field already has
+    // this value
+    bool Set(const std::string& collection, const std::string& key, const std::string& field, FieldValue value,
+        Clock::time_point now);
+    std::optional<FieldValue> Get(const std::string& collection, const std::string& key,
+        const std::string& field) const;
+    // Loads a record's fields from its JSON value (e.g. a journaled write),
+    // marking them dirty. Returns false if the value is not a JSON object.
+    bool Restore(const std::string& collection, const std::string& key, const std::string& value,
+        Clock::time_point now);
+    // The JSON value a write of the record would carry ("" if unknown)
+    std::string Value(const std::string& collection, const std::string& key) const;
+    // Version of the server copy, e.g. after reading it back on a conflict
+    void SetVersion(const std::string& collection, const std::string& key, const std::string& version);
+    std::string GetVersion(const std::string& collection, const std::string& key) const;
+
+    // Flush at the next opportunity instead of waiting for flushDelay
+    void RequestFlush();
+    bool ShouldFlush(Clock::time_point now) const;
+    // max while nothing is dirty or a batch is in flight
+    Clock::time_point NextFlushDeadline() const;
+
+    // Snapshot of up to maxBatchSize dirty records; empty if there are none
+    // or the previous batch is still in flight. Changes made meanwhile go in
+    // the next batch.
+    std::vector<Write> TakeBatch();
+    void CompleteBatch(const std::vector<Ack>& acks);
+    // The batch's records become dirty again. After a version conflict the
+    // retry is immediate and waiters carry over to it, up to
+    // maxConflictRetries times in a row; otherwise waiters fail and the retry
+    // waits retryDelay.
+    void FailBatch(bool versionConflict, const std::string& error, Clock::time_point now);
+
+    // Calls back right away if nothing is dirty or in flight
+    void WhenFlushed(FlushCallback callback);
+
+    size_t DirtyCount() const;
+    std::vector<std::string> DirtyFields(const std::string& collection, const std::string& key) const;
+    bool IsFlushing() const;
+    // Drops everything, failing waiters (e.g. on logout)
+    void Clear();
+
+private:
+    using RecordId = std::pair<std::string, std::string>;
+
+    struct Record
+    {
+        std::map<std::string, FieldValue> fields;
+        std::vector<std::string> dirtyFields;
+        std::string version;
+    };
+
+    struct Waiter
+    {
+        std::uint64_t batch; // Serial of the batch that carries its data
+        FlushCallback callback;
+    };
+
+    static std::string Serialize(const Record& record);
+    bool SetLocked(Record& record, const std::string& field, FieldValue value, Clock::time_point now);
+    std::vector<FlushCallback> TakeWaitersLocked(std::uint64_t upToBatch);
+
+    Options m_options;
+    mutable std::mutex m_mutex;
+    std::map<RecordId, Record> m_records;
+    std::map<RecordId, std::vector<std::string>> m_inFlightFields;
+    size_t m_dirtyRecords = 0;
+    Clock::time_point m_firstDirtyAt = Clock::time_point::max();
+    Clock::time_point m_retryAt = Clock::time_point::min();
+    bool m_flushRequested = false;
+    std::uint64_t m_batchesTaken = 0;
+    bool m_batchInFlight = false;
+    int m_conflictRetries = 0; // Since the last acknowledged batch
+    std::vector<Waiter> m_waiters;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Append-only on-disk log of storage writes not yet acknowledged by the
+// server, so they survive an unreachable server and a restart. Records are
+// framed as [length][CRC-32][payload]; a torn or corrupt tail is cut off
+// when the journal is opened. Appends are buffered in memory and written
+// and fsynced at most once per syncInterval, so journaling a write costs a
+// memcpy. Once every write in the file is acknowledged the file is truncated;
+// before that it is rewritten with only the live writes when dead records
+// dominate. Any thread may call any method.
+class StorageJournal
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::chrono::milliseconds syncInterval{ 1000 };
+        // File size from which a mostly acknowledged journal is rewritten
+        size_t compactBytes = 64 * 1024;
+    };
+
+    // A journaled write; only the latest per object is kept live
+    struct Entry
+    {
+        std::uint64_t sequence = 0;
+        std::string collection;
+        std::string key;
+        std::string value;
+    };
+
+    StorageJournal() = default;
+    explicit StorageJournal(Options options) : m_options(options) {}
+    ~StorageJournal();
+
+    StorageJournal(const StorageJournal&) = delete;
+    StorageJournal& operator=(const StorageJournal&) = delete;
+
+    // Opens or creates the journal and loads the writes it still holds
+    bool Open(const std::string& path);
+    // Writes out what is buffered, then closes the file
+    void Close();
+    bool IsOpen() const;
+
+    // Returns the write's sequence number
+    std::uint64_t Append(const std::string& collection, const std::string& key, const std::string& value,
+        Clock::time_point now);
+    // Sequence number of the latest append (0 if none)
+    std::uint64_t LastSequence() const;
+    // The server has the object's writes up to upToSequence
+    void Acknowledge(const std::string& collection, const std::string& key, std::uint64_t upToSequence);
+    // Unacknowledged writes, oldest first
+    std::vector<Entry> Pending() const;
+
+    // Writes and fsyncs the buffer once syncInterval has passed since the
+    // oldest buffered record (always if force). Returns false on I/O errors.
+    bool Sync(Clock::time_point now, bool force = false);
+    // max while nothing is buffered
+    Clock::time_point NextSyncDeadline() const;
+    std::uint64_t FileBytes() const;
+
+    static std::uint32_t Crc32(const std::string& data);
+
+private:
+    using RecordId = std::pair<std::string, std::string>;
+
+    enum RecordType : std::uint8_t { WriteRecord = 'W', AckRecord = 'A' };
+
+    void Load(const std::string& contents);
+    std::vector<Entry> PendingLocked() const;
+    bool WriteBufferLocked();
+    void CompactLocked();
+    bool ReopenLocked(const char* mode);
+
+    Options m_options;
+    mutable std::mutex m_mutex;
+    std::string m_path;
+    std::FILE* m_file = nullptr;
+    std::string m_buffer;
+    Clock::time_point m_bufferedSince = Clock::time_point::max();
+    std::uint64_t m_fileBytes = 0;
+    std::uint64_t m_lastSequence = 0;
+    std::map<RecordId, Entry> m_live;
+};
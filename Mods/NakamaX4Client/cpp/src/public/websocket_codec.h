@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// RFC 6455 framing and handshake helpers for the realtime transport.
+// Frames are encoded into and parsed from caller-owned buffers so the
+// transport can keep reusing the same storage.
+namespace WebsocketCodec
+{
+    enum class Opcode : std::uint8_t
+    {
+        Continuation = 0x0,
+        Text = 0x1,
+        Binary = 0x2,
+        Close = 0x8,
+        Ping = 0x9,
+        Pong = 0xA
+    };
+
+    struct Frame
+    {
+        Opcode opcode = Opcode::Continuation;
+        bool fin = false;
+        std::string_view payload; // Points into the parsed buffer, unmasked
+        size_t frameSize = 0;     // Header plus payload bytes consumed
+    };
+
+    enum class ParseResult { Complete, NeedMore, Error };
+
+    using MaskKey = std::array<std::uint8_t, 4>;
+
+    // Appends one frame. Clients must mask (RFC 6455 5.3); pass no key for
+    // server-side frames.
+    void AppendFrame(std::string& out, Opcode opcode, std::string_view payload, bool fin,
+        const MaskKey* mask);
+
+    // Parses one frame at the start of data, unmasking its payload in place.
+    // Payloads above maxPayload, reserved bits and fragmented control frames
+    // are errors.
+    ParseResult ParseFrame(char* data, size_t size, size_t maxPayload, Frame& frame);
+
+    // HTTP upgrade request for host[:port]/target with the given client key
+    std::string BuildHandshakeRequest(std::string_view host, int port, std::string_view target,
+        std::string_view key);
+    // Base64 of 16 random bytes, as Sec-WebSocket-Key expects
+    std::string MakeClientKey(const std::array<std::uint8_t, 16>& nonce);
+    // Sec-WebSocket-Accept value for a client key
+    std::string AcceptKey(std::string_view key);
+    // Checks a complete response header block (up to and including the blank
+    // line) for a 101 status and the matching accept key
+    bool ValidateHandshakeResponse(std::string_view response, std::string_view key);
+
+    std::string Base64Encode(const std::uint8_t* data, size_t size);
+    std::array<std::uint8_t, 20> Sha1(std::string_view data);
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/public/async_operation.h"
+
+using namespace std::chrono_literals;
+using Clock = AsyncOperationTable::Clock;
+using State = AsyncOperationState;
+
+TEST_CASE("AsyncOperationTable reports progress and completion by handle") {
+    AsyncOperationTable table;
+    const int handle = table.Begin("authenticate", Clock::now() + 10s);
+    REQUIRE(handle > 0);
+    REQUIRE(table.Get(handle).state == State::Running);
+    REQUIRE(table.RunningCount() == 1);
+
+    table.SetProgress(handle, 0.5f);
+    REQUIRE(table.Get(handle).progress == 0.5f);
+
+    bool committed = false;
+    REQUIRE(table.Complete(handle, true, "", [&committed]() { committed = true; }));
+    REQUIRE(committed);
+    REQUIRE(table.Get(handle).state == State::Succeeded);
+    REQUIRE(table.Get(handle).progress == 1.0f);
+    REQUIRE(table.RunningCount() == 0);
+
+    // Only the first result counts
+    REQUIRE_FALSE(table.Complete(handle, false, "late"));
+    REQUIRE(table.Get(handle).state == State::Succeeded);
+
+    table.Release(handle);
+    REQUIRE(table.Get(handle).state == State::Unknown);
+    REQUIRE(std::string(AsyncOperationTable::StateName(table.Get(handle).state)) == "unknown");
+}
+
+TEST_CASE("AsyncOperationTable discards results of cancelled operations") {
+    AsyncOperationTable table;
+    int cancelled = 0;
+    const int handle = table.Begin("sync", Clock::now() + 10s, [&cancelled]() { ++cancelled; });
+
+    REQUIRE(table.Cancel(handle));
+    REQUIRE_FALSE(table.Cancel(handle));
+    REQUIRE(cancelled == 1);
+    REQUIRE(table.Get(handle).state == State::Cancelled);
+
+    bool committed = false;
+    REQUIRE_FALSE(table.Complete(handle, true, "", [&committed]() { committed = true; }));
+    REQUIRE_FALSE(committed);
+
+    // Running operations are not released early
+    const int running = table.Begin("sync", Clock::now() + 10s);
+    table.Release(running);
+    REQUIRE(table.Get(running).state == State::Running);
+    table.CancelAll();
+    REQUIRE(table.Get(running).state == State::Cancelled);
+}
+
+TEST_CASE("AsyncOperationTable times out overdue operations") {
+    AsyncOperationTable table;
+    const auto now = Clock::now();
+    int cleanedUp = 0;
+    const int overdue = table.Begin("sync", now + 1s, [&cleanedUp]() { ++cleanedUp; });
+    const int pending = table.Begin("authenticate", now + 5s);
+
+    REQUIRE(table.ExpireOverdue(now) == now + 1s);
+    REQUIRE(table.ExpireOverdue(now + 2s) == now + 5s);
+    REQUIRE(table.Get(overdue).state == State::Failed);
+    REQUIRE(table.Get(overdue).error == "sync timeout");
+    REQUIRE(cleanedUp == 1);
+    REQUIRE(table.Get(pending).state == State::Running);
+
+    REQUIRE(table.ExpireOverdue(now + 6s) == Clock::time_point::max());
+    REQUIRE(table.Get(pending).error == "authenticate timeout");
+}
+
+TEST_CASE("AsyncOperationTable notifies and bounds finished operations") {
+    AsyncOperationTable table;
+    std::vector<std::pair<int, State>> finished;
+    table.SetCompletionObserver([&finished](int handle, const AsyncOperationStatus& status) {
+        finished.emplace_back(handle, status.state);
+    });
+
+    const int first = table.Begin("sync", Clock::now() + 10s);
+    table.Complete(first, false, "rejected");
+    REQUIRE(finished.size() == 1);
+    REQUIRE(finished[0] == std::make_pair(first, State::Failed));
+    REQUIRE(table.Get(first).error == "rejected");
+
+    for (size_t i = 0; i < AsyncOperationTable::MAX_FINISHED; ++i) {
+        table.Complete(table.Begin("sync", Clock::now() + 10s), true);
+    }
+    REQUIRE(finished.size() == AsyncOperationTable::MAX_FINISHED + 1);
+    // The oldest unreleased result makes room for the newest
+    REQUIRE(table.Get(first).state == State::Unknown);
+}
+
+TEST_CASE("AsyncOperationTable completes from another thread") {
+    AsyncOperationTable table;
+    const int handle = table.Begin("authenticate", Clock::now() + 10s);
+
+    std::thread network([&table, handle]() {
+        table.SetProgress(handle, 0.5f);
+        table.Complete(handle, true);
+    });
+    network.join();
+
+    REQUIRE(table.Get(handle).IsFinished());
+    REQUIRE(table.Get(handle).state == State::Succeeded);
+}
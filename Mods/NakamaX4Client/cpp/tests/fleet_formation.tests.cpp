@@ -0,0 +1,47 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <vector>
+
+#include "../src/public/fleet_formation.h"
+
+using Catch::Matchers::WithinAbs;
+
+TEST_CASE("FleetFormation local/world round trip") {
+    const std::vector<float> rotation = { 0.3f, 1.2f, -0.7f };
+    const std::vector<float> world = { 120.0f, -35.5f, 880.25f };
+
+    const auto local = FleetFormation::WorldToLocal(world, rotation);
+    const auto back = FleetFormation::LocalToWorld(local, rotation);
+
+    for (size_t i = 0; i < 3; ++i) {
+        REQUIRE_THAT(back[i], WithinAbs(world[i], 1e-3));
+    }
+}
+
+TEST_CASE("FleetFormation offsets follow leader yaw") {
+    // A wingman 100 m to the leader's right ends up behind/ahead after a 90 degree turn
+    const std::vector<float> localOffset = { 100.0f, 0.0f, 0.0f };
+    const auto world = FleetFormation::LocalToWorld(localOffset, { 0.0f, 1.5707963f, 0.0f });
+
+    REQUIRE_THAT(world[0], WithinAbs(0.0, 1e-3));
+    REQUIRE_THAT(world[1], WithinAbs(0.0, 1e-3));
+    REQUIRE_THAT(world[2], WithinAbs(-100.0, 1e-3));
+}
+
+TEST_CASE("FleetFormation quantization") {
+    SECTION("Round trip within one quantum") {
+        const std::vector<float> offset = { 12.3f, -250.8f, 1000.1f };
+        const auto restored = FleetFormation::DequantizeOffset(FleetFormation::QuantizeOffset(offset));
+        for (size_t i = 0; i < 3; ++i) {
+            REQUIRE_THAT(restored[i], WithinAbs(offset[i], FleetFormation::OFFSET_QUANTUM_M / 2));
+        }
+    }
+
+    SECTION("Clamps out of range offsets") {
+        const auto quantized = FleetFormation::QuantizeOffset({ 1.0e7f, -1.0e7f, 0.0f });
+        REQUIRE(quantized[0] == INT16_MAX);
+        REQUIRE(quantized[1] == INT16_MIN);
+        REQUIRE(quantized[2] == 0);
+    }
+}
@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <chrono>
+
+#include "../src/public/link_quality.h"
+
+using Catch::Matchers::WithinAbs;
+using std::chrono::milliseconds;
+
+TEST_CASE("LinkQualityEstimator tracks RTT and jitter") {
+    LinkQualityEstimator link;
+    auto now = LinkQualityEstimator::Clock::time_point{} + milliseconds(10000);
+
+    const auto first = link.OnPingSent(now);
+    REQUIRE(link.OnPong(first, now + milliseconds(100)));
+    REQUIRE_THAT(link.SmoothedRttMs(), WithinAbs(100.0, 1e-6));
+    REQUIRE_THAT(link.JitterMs(), WithinAbs(50.0, 1e-6));
+
+    // Steady 100 ms samples shrink the jitter estimate
+    for (int i = 0; i < 20; ++i) {
+        now += milliseconds(1000);
+        const auto sequence = link.OnPingSent(now);
+        REQUIRE(link.OnPong(sequence, now + milliseconds(100)));
+    }
+    REQUIRE_THAT(link.SmoothedRttMs(), WithinAbs(100.0, 1e-6));
+    REQUIRE(link.JitterMs() < 1.0);
+    REQUIRE(link.LossRate() == 0.0);
+    REQUIRE_THAT(link.MinRttMs(), WithinAbs(100.0, 1e-6));
+
+    // Duplicate pongs are ignored
+    const auto sequence = link.OnPingSent(now);
+    REQUIRE(link.OnPong(sequence, now + milliseconds(100)));
+    REQUIRE_FALSE(link.OnPong(sequence, now + milliseconds(120)));
+}
+
+TEST_CASE("LinkQualityEstimator counts unanswered probes as lost") {
+    LinkQualityEstimator link(milliseconds(500));
+    auto now = LinkQualityEstimator::Clock::time_point{} + milliseconds(10000);
+
+    for (int i = 0; i < 10; ++i) {
+        const auto sequence = link.OnPingSent(now);
+        if (i % 2 == 0) {
+            REQUIRE(link.OnPong(sequence, now + milliseconds(50)));
+        }
+        now += milliseconds(1000);
+    }
+    link.Expire(now);
+    REQUIRE_THAT(link.LossRate(), WithinAbs(0.5, 1e-6));
+    REQUIRE(link.OldestPendingMs(now) == 0.0);
+
+    // A pong after the loss timeout does not resurrect the probe
+    const auto late = link.OnPingSent(now);
+    REQUIRE_THAT(link.OldestPendingMs(now + milliseconds(300)), WithinAbs(300.0, 1e-6));
+    REQUIRE_FALSE(link.OnPong(late, now + milliseconds(600)));
+
+    link.Reset();
+    REQUIRE(link.LossRate() == 0.0);
+    REQUIRE(link.Samples() == 0);
+}
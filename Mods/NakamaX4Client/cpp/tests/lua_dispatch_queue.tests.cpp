@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "lua_dispatch_queue.h"
+
+namespace {
+// Fresh Lua state with the standard libraries, closed on scope exit
+struct LuaState
+{
+    lua_State* L = luaL_newstate();
+
+    LuaState() { luaL_openlibs(L); }
+    ~LuaState() { lua_close(L); }
+
+    void Run(const char* chunk) { REQUIRE(luaL_dostring(L, chunk) == 0); }
+
+    int RefGlobal(const char* name) {
+        lua_getglobal(L, name);
+        return luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    std::string Global(const char* name) {
+        lua_getglobal(L, name);
+        std::string value = lua_isstring(L, -1) ? lua_tostring(L, -1) : "";
+        lua_pop(L, 1);
+        return value;
+    }
+};
+}
+
+TEST_CASE("LuaDispatchQueue runs the rest of a batch after a failing callback") {
+    LuaState lua;
+    lua.Run("log = ''\n"
+            "function record(value, flag) log = log .. tostring(value) .. tostring(flag) .. ';' end\n"
+            "function fail() error('boom') end\n");
+    const int record = lua.RefGlobal("record");
+    const int fail = lua.RefGlobal("fail");
+
+    LuaDispatchQueue queue;
+    queue.Post(record, { std::string("first"), true });
+    queue.Post(fail);
+    queue.Post(record, { 2.0 });
+    // Nothing runs until a state is attached
+    REQUIRE(queue.Drain() == 0);
+
+    queue.Attach(lua.L);
+    const int top = lua_gettop(lua.L);
+    REQUIRE(queue.Drain() == 3);
+    REQUIRE(lua_gettop(lua.L) == top);
+    REQUIRE(lua.Global("log") == "firsttrue;2nil;");
+
+    const LuaDispatchQueue::Stats stats = queue.GetStats();
+    REQUIRE(stats.posted == 3);
+    REQUIRE(stats.dispatched == 3);
+    REQUIRE(stats.batches == 1);
+    REQUIRE(stats.errors == 1);
+
+    // Plain callbacks keep their reference for the next post
+    queue.Post(record, { std::string("again") });
+    REQUIRE(queue.Drain() == 1);
+    REQUIRE(lua.Global("log") == "firsttrue;2nil;againnil;");
+}
+
+TEST_CASE("LuaDispatchQueue resumes coroutines and releases their references") {
+    LuaState lua;
+    lua.Run("result = ''\n"
+            "waiter = coroutine.create(function()\n"
+            "  local ok, err = coroutine.yield()\n"
+            "  result = tostring(ok) .. ':' .. tostring(err)\n"
+            "end)\n"
+            "coroutine.resume(waiter)\n"
+            "crasher = coroutine.create(function() coroutine.yield(); error('late') end)\n"
+            "coroutine.resume(crasher)\n");
+    const int waiter = lua.RefGlobal("waiter");
+    const int crasher = lua.RefGlobal("crasher");
+
+    LuaDispatchQueue queue;
+    queue.Attach(lua.L);
+    queue.PostResume(crasher);
+    queue.PostResume(waiter, { false, std::string("offline") });
+    REQUIRE(queue.Drain() == 2);
+    REQUIRE(lua.Global("result") == "false:offline");
+    REQUIRE(queue.GetStats().errors == 1);
+
+    // Both registry slots were freed, so new references reuse them
+    lua_pushboolean(lua.L, 1);
+    const int reused = luaL_ref(lua.L, LUA_REGISTRYINDEX);
+    lua_pushboolean(lua.L, 1);
+    const int reusedToo = luaL_ref(lua.L, LUA_REGISTRYINDEX);
+    REQUIRE(((reused == waiter && reusedToo == crasher) || (reused == crasher && reusedToo == waiter)));
+}
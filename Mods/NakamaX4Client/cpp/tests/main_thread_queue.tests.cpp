@@ -0,0 +1,224 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/public/main_thread_queue.h"
+#include "../src/public/net_socket.h"
+#include "../src/public/network_executor.h"
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+TEST_CASE("MainThreadQueue runs posted work on the draining thread in order") {
+    MainThreadQueue queue;
+    std::vector<int> order;
+    std::thread::id ranOn;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < 3; ++i) {
+            queue.Post([&order, &ranOn, i]() {
+                order.push_back(i);
+                ranOn = std::this_thread::get_id();
+            });
+        }
+    });
+    producer.join();
+    REQUIRE(queue.PendingCount() == 3);
+    REQUIRE(order.empty());
+
+    REQUIRE(queue.Drain() == 3);
+    REQUIRE(order == std::vector<int>{ 0, 1, 2 });
+    REQUIRE(ranOn == std::this_thread::get_id());
+
+    const MainThreadQueueStats stats = queue.GetStats();
+    REQUIRE(stats.posted == 3);
+    REQUIRE(stats.run == 3);
+    REQUIRE(stats.AverageLatencyMs() >= 0.0);
+}
+
+TEST_CASE("MainThreadQueue defers work posted while draining") {
+    MainThreadQueue queue;
+    int runs = 0;
+    queue.Post([&]() {
+        ++runs;
+        queue.Post([&runs]() { ++runs; });
+    });
+    queue.Post([]() { throw std::runtime_error("bad event"); });
+
+    REQUIRE(queue.Drain() == 2);
+    REQUIRE(runs == 1);
+    REQUIRE(queue.GetStats().failures == 1);
+    REQUIRE(queue.Drain() == 1);
+    REQUIRE(runs == 2);
+
+    queue.Post([&runs]() { ++runs; });
+    queue.Clear();
+    REQUIRE(queue.Drain() == 0);
+}
+
+namespace {
+// Loopback stand-in for the realtime socket: a sender thread writes
+// timestamped 64-byte messages at a fixed rate, the receiving end is
+// non-blocking like the client's websocket.
+class TimestampStream
+{
+public:
+    static constexpr size_t MESSAGE_SIZE = 64;
+
+    explicit TimestampStream(std::chrono::microseconds interval) {
+        NetSocket::Startup();
+        int port = 0;
+        m_listener = NetSocket::ListenLoopback(port);
+        std::string error;
+        m_receiver = NetSocket::ConnectNonBlocking("127.0.0.1", port, error);
+        m_sender = NetSocket::Accept(m_listener);
+        m_thread = std::thread([this, interval]() {
+            char message[MESSAGE_SIZE] = {};
+            auto next = Clock::now();
+            while (!m_stop) {
+                const auto sentAt = Clock::now().time_since_epoch().count();
+                std::memcpy(message, &sentAt, sizeof(sentAt));
+                bool wouldBlock = false;
+                NetSocket::Send(m_sender, message, sizeof(message), wouldBlock);
+                next += interval;
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+
+    ~TimestampStream() {
+        m_stop = true;
+        m_thread.join();
+        NetSocket::Close(m_sender);
+        NetSocket::Close(m_receiver);
+        NetSocket::Close(m_listener);
+    }
+
+    NetSocket::Handle Receiver() const { return m_receiver; }
+
+    // Reads every whole message available without blocking
+    template <typename Handler>
+    void ReadAvailable(Handler&& handler) {
+        char chunk[4096];
+        for (;;) {
+            bool wouldBlock = false;
+            const int received = NetSocket::Recv(m_receiver, chunk, sizeof(chunk), wouldBlock);
+            if (received <= 0) {
+                break;
+            }
+            m_buffer.append(chunk, static_cast<size_t>(received));
+        }
+        size_t offset = 0;
+        for (; offset + MESSAGE_SIZE <= m_buffer.size(); offset += MESSAGE_SIZE) {
+            Clock::rep sentAt = 0;
+            std::memcpy(&sentAt, m_buffer.data() + offset, sizeof(sentAt));
+            handler(Clock::time_point(Clock::duration(sentAt)));
+        }
+        m_buffer.erase(0, offset);
+    }
+
+private:
+    NetSocket::Handle m_listener = NetSocket::INVALID_HANDLE;
+    NetSocket::Handle m_sender = NetSocket::INVALID_HANDLE;
+    NetSocket::Handle m_receiver = NetSocket::INVALID_HANDLE;
+    std::string m_buffer;
+    std::atomic<bool> m_stop{ false };
+    std::thread m_thread;
+};
+
+struct ModelResult
+{
+    double meanFrameCostUs = 0.0;
+    double maxFrameCostUs = 0.0;
+    double meanLatencyMs = 0.0;
+    size_t applied = 0;
+};
+
+// Stand-in for applying an update to game state
+void ApplyUpdate(Clock::time_point sentAt, ModelResult& result, double& latencySumMs) {
+    latencySumMs += std::chrono::duration<double, std::milli>(Clock::now() - sentAt).count();
+    ++result.applied;
+}
+
+// Runs 60 frames of 16 ms; pump() is the game thread's per-frame work
+template <typename Pump>
+ModelResult RunFrames(Pump&& pump, double& latencySumMs, ModelResult& result) {
+    constexpr int FRAMES = 60;
+    double costSumUs = 0.0;
+    auto frame = Clock::now();
+    for (int i = 0; i < FRAMES; ++i) {
+        frame += milliseconds(16);
+        std::this_thread::sleep_until(frame);
+        const auto start = Clock::now();
+        pump();
+        const double costUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        costSumUs += costUs;
+        result.maxFrameCostUs = std::max(result.maxFrameCostUs, costUs);
+    }
+    result.meanFrameCostUs = costSumUs / FRAMES;
+    result.meanLatencyMs = result.applied ? latencySumMs / static_cast<double>(result.applied) : 0.0;
+    return result;
+}
+}
+
+// Hidden by default; run with the [benchmark] tag. Compares the game-thread
+// cost per frame and the send-to-apply latency of the two execution models
+// for a 500 Hz inbound stream.
+TEST_CASE("Execution model frame cost and latency", "[.][benchmark]") {
+    const auto interval = std::chrono::microseconds(2000);
+
+    SECTION("frame-driven: the frame reads and applies") {
+        TimestampStream stream(interval);
+        ModelResult result;
+        double latencySumMs = 0.0;
+        RunFrames([&]() {
+            stream.ReadAvailable([&](Clock::time_point sentAt) { ApplyUpdate(sentAt, result, latencySumMs); });
+        }, latencySumMs, result);
+        WARN("frame-driven: frame cost mean " << result.meanFrameCostUs << " us, max " << result.maxFrameCostUs
+            << " us; latency mean " << result.meanLatencyMs << " ms over " << result.applied << " updates");
+        REQUIRE(result.applied > 0);
+    }
+
+    SECTION("threaded: the network thread reads, the frame applies") {
+        TimestampStream stream(interval);
+        MainThreadQueue queue;
+        ModelResult result;
+        double latencySumMs = 0.0;
+
+        NetworkExecutor executor;
+        const NetSocket::Handle wake = NetSocket::CreateWakeSocket();
+        executor.Start(
+            [&](Clock::time_point) {
+                stream.ReadAvailable([&](Clock::time_point sentAt) {
+                    queue.Post([&, sentAt]() { ApplyUpdate(sentAt, result, latencySumMs); });
+                });
+                return Clock::time_point::max();
+            },
+            [&](milliseconds timeout) {
+                NetSocket::PollEntry entries[2];
+                entries[0].socket = wake;
+                entries[0].wantRead = true;
+                entries[1].socket = stream.Receiver();
+                entries[1].wantRead = true;
+                NetSocket::Poll(entries, 2, static_cast<int>(timeout.count()));
+                if (entries[0].readable) {
+                    NetSocket::DrainWake(wake);
+                }
+                return true;
+            },
+            [wake]() { NetSocket::SignalWake(wake); });
+
+        RunFrames([&]() { queue.Drain(); }, latencySumMs, result);
+        executor.Stop();
+        NetSocket::Close(wake);
+        WARN("threaded: frame cost mean " << result.meanFrameCostUs << " us, max " << result.maxFrameCostUs
+            << " us; latency mean " << result.meanLatencyMs << " ms over " << result.applied << " updates");
+        REQUIRE(result.applied > 0);
+    }
+}
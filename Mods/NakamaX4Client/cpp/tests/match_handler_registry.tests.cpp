@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "../src/public/match_handler_registry.h"
+
+using Result = MatchHandlerRegistry::DispatchResult;
+
+TEST_CASE("MatchHandlerRegistry dispatches by opcode") {
+    MatchHandlerRegistry registry;
+    std::string received;
+    REQUIRE(registry.RegisterRaw(3, "echo", [&received](const char* data, size_t size) {
+        received.assign(data, size);
+        return true;
+    }));
+
+    REQUIRE(registry.Dispatch(3, "hello", 5) == Result::Handled);
+    REQUIRE(received == "hello");
+
+    const MatchOpCodeStats stats = registry.GetStats(3);
+    REQUIRE(stats.name == "echo");
+    REQUIRE(stats.messages == 1);
+    REQUIRE(stats.bytes == 5);
+    REQUIRE(stats.failures == 0);
+
+    std::uint64_t timed = 0;
+    for (auto count : stats.decodeHistogram) {
+        timed += count;
+    }
+    REQUIRE(timed == 1);
+}
+
+TEST_CASE("MatchHandlerRegistry typed handlers use their codec") {
+    MatchHandlerRegistry registry;
+    int handled = 0;
+    registry.Register<int>(7, "length",
+        [](const char*, size_t size, int& out) {
+            out = static_cast<int>(size);
+            return size > 0;
+        },
+        [&handled](const int& value) { handled = value; });
+
+    REQUIRE(registry.Dispatch(7, "abcd", 4) == Result::Handled);
+    REQUIRE(handled == 4);
+
+    REQUIRE(registry.Dispatch(7, "", 0) == Result::Malformed);
+    REQUIRE(registry.GetStats(7).failures == 1);
+}
+
+TEST_CASE("MatchHandlerRegistry counts unknown and failing opcodes") {
+    MatchHandlerRegistry registry;
+
+    REQUIRE(registry.Dispatch(9, "x", 1) == Result::Unknown);
+    REQUIRE(registry.Dispatch(-1, "x", 1) == Result::Unknown);
+    REQUIRE(registry.Dispatch(MatchHandlerRegistry::MAX_OPCODES, "x", 1) == Result::Unknown);
+    REQUIRE(registry.GetUnknownCount() == 3);
+    REQUIRE_FALSE(registry.RegisterRaw(MatchHandlerRegistry::MAX_OPCODES, "too-big",
+        [](const char*, size_t) { return true; }));
+
+    registry.RegisterRaw(1, "throws", [](const char*, size_t) -> bool {
+        throw std::runtime_error("bad payload");
+    });
+    REQUIRE_THROWS(registry.Dispatch(1, "x", 1));
+    REQUIRE(registry.GetStats(1).failures == 1);
+
+    registry.Unregister(1);
+    REQUIRE(registry.Dispatch(1, "x", 1) == Result::Unknown);
+}
+
+TEST_CASE("MatchOpCodeStats percentile uses bucket upper bounds") {
+    MatchOpCodeStats stats;
+    REQUIRE(stats.DecodePercentileUs(99.0) == 0.0);
+
+    stats.decodeHistogram[0] = 90; // < 1 us
+    stats.decodeHistogram[4] = 10; // [8, 16) us
+    REQUIRE(stats.DecodePercentileUs(50.0) == 1.0);
+    REQUIRE(stats.DecodePercentileUs(99.0) == 16.0);
+}
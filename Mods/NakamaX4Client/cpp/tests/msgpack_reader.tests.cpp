@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <msgpack.hpp>
+#include <string>
+#include <vector>
+
+#include "../src/public/msgpack_reader.h"
+
+namespace {
+    // Same wire layout as PositionUpdate in sector_match.h
+    struct TestPositionUpdate {
+        std::string player_id;
+        std::vector<float> position;
+        std::vector<float> rotation;
+        std::vector<float> velocity;
+
+        MSGPACK_DEFINE(player_id, position, rotation, velocity);
+    };
+
+    std::string Pack(const TestPositionUpdate& update) {
+        msgpack::sbuffer buffer;
+        msgpack::pack(buffer, update);
+        return std::string(buffer.data(), buffer.size());
+    }
+}
+
+TEST_CASE("MsgPackReader decodes a position update") {
+    // ["p1", [1.5, -2, 3], [0, 0.25, 0], [10, 0, 0.0 (float64)]]
+    const unsigned char bytes[] = {
+        0x94, 0xa2, 'p', '1',
+        0x93, 0xca, 0x3f, 0xc0, 0x00, 0x00, 0xfe, 0x03,
+        0x93, 0x00, 0xca, 0x3e, 0x80, 0x00, 0x00, 0x00,
+        0x93, 0x0a, 0x00, 0xcb, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+    MsgPackReader reader(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    PositionUpdateView update;
+
+    REQUIRE(MatchDecode::ReadPositionUpdate(reader, update));
+    REQUIRE(reader.AtEnd());
+    REQUIRE(update.player_id == "p1");
+    REQUIRE(update.position == std::array<float, 3>{ 1.5f, -2.0f, 3.0f });
+    REQUIRE(update.rotation == std::array<float, 3>{ 0.0f, 0.25f, 0.0f });
+    REQUIRE(update.velocity == std::array<float, 3>{ 10.0f, 0.0f, 0.0f });
+}
+
+TEST_CASE("MsgPackReader matches msgpack-c output") {
+    const TestPositionUpdate original{ "a-long-nakama-user-id-0123456789abcdef",
+        { 1.0e6f, -3.25f, 7.0f }, { 0.1f, 0.2f, 0.3f }, { -1.0f, 0.0f, 250.5f } };
+    const std::string packed = Pack(original);
+
+    MsgPackReader reader(packed.data(), packed.size());
+    PositionUpdateView update;
+    REQUIRE(MatchDecode::ReadPositionUpdate(reader, update));
+    REQUIRE(update.player_id == original.player_id);
+    for (size_t i = 0; i < 3; ++i) {
+        REQUIRE(update.position[i] == original.position[i]);
+        REQUIRE(update.rotation[i] == original.rotation[i]);
+        REQUIRE(update.velocity[i] == original.velocity[i]);
+    }
+}
+
+TEST_CASE("MsgPackReader skips nested values") {
+    // [{"k": [1, "x", nil]}, bin(2), 7]
+    const unsigned char bytes[] = {
+        0x93, 0x81, 0xa1, 'k', 0x93, 0x01, 0xa1, 'x', 0xc0,
+        0xc4, 0x02, 0xaa, 0xbb, 0x07,
+    };
+    MsgPackReader reader(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    std::uint32_t count = 0;
+    REQUIRE(reader.ReadArrayHeader(count));
+    REQUIRE(count == 3);
+
+    std::string_view raw;
+    REQUIRE(reader.ReadRaw(raw));
+    REQUIRE(raw.size() == 8);
+    REQUIRE(reader.Skip());
+
+    std::int64_t value = 0;
+    REQUIRE(reader.ReadInt(value));
+    REQUIRE(value == 7);
+    REQUIRE(reader.AtEnd());
+}
+
+TEST_CASE("MsgPackReader rejects truncated input") {
+    const unsigned char bytes[] = { 0x94, 0xa5, 'p', '1' };
+    MsgPackReader reader(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    PositionUpdateView update;
+
+    REQUIRE_FALSE(MatchDecode::ReadPositionUpdate(reader, update));
+    REQUIRE_FALSE(reader.Ok());
+}
+
+// One iteration decodes a second's worth of traffic at 10k messages/s.
+// Hidden by default; run with the [benchmark] tag.
+TEST_CASE("Position decode throughput", "[.][benchmark]") {
+    constexpr int MESSAGES = 10000;
+    std::vector<std::string> packets;
+    packets.reserve(MESSAGES);
+    for (int i = 0; i < MESSAGES; ++i) {
+        const float f = static_cast<float>(i);
+        packets.push_back(Pack({ "player-" + std::to_string(i % 64),
+            { f, f * 0.5f, -f }, { 0.0f, 0.01f * f, 0.0f }, { 1.0f, 2.0f, 3.0f } }));
+    }
+
+    BENCHMARK("msgpack::unpack + convert") {
+        float sum = 0.0f;
+        for (const auto& packet : packets) {
+            msgpack::object_handle oh = msgpack::unpack(packet.data(), packet.size());
+            TestPositionUpdate update;
+            oh.get().convert(update);
+            sum += update.position[0];
+        }
+        return sum;
+    };
+
+    BENCHMARK("MsgPackReader") {
+        float sum = 0.0f;
+        for (const auto& packet : packets) {
+            MsgPackReader reader(packet.data(), packet.size());
+            PositionUpdateView update;
+            MatchDecode::ReadPositionUpdate(reader, update);
+            sum += update.position[0];
+        }
+        return sum;
+    };
+}
@@ -0,0 +1,163 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "../src/public/network_executor.h"
+#include "../src/public/net_socket.h"
+
+using Clock = NetworkExecutor::Clock;
+using std::chrono::milliseconds;
+
+namespace {
+bool WaitFor(const std::function<bool()>& condition, milliseconds limit = milliseconds(2000)) {
+    const auto deadline = Clock::now() + limit;
+    while (!condition()) {
+        if (Clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return true;
+}
+}
+
+TEST_CASE("NetworkExecutor sleeps while idle and wakes for work") {
+    std::atomic<int> ticks{ 0 };
+    NetworkExecutor executor;
+    REQUIRE(executor.Start([&ticks](Clock::time_point) {
+        ++ticks;
+        return Clock::time_point::max();
+    }));
+    REQUIRE_FALSE(executor.Start([](Clock::time_point now) { return now; }));
+
+    // One initial round, then nothing until woken
+    REQUIRE(WaitFor([&]() { return ticks == 1; }));
+    std::this_thread::sleep_for(milliseconds(200));
+    REQUIRE(ticks == 1);
+
+    std::atomic<bool> ran{ false };
+    const auto posted = Clock::now();
+    executor.Post([&ran, &executor]() { ran = executor.IsExecutorThread(); });
+    REQUIRE(WaitFor([&]() { return ticks == 2; }));
+    REQUIRE(ran);
+    REQUIRE(Clock::now() - posted < milliseconds(100));
+
+    executor.Stop();
+    REQUIRE_FALSE(executor.IsRunning());
+}
+
+TEST_CASE("NetworkExecutor honours tick deadlines and timers") {
+    std::atomic<int> ticks{ 0 };
+    NetworkExecutor executor;
+    executor.Start([&ticks](Clock::time_point now) {
+        ++ticks;
+        return now + milliseconds(20);
+    });
+    std::this_thread::sleep_for(milliseconds(200));
+    executor.Stop();
+    // Roughly every 20 ms, never a busy loop
+    REQUIRE(ticks >= 4);
+    REQUIRE(ticks <= 15);
+
+    std::atomic<int> order{ 0 };
+    std::atomic<int> first{ 0 };
+    std::atomic<int> second{ 0 };
+    NetworkExecutor timers;
+    timers.Start([](Clock::time_point) { return Clock::time_point::max(); });
+    const auto start = Clock::now();
+    timers.PostAt(start + milliseconds(60), [&]() { second = ++order; });
+    timers.PostAt(start + milliseconds(30), [&]() { first = ++order; });
+    REQUIRE(WaitFor([&]() { return second != 0; }));
+    REQUIRE(Clock::now() - start >= milliseconds(60));
+    REQUIRE(first == 1);
+    REQUIRE(second == 2);
+    REQUIRE(timers.GetStats().workItems == 2);
+}
+
+TEST_CASE("NetworkExecutor blocks in the socket source when one is installed") {
+    NetSocket::Startup();
+    const NetSocket::Handle wake = NetSocket::CreateWakeSocket();
+    REQUIRE(wake != NetSocket::INVALID_HANDLE);
+
+    std::atomic<int> socketWaits{ 0 };
+    std::atomic<int> ticks{ 0 };
+    NetworkExecutor executor;
+    executor.Start(
+        [&ticks](Clock::time_point) {
+            ++ticks;
+            return Clock::time_point::max();
+        },
+        [&socketWaits, wake](milliseconds timeout) {
+            ++socketWaits;
+            NetSocket::PollEntry entry;
+            entry.socket = wake;
+            entry.wantRead = true;
+            NetSocket::Poll(&entry, 1, static_cast<int>(timeout.count()));
+            if (entry.readable) {
+                NetSocket::DrainWake(wake);
+            }
+            return true;
+        },
+        [wake]() { NetSocket::SignalWake(wake); });
+
+    REQUIRE(WaitFor([&]() { return socketWaits == 1; }));
+    executor.Wake();
+    REQUIRE(WaitFor([&]() { return ticks == 2; }));
+
+    // Stop interrupts the socket wait and joins
+    const auto stopping = Clock::now();
+    executor.Stop();
+    REQUIRE(Clock::now() - stopping < milliseconds(500));
+    NetSocket::Close(wake);
+}
+
+TEST_CASE("NetworkExecutor can be stopped from its own thread") {
+    NetworkExecutor executor;
+    std::atomic<bool> stopped{ false };
+    executor.Start([&](Clock::time_point) {
+        executor.Stop();
+        stopped = true;
+        return Clock::time_point::max();
+    });
+    REQUIRE(WaitFor([&]() { return stopped.load(); }));
+    REQUIRE(WaitFor([&]() { return !executor.IsRunning(); }));
+}
+
+TEST_CASE("NetworkExecutor resumes tasks on its thread") {
+    NetworkExecutor executor;
+    executor.Start([](Clock::time_point) { return Clock::time_point::max(); });
+
+    std::thread responder;
+    std::atomic<bool> onExecutor{ true };
+    auto flow = [&]() -> Task<int> {
+        co_await Delay(milliseconds(10));
+        onExecutor = onExecutor && executor.IsExecutorThread();
+        // Completed from another thread, as the SDK does from its tick
+        const int value = co_await FromCallbacks<int>(
+            [&responder](auto onSuccess, auto) { responder = std::thread([onSuccess]() { onSuccess(41); }); },
+            [](int) { return std::exception_ptr(); });
+        onExecutor = onExecutor && executor.IsExecutorThread();
+        co_return value + 1;
+    };
+
+    auto result = Spawn(executor, flow());
+    REQUIRE(result.wait_for(milliseconds(2000)) == std::future_status::ready);
+    REQUIRE(result.get() == 42);
+    REQUIRE(onExecutor);
+    responder.join();
+
+    // Without its thread the executor is driven by RunPending
+    executor.Stop();
+    CancellationSource source;
+    auto stalled = Spawn(executor, []() -> Task<int> {
+        co_await Delay(std::chrono::hours(1));
+        co_return 0;
+    }(), source.Token());
+    executor.RunPending(Clock::now());
+    source.Cancel();
+    executor.RunPending(Clock::now());
+    REQUIRE(stalled.wait_for(milliseconds(0)) == std::future_status::ready);
+    REQUIRE_THROWS_AS(stalled.get(), TaskCancelled);
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/public/outbound_queue.h"
+
+using Sent = std::vector<std::pair<std::int64_t, std::string>>;
+
+static Sent FlushAll(OutboundQueue& queue) {
+    Sent sent;
+    queue.Flush([&sent](std::int64_t opCode, const std::string& payload) {
+        sent.emplace_back(opCode, payload);
+    });
+    return sent;
+}
+
+TEST_CASE("OutboundQueue merges pending updates per opcode") {
+    OutboundQueue queue;
+    queue.Enqueue(1, "pos-a");
+    queue.Enqueue(2, "fleet-a");
+    queue.Enqueue(1, "pos-b");
+
+    REQUIRE(queue.PendingCount() == 2);
+
+    const Sent sent = FlushAll(queue);
+    REQUIRE(sent.size() == 2);
+    REQUIRE(sent[0] == std::make_pair(std::int64_t(1), std::string("pos-b")));
+    REQUIRE(sent[1] == std::make_pair(std::int64_t(2), std::string("fleet-a")));
+
+    const OpCodeCounters counters = queue.GetCounters(1);
+    REQUIRE(counters.enqueued == 2);
+    REQUIRE(counters.merged == 1);
+    REQUIRE(counters.sent == 1);
+    REQUIRE(counters.bytes == 5);
+}
+
+TEST_CASE("OutboundQueue keeps non-replaceable messages in order") {
+    OutboundQueue queue;
+    queue.Enqueue(7, "first", false);
+    queue.Enqueue(7, "second", false);
+
+    const Sent sent = FlushAll(queue);
+    REQUIRE(sent.size() == 2);
+    REQUIRE(sent[0].second == "first");
+    REQUIRE(sent[1].second == "second");
+}
+
+TEST_CASE("OutboundQueue never merges over a pending keyframe") {
+    OutboundQueue queue;
+    queue.Enqueue(2, "fleet-keyframe", false);
+    queue.Enqueue(2, "fleet-a");
+    queue.Enqueue(2, "fleet-b");
+
+    // The keyframe keeps its slot; later updates merge among themselves
+    const Sent sent = FlushAll(queue);
+    REQUIRE(sent.size() == 2);
+    REQUIRE(sent[0].second == "fleet-keyframe");
+    REQUIRE(sent[1].second == "fleet-b");
+    REQUIRE(queue.GetCounters(2).merged == 1);
+}
+
+TEST_CASE("OutboundQueue reuses payload buffers") {
+    OutboundQueue queue;
+    queue.Enqueue(1, "a");
+    queue.Enqueue(2, "b");
+    FlushAll(queue);
+    REQUIRE(queue.PooledBufferCount() == 2);
+
+    queue.Enqueue(1, "c");
+    REQUIRE(queue.PooledBufferCount() == 1);
+    FlushAll(queue);
+    REQUIRE(queue.PooledBufferCount() == 2);
+}
+
+TEST_CASE("OutboundQueue recovers from a failed send") {
+    OutboundQueue queue;
+    queue.Enqueue(1, "a");
+    queue.Enqueue(2, "b");
+
+    REQUIRE_THROWS(queue.Flush([](std::int64_t, const std::string&) {
+        throw std::runtime_error("socket closed");
+    }));
+    REQUIRE(queue.PendingCount() == 0);
+
+    queue.Enqueue(3, "c");
+    const Sent sent = FlushAll(queue);
+    REQUIRE(sent.size() == 1);
+    REQUIRE(sent[0].first == 3);
+}
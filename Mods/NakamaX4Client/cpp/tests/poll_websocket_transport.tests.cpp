@@ -0,0 +1,236 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/public/poll_websocket_transport.h"
+
+using WebsocketCodec::Opcode;
+using Nakama::NRtClientDisconnectInfo;
+
+namespace {
+// Minimal websocket server on 127.0.0.1 standing in for Nakama: completes
+// the upgrade, echoes data frames, answers "ping-me" with a server ping and
+// "close-me" with a close frame (1001).
+class LoopbackWebsocketServer
+{
+public:
+    LoopbackWebsocketServer() {
+        m_listener = NetSocket::ListenLoopback(m_port);
+        m_thread = std::thread([this]() { Run(); });
+    }
+
+    ~LoopbackWebsocketServer() {
+        m_stop = true;
+        NetSocket::Close(m_client);
+        NetSocket::Close(m_listener);
+        m_thread.join();
+    }
+
+    int Port() const { return m_port; }
+    int PongsReceived() const { return m_pongs; }
+    std::string Target() const { return m_target; }
+
+private:
+    void Run() {
+        m_client = NetSocket::Accept(m_listener);
+        if (m_client == NetSocket::INVALID_HANDLE) {
+            return;
+        }
+
+        std::string buffer;
+        size_t headerEnd = std::string::npos;
+        while (headerEnd == std::string::npos && ReadMore(buffer)) {
+            headerEnd = buffer.find("\r\n\r\n");
+        }
+        if (headerEnd == std::string::npos) {
+            return;
+        }
+        const std::string header = buffer.substr(0, headerEnd);
+        buffer.erase(0, headerEnd + 4);
+        m_target = header.substr(4, header.find(' ', 4) - 4);
+
+        const std::string keyName = "Sec-WebSocket-Key: ";
+        const size_t keyStart = header.find(keyName) + keyName.size();
+        const std::string key = header.substr(keyStart, header.find("\r\n", keyStart) - keyStart);
+        Write("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + WebsocketCodec::AcceptKey(key) + "\r\n\r\n");
+
+        while (!m_stop) {
+            WebsocketCodec::Frame frame;
+            const auto result = WebsocketCodec::ParseFrame(buffer.data(), buffer.size(), 1 << 24, frame);
+            if (result == WebsocketCodec::ParseResult::Error) {
+                return;
+            }
+            if (result == WebsocketCodec::ParseResult::NeedMore) {
+                if (!ReadMore(buffer)) {
+                    return;
+                }
+                continue;
+            }
+
+            const std::string payload(frame.payload);
+            buffer.erase(0, frame.frameSize);
+            std::string out;
+            if (frame.opcode == Opcode::Pong) {
+                ++m_pongs;
+            }
+            else if (frame.opcode == Opcode::Close) {
+                return;
+            }
+            else if (payload == "ping-me") {
+                WebsocketCodec::AppendFrame(out, Opcode::Ping, "probe", true, nullptr);
+            }
+            else if (payload == "close-me") {
+                WebsocketCodec::AppendFrame(out, Opcode::Close, std::string("\x03\xE9" "bye", 5), true, nullptr);
+            }
+            else {
+                WebsocketCodec::AppendFrame(out, frame.opcode, payload, true, nullptr);
+            }
+            Write(out);
+        }
+    }
+
+    bool ReadMore(std::string& buffer) {
+        char chunk[4096];
+        bool wouldBlock = false;
+        const int received = NetSocket::Recv(m_client, chunk, sizeof(chunk), wouldBlock);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+        return true;
+    }
+
+    void Write(const std::string& data) {
+        size_t offset = 0;
+        bool wouldBlock = false;
+        while (offset < data.size()) {
+            const int sent = NetSocket::Send(m_client, data.data() + offset, data.size() - offset, wouldBlock);
+            if (sent <= 0) {
+                return;
+            }
+            offset += static_cast<size_t>(sent);
+        }
+    }
+
+    NetSocket::Handle m_listener = NetSocket::INVALID_HANDLE;
+    NetSocket::Handle m_client = NetSocket::INVALID_HANDLE;
+    int m_port = 0;
+    std::string m_target;
+    std::atomic<int> m_pongs{ 0 };
+    std::atomic<bool> m_stop{ false };
+    std::thread m_thread;
+};
+
+struct TransportHarness
+{
+    PollWebsocketTransport transport;
+    std::vector<std::string> messages;
+    std::vector<NRtClientDisconnectInfo> disconnects;
+    std::vector<std::string> errors;
+    bool connected = false;
+
+    TransportHarness() {
+        transport.setConnectCallback([this]() { connected = true; });
+        transport.setMessageCallback([this](const Nakama::NBytes& data) { messages.push_back(data); });
+        transport.setDisconnectCallback([this](const NRtClientDisconnectInfo& info) { disconnects.push_back(info); });
+        transport.setErrorCallback([this](const std::string& error) { errors.push_back(error); });
+    }
+
+    // Drives the transport the way the network thread does
+    bool PumpUntil(const std::function<bool()>& done, std::chrono::milliseconds limit = std::chrono::milliseconds(3000)) {
+        const auto deadline = std::chrono::steady_clock::now() + limit;
+        while (!done()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            transport.WaitForActivity(std::chrono::milliseconds(50));
+            transport.tick();
+        }
+        return true;
+    }
+};
+}
+
+TEST_CASE("PollWebsocketTransport talks to a loopback websocket server") {
+    LoopbackWebsocketServer server;
+    TransportHarness harness;
+
+    harness.transport.connect("ws://127.0.0.1:" + std::to_string(server.Port()) + "/ws?token=abc",
+        Nakama::NRtTransportType::Binary);
+    REQUIRE(harness.transport.isConnecting());
+    REQUIRE_FALSE(harness.connected); // Never fired from inside connect()
+    REQUIRE(harness.PumpUntil([&]() { return harness.connected; }));
+    REQUIRE(harness.transport.isConnected());
+    REQUIRE(server.Target() == "/ws?token=abc");
+
+    SECTION("echoes without growing the preallocated buffers") {
+        const size_t receiveCapacity = harness.transport.ReceiveCapacity();
+        const size_t messageCapacity = harness.transport.MessageCapacity();
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(harness.transport.send("message " + std::to_string(i)));
+        }
+        REQUIRE(harness.PumpUntil([&]() { return harness.messages.size() == 100; }));
+        REQUIRE(harness.messages.front() == "message 0");
+        REQUIRE(harness.messages.back() == "message 99");
+        REQUIRE(harness.transport.ReceiveCapacity() == receiveCapacity);
+        REQUIRE(harness.transport.MessageCapacity() == messageCapacity);
+
+        // Larger than the receive buffer: grows once, arrives intact
+        const std::string large(PollWebsocketTransport::RECEIVE_BUFFER_SIZE * 3, 'L');
+        REQUIRE(harness.transport.send(large));
+        REQUIRE(harness.PumpUntil([&]() { return harness.messages.size() == 101; }));
+        REQUIRE(harness.messages.back() == large);
+    }
+
+    SECTION("wakes on readiness instead of sleeping out the timeout") {
+        REQUIRE(harness.transport.send("wake"));
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(harness.PumpUntil([&]() { return !harness.messages.empty(); }));
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(40));
+
+        std::thread waker([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            harness.transport.Wake();
+        });
+        const auto waitStart = std::chrono::steady_clock::now();
+        REQUIRE(harness.transport.WaitForActivity(std::chrono::milliseconds(5000)));
+        REQUIRE(std::chrono::steady_clock::now() - waitStart < std::chrono::milliseconds(1000));
+        waker.join();
+    }
+
+    SECTION("answers server pings and reports a remote close") {
+        REQUIRE(harness.transport.send("ping-me"));
+        REQUIRE(harness.PumpUntil([&]() { return server.PongsReceived() == 1; }));
+
+        REQUIRE(harness.transport.send("close-me"));
+        REQUIRE(harness.PumpUntil([&]() { return !harness.disconnects.empty(); }));
+        REQUIRE(harness.disconnects.front().code == 1001);
+        REQUIRE(harness.disconnects.front().reason == "bye");
+        REQUIRE(harness.disconnects.front().remote);
+        REQUIRE_FALSE(harness.transport.isConnected());
+    }
+
+    SECTION("reports a local disconnect on the next tick") {
+        harness.transport.disconnect();
+        REQUIRE(harness.disconnects.empty());
+        harness.transport.tick();
+        REQUIRE(harness.disconnects.size() == 1);
+        REQUIRE(harness.disconnects.front().code == NRtClientDisconnectInfo::NORMAL_CLOSURE);
+        REQUIRE_FALSE(harness.transport.send("late"));
+    }
+}
+
+TEST_CASE("PollWebsocketTransport refuses wss urls asynchronously") {
+    TransportHarness harness;
+    harness.transport.connect("wss://127.0.0.1:7350/ws", Nakama::NRtTransportType::Binary);
+    REQUIRE(harness.disconnects.empty());
+    harness.transport.tick();
+    REQUIRE(harness.errors.size() == 1);
+    REQUIRE(harness.disconnects.size() == 1);
+    REQUIRE(harness.disconnects.front().code == NRtClientDisconnectInfo::TLS_HANDSHAKE);
+}
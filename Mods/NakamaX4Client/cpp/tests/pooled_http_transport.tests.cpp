@@ -0,0 +1,325 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/public/pooled_http_transport.h"
+#include <nakama-cpp/ClientFactory.h>
+
+using Nakama::NHttpReqMethod;
+using Nakama::NHttpRequest;
+using Nakama::NHttpResponsePtr;
+
+namespace {
+// Keep-alive HTTP/1.1 server on 127.0.0.1 standing in for Nakama's REST API.
+// Answers every request with "<METHOD> <target>|<body>". "/chunked" replies
+// with a chunked body and "/close" closes the connection after replying.
+// acceptDelay simulates the cost of setting up a connection (TCP + TLS
+// round trips on a real link).
+class LoopbackHttpServer
+{
+public:
+    explicit LoopbackHttpServer(std::chrono::milliseconds acceptDelay = std::chrono::milliseconds(0))
+        : m_acceptDelay(acceptDelay) {
+        m_listener = NetSocket::ListenLoopback(m_port);
+        m_thread = std::thread([this]() { Run(); });
+    }
+
+    ~LoopbackHttpServer() {
+        m_stop = true;
+        m_thread.join();
+        for (auto& client : m_clients) {
+            NetSocket::Close(client.socket);
+        }
+        NetSocket::Close(m_listener);
+    }
+
+    std::string BaseUri() const { return "http://127.0.0.1:" + std::to_string(m_port); }
+    int ConnectionsAccepted() const { return m_accepted; }
+
+private:
+    struct Client
+    {
+        NetSocket::Handle socket;
+        std::string buffer;
+    };
+
+    void Run() {
+        while (!m_stop) {
+            std::vector<NetSocket::PollEntry> entries(1);
+            entries[0].socket = m_listener;
+            entries[0].wantRead = true;
+            for (size_t i = 0; i < m_clients.size() && entries.size() < 8; ++i) {
+                NetSocket::PollEntry entry;
+                entry.socket = m_clients[i].socket;
+                entry.wantRead = true;
+                entries.push_back(entry);
+            }
+            if (NetSocket::Poll(entries.data(), entries.size(), 10) <= 0) {
+                continue;
+            }
+
+            if (entries[0].readable) {
+                std::this_thread::sleep_for(m_acceptDelay);
+                const NetSocket::Handle socket = NetSocket::Accept(m_listener);
+                if (socket != NetSocket::INVALID_HANDLE) {
+                    m_clients.push_back({ socket, std::string() });
+                    ++m_accepted;
+                }
+            }
+
+            for (size_t i = 1; i < entries.size(); ++i) {
+                if (entries[i].readable || entries[i].failed) {
+                    Serve(m_clients[i - 1]);
+                }
+            }
+            for (auto it = m_clients.begin(); it != m_clients.end();) {
+                if (it->socket == NetSocket::INVALID_HANDLE) {
+                    it = m_clients.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    void Serve(Client& client) {
+        char chunk[4096];
+        bool wouldBlock = false;
+        const int received = NetSocket::Recv(client.socket, chunk, sizeof(chunk), wouldBlock);
+        if (received <= 0) {
+            NetSocket::Close(client.socket);
+            client.socket = NetSocket::INVALID_HANDLE;
+            return;
+        }
+        client.buffer.append(chunk, static_cast<size_t>(received));
+
+        // Several (pipelined) requests may be buffered
+        for (;;) {
+            const size_t end = client.buffer.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                return;
+            }
+            const std::string header = client.buffer.substr(0, end);
+            size_t length = 0;
+            const size_t lengthAt = header.find("Content-Length: ");
+            if (lengthAt != std::string::npos) {
+                length = static_cast<size_t>(std::atoi(header.c_str() + lengthAt + 16));
+            }
+            if (client.buffer.size() < end + 4 + length) {
+                return;
+            }
+            const std::string body = client.buffer.substr(end + 4, length);
+            client.buffer.erase(0, end + 4 + length);
+
+            const std::string requestLine = header.substr(0, header.find(" HTTP/1.1"));
+            const std::string target = requestLine.substr(requestLine.find(' ') + 1);
+            const std::string payload = requestLine + "|" + body;
+
+            std::string response;
+            if (target == "/chunked") {
+                const std::string half = payload.substr(0, payload.size() / 2);
+                const std::string rest = payload.substr(half.size());
+                char size[16];
+                response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+                std::snprintf(size, sizeof(size), "%zx\r\n", half.size());
+                response += size + half + "\r\n";
+                std::snprintf(size, sizeof(size), "%zx\r\n", rest.size());
+                response += size + rest + "\r\n0\r\n\r\n";
+            }
+            else {
+                response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                    std::to_string(payload.size()) + (target == "/close" ? "\r\nConnection: close" : "") +
+                    "\r\n\r\n" + payload;
+            }
+
+            size_t offset = 0;
+            while (offset < response.size()) {
+                const int sent = NetSocket::Send(client.socket, response.data() + offset, response.size() - offset, wouldBlock);
+                if (sent <= 0) {
+                    break;
+                }
+                offset += static_cast<size_t>(sent);
+            }
+            if (target == "/close") {
+                NetSocket::Close(client.socket);
+                client.socket = NetSocket::INVALID_HANDLE;
+                return;
+            }
+        }
+    }
+
+    std::chrono::milliseconds m_acceptDelay;
+    NetSocket::Handle m_listener = NetSocket::INVALID_HANDLE;
+    int m_port = 0;
+    std::vector<Client> m_clients;
+    std::atomic<int> m_accepted{ 0 };
+    std::atomic<bool> m_stop{ false };
+    std::thread m_thread;
+};
+
+NHttpRequest MakeRequest(NHttpReqMethod method, const std::string& path, const std::string& body = "") {
+    NHttpRequest request;
+    request.method = method;
+    request.path = path;
+    request.body = body;
+    request.headers["Content-Type"] = "application/json";
+    return request;
+}
+
+// Ticks the transport the way NClientInterface::tick does
+bool PumpUntil(Nakama::NHttpTransportInterface& transport, const std::function<bool()>& done,
+    std::chrono::milliseconds limit = std::chrono::milliseconds(3000)) {
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        transport.tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Issues a burst of requests and pumps until every callback ran
+bool RunBurst(Nakama::NHttpTransportInterface& transport, int count, NHttpReqMethod method) {
+    int done = 0;
+    for (int i = 0; i < count; ++i) {
+        transport.request(MakeRequest(method, "/v2/rpc/sync", "{\"i\":" + std::to_string(i) + "}"),
+            [&done](NHttpResponsePtr response) { done += response->statusCode == 200; });
+    }
+    return PumpUntil(transport, [&]() { return done == count; });
+}
+}
+
+TEST_CASE("PooledHttpTransport reuses keep-alive connections") {
+    LoopbackHttpServer server;
+    PooledHttpTransport transport;
+    transport.setBaseUri(server.BaseUri());
+
+    std::vector<HttpRequestTiming> timings;
+    transport.SetTimingObserver([&timings](const HttpRequestTiming& timing) { timings.push_back(timing); });
+
+    for (int i = 0; i < 5; ++i) {
+        NHttpResponsePtr response;
+        NHttpRequest request = MakeRequest(NHttpReqMethod::POST, "/v2/account/authenticate/device", "{\"id\":1}");
+        request.queryArgs.insert({ "username", "Pilot One" });
+        transport.request(request, [&response](NHttpResponsePtr r) { response = r; });
+        REQUIRE(PumpUntil(transport, [&]() { return response != nullptr; }));
+        REQUIRE(response->statusCode == 200);
+        REQUIRE(response->body == "POST /v2/account/authenticate/device?username=Pilot%20One|{\"id\":1}");
+    }
+
+    REQUIRE(server.ConnectionsAccepted() == 1);
+    const HttpTransportStats stats = transport.GetStats();
+    REQUIRE(stats.requests == 5);
+    REQUIRE(stats.connectionsOpened == 1);
+    REQUIRE(stats.reusedRequests == 4);
+    REQUIRE(timings.size() == 5);
+    REQUIRE_FALSE(timings.front().reusedConnection);
+    REQUIRE(timings.back().reusedConnection);
+    REQUIRE(timings.back().totalMs >= timings.back().firstByteMs);
+}
+
+TEST_CASE("PooledHttpTransport spreads bursts and pipelines idempotent requests") {
+    LoopbackHttpServer server;
+
+    SECTION("POST bursts use up to maxConnections, never pipelined") {
+        PooledHttpTransport transport;
+        transport.setBaseUri(server.BaseUri());
+        REQUIRE(RunBurst(transport, 12, NHttpReqMethod::POST));
+        REQUIRE(transport.GetStats().pipelinedRequests == 0);
+        REQUIRE(server.ConnectionsAccepted() <= 4);
+    }
+
+    SECTION("GETs share a single connection in order") {
+        PooledHttpTransport::Config config;
+        config.maxConnections = 1;
+        PooledHttpTransport transport(config);
+        transport.setBaseUri(server.BaseUri());
+
+        std::vector<std::string> bodies;
+        for (int i = 0; i < 4; ++i) {
+            transport.request(MakeRequest(NHttpReqMethod::GET, "/v2/storage/" + std::to_string(i)),
+                [&bodies](NHttpResponsePtr response) { bodies.push_back(response->body); });
+        }
+        REQUIRE(PumpUntil(transport, [&]() { return bodies.size() == 4; }));
+        REQUIRE(bodies[0] == "GET /v2/storage/0|");
+        REQUIRE(bodies[3] == "GET /v2/storage/3|");
+        REQUIRE(transport.GetStats().pipelinedRequests == 3);
+        REQUIRE(server.ConnectionsAccepted() == 1);
+    }
+}
+
+TEST_CASE("PooledHttpTransport handles chunked bodies, closes and cancellation") {
+    LoopbackHttpServer server;
+    PooledHttpTransport transport;
+    transport.setBaseUri(server.BaseUri());
+
+    NHttpResponsePtr chunked;
+    transport.request(MakeRequest(NHttpReqMethod::POST, "/chunked", "abcdef"),
+        [&chunked](NHttpResponsePtr r) { chunked = r; });
+    REQUIRE(PumpUntil(transport, [&]() { return chunked != nullptr; }));
+    REQUIRE(chunked->body == "POST /chunked|abcdef");
+
+    NHttpResponsePtr closed;
+    transport.request(MakeRequest(NHttpReqMethod::POST, "/close"), [&closed](NHttpResponsePtr r) { closed = r; });
+    REQUIRE(PumpUntil(transport, [&]() { return closed != nullptr; }));
+    REQUIRE(closed->statusCode == 200);
+    REQUIRE(PumpUntil(transport, [&]() { return transport.OpenConnectionCount() == 0; }));
+
+    // A fresh connection is opened transparently afterwards
+    REQUIRE(RunBurst(transport, 1, NHttpReqMethod::POST));
+    REQUIRE(server.ConnectionsAccepted() == 2);
+
+    NHttpResponsePtr cancelled;
+    transport.request(MakeRequest(NHttpReqMethod::POST, "/v2/rpc/slow"), [&cancelled](NHttpResponsePtr r) { cancelled = r; });
+    transport.cancelAllRequests();
+    transport.tick();
+    REQUIRE(cancelled != nullptr);
+    REQUIRE(cancelled->statusCode == Nakama::InternalStatusCodes::CANCELLED_BY_USER);
+}
+
+// Hidden by default; run with the [benchmark] tag. The stand-in server
+// charges 5 ms per new connection, roughly a nearby server's handshake.
+TEST_CASE("HTTP transport burst latency", "[.][benchmark]") {
+    LoopbackHttpServer server(std::chrono::milliseconds(5));
+
+    PooledHttpTransport pooled;
+    pooled.setBaseUri(server.BaseUri());
+    auto sdkDefault = Nakama::createDefaultHttpTransport(Nakama::NPlatformParameters{});
+    REQUIRE(sdkDefault);
+    sdkDefault->setBaseUri(server.BaseUri());
+
+    BENCHMARK("SDK default transport: 20 sequential syncs") {
+        bool ok = true;
+        for (int i = 0; i < 20; ++i) {
+            ok = RunBurst(*sdkDefault, 1, NHttpReqMethod::POST) && ok;
+        }
+        return ok;
+    };
+
+    BENCHMARK("PooledHttpTransport: 20 sequential syncs") {
+        bool ok = true;
+        for (int i = 0; i < 20; ++i) {
+            ok = RunBurst(pooled, 1, NHttpReqMethod::POST) && ok;
+        }
+        return ok;
+    };
+
+    BENCHMARK("SDK default transport: burst of 20 syncs") {
+        return RunBurst(*sdkDefault, 20, NHttpReqMethod::POST);
+    };
+
+    BENCHMARK("PooledHttpTransport: burst of 20 syncs") {
+        return RunBurst(pooled, 20, NHttpReqMethod::POST);
+    };
+}
@@ -0,0 +1,44 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+
+#include "../src/public/reconnect_backoff.h"
+
+using std::chrono::milliseconds;
+
+TEST_CASE("ReconnectBackoff grows exponentially up to the cap") {
+    ReconnectBackoff::Config config;
+    config.initialDelay = milliseconds(100);
+    config.maxDelay = milliseconds(1000);
+    config.jitter = 0.0;
+    ReconnectBackoff backoff(config, 1);
+
+    REQUIRE(backoff.NextDelay() == milliseconds(100));
+    REQUIRE(backoff.NextDelay() == milliseconds(200));
+    REQUIRE(backoff.NextDelay() == milliseconds(400));
+    REQUIRE(backoff.NextDelay() == milliseconds(800));
+    REQUIRE(backoff.NextDelay() == milliseconds(1000));
+    REQUIRE(backoff.NextDelay() == milliseconds(1000));
+    REQUIRE(backoff.Attempts() == 6);
+
+    backoff.Reset();
+    REQUIRE(backoff.Attempts() == 0);
+    REQUIRE(backoff.NextDelay() == milliseconds(100));
+}
+
+TEST_CASE("ReconnectBackoff jitter stays within its band") {
+    ReconnectBackoff::Config config;
+    config.initialDelay = milliseconds(1000);
+    config.maxDelay = milliseconds(1000);
+    config.jitter = 0.5;
+    ReconnectBackoff backoff(config, 42);
+
+    bool varied = false;
+    milliseconds first = backoff.NextDelay();
+    for (int i = 0; i < 50; ++i) {
+        const milliseconds delay = backoff.NextDelay();
+        REQUIRE(delay >= milliseconds(500));
+        REQUIRE(delay <= milliseconds(1000));
+        varied = varied || delay != first;
+    }
+    REQUIRE(varied);
+}
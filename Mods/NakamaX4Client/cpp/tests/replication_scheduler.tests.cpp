@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../src/public/replication_scheduler.h"
+
+using std::chrono::milliseconds;
+using Clock = ReplicationScheduler::Clock;
+
+namespace {
+struct Recorder
+{
+    std::vector<std::string> payloads;
+    ReplicationScheduler::SendFunction Send() {
+        return [this](std::int64_t, std::string_view payload) { payloads.emplace_back(payload); };
+    }
+};
+}
+
+TEST_CASE("ReplicationScheduler sends the highest priority entities first") {
+    // 1000 B/s with a 200 B burst: two 100-byte updates per tick at most
+    ReplicationScheduler scheduler(1000);
+    auto now = Clock::time_point{} + milliseconds(10000);
+    scheduler.Tick(now, [](std::int64_t, std::string_view) {});
+
+    ReplicationHints near;
+    near.observerDistance = 100.0f;
+    ReplicationHints far;
+    far.observerDistance = 50000.0f;
+    ReplicationHints fast = far;
+    fast.speed = 2000.0f;
+    ReplicationHints important = far;
+    important.importance = 10.0f;
+
+    scheduler.Submit("far", 1, std::string(100, 'f'), far, now);
+    scheduler.Submit("near", 1, std::string(100, 'n'), near, now);
+    scheduler.Submit("fast", 1, std::string(100, 's'), fast, now);
+    scheduler.Submit("important", 1, std::string(100, 'i'), important, now);
+
+    REQUIRE(scheduler.GetPriority("near", 1) == 0.0);
+    now += milliseconds(200);
+    Recorder recorder;
+    REQUIRE(scheduler.Tick(now, recorder.Send()) == 2);
+    REQUIRE(recorder.payloads[0][0] == 's'); // 21x speed weight beats 1/11 distance weight
+    REQUIRE(recorder.payloads[1][0] == 'n');
+
+    const ReplicationStats stats = scheduler.GetStats(now);
+    REQUIRE(stats.sent == 2);
+    REQUIRE(stats.bytes == 200);
+    REQUIRE(stats.deferred == 2);
+    REQUIRE(stats.waiting == 2);
+    REQUIRE(stats.maxWaitMs == 200.0);
+}
+
+TEST_CASE("ReplicationScheduler lets low priority entities accrue until sent") {
+    ReplicationScheduler scheduler(500); // 100 B burst, room for one update
+    auto now = Clock::time_point{} + milliseconds(10000);
+    scheduler.Tick(now, [](std::int64_t, std::string_view) {});
+
+    ReplicationHints low;
+    low.importance = 0.5f;
+    ReplicationHints high;
+    high.importance = 1.0f;
+
+    Recorder recorder;
+    scheduler.Submit("low", 1, std::string(100, 'l'), low, now);
+    bool lowSent = false;
+    int ticks = 0;
+    while (!lowSent && ticks < 20) {
+        // The important entity changes every tick and competes every time
+        scheduler.Submit("high", 1, std::string(100, 'h'), high, now);
+        now += milliseconds(200);
+        recorder.payloads.clear();
+        scheduler.Tick(now, recorder.Send());
+        lowSent = !recorder.payloads.empty() && recorder.payloads[0][0] == 'l';
+        ++ticks;
+    }
+    REQUIRE(lowSent);
+    REQUIRE(ticks <= 3);
+    REQUIRE(scheduler.GetStats(now).peakWaitMs >= 400.0);
+}
+
+TEST_CASE("ReplicationScheduler overdraws the budget for oversized payloads") {
+    ReplicationScheduler scheduler(100); // 20 B burst
+    auto now = Clock::time_point{} + milliseconds(10000);
+    Recorder recorder;
+
+    scheduler.Submit("big", 1, std::string(1000, 'b'), ReplicationHints{}, now);
+    REQUIRE(scheduler.Tick(now, recorder.Send()) == 1);
+
+    // Now in debt: nothing more until the debt is repaid
+    scheduler.Submit("big", 1, std::string(1000, 'b'), ReplicationHints{}, now);
+    now += milliseconds(1000);
+    REQUIRE(scheduler.Tick(now, recorder.Send()) == 0);
+
+    scheduler.Remove("big");
+    REQUIRE(scheduler.GetStats(now).waiting == 0);
+}
+
+TEST_CASE("ReplicationScheduler keeps an unsent keyframe until it is sent") {
+    ReplicationScheduler scheduler(500); // 100 B burst, room for one update
+    auto now = Clock::time_point{} + milliseconds(10000);
+    scheduler.Tick(now, [](std::int64_t, std::string_view) {});
+
+    ReplicationHints keyframe;
+    keyframe.importance = 2.0f;
+    keyframe.keyframe = true;
+    ReplicationHints plain;
+
+    // Starve the fleet channel so the plain update lands before the send
+    scheduler.Submit("other", 1, std::string(100, 'o'), ReplicationHints{}, now);
+    scheduler.Tick(now, [](std::int64_t, std::string_view) {});
+    scheduler.Submit("fleet", 2, std::string(100, 'k'), keyframe, now);
+    scheduler.Submit("fleet", 2, std::string(100, 'p'), plain, now);
+
+    // The keyframe keeps its importance over the newer plain state
+    now += milliseconds(200);
+    Recorder recorder;
+    scheduler.Submit("other", 1, std::string(100, 'o'), ReplicationHints{}, now);
+    REQUIRE(scheduler.Tick(now, recorder.Send()) == 1);
+    REQUIRE(recorder.payloads.back()[0] == 'k');
+    REQUIRE(scheduler.GetStats(now).waiting == 2);
+
+    // The newer plain state follows once the keyframe is out
+    scheduler.Remove("other");
+    now += milliseconds(200);
+    REQUIRE(scheduler.Tick(now, recorder.Send()) == 1);
+    REQUIRE(recorder.payloads.back()[0] == 'p');
+    REQUIRE(scheduler.GetStats(now).waiting == 0);
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <chrono>
+
+#include "../src/public/send_rate_controller.h"
+
+using Catch::Matchers::WithinAbs;
+using std::chrono::milliseconds;
+
+namespace {
+SendRateController::Signals HealthyLink() {
+    SendRateController::Signals signals;
+    signals.smoothedRttMs = 60.0;
+    signals.rttVarMs = 5.0;
+    signals.minRttMs = 50.0;
+    signals.samples = 10;
+    return signals;
+}
+}
+
+TEST_CASE("SendRateController cuts the rate when RTT inflates") {
+    SendRateController controller;
+    auto now = SendRateController::Clock::time_point{} + milliseconds(10000);
+    REQUIRE(controller.IntervalMs() == 50);
+
+    REQUIRE_FALSE(controller.Update(HealthyLink(), now));
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(20.0, 1e-9));
+
+    auto queued = HealthyLink();
+    queued.smoothedRttMs = 400.0;
+    now += milliseconds(50);
+    REQUIRE(controller.Update(queued, now));
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(10.0, 1e-9));
+    REQUIRE(controller.IntervalMs() == 100);
+
+    // Only one cut per round trip
+    now += milliseconds(50);
+    REQUIRE_FALSE(controller.Update(queued, now));
+    now += milliseconds(400);
+    REQUIRE(controller.Update(queued, now));
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(5.0, 1e-9));
+
+    // Never below the floor
+    for (int i = 0; i < 10; ++i) {
+        now += milliseconds(500);
+        controller.Update(queued, now);
+    }
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(2.0, 1e-9));
+    REQUIRE(controller.Decreases() == 12);
+}
+
+TEST_CASE("SendRateController recovers additively once the link clears") {
+    SendRateController controller;
+    auto now = SendRateController::Clock::time_point{} + milliseconds(10000);
+
+    auto backlogged = HealthyLink();
+    backlogged.oldestPendingMs = 1500.0;
+    REQUIRE(controller.IsCongested(backlogged));
+    controller.Update(backlogged, now);
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(10.0, 1e-9));
+
+    // 2 Hz per second back up to the 20 Hz ceiling
+    now += milliseconds(1000);
+    controller.Update(HealthyLink(), now);
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(12.0, 1e-9));
+    now += milliseconds(10000);
+    controller.Update(HealthyLink(), now);
+    REQUIRE_THAT(controller.RateHz(), WithinAbs(20.0, 1e-9));
+}
+
+TEST_CASE("SendRateController ignores noise on fast links and empty estimates") {
+    SendRateController controller;
+
+    // Doubling a 10 ms RTT is not congestion
+    auto fast = HealthyLink();
+    fast.minRttMs = 10.0;
+    fast.smoothedRttMs = 30.0;
+    REQUIRE_FALSE(controller.IsCongested(fast));
+
+    // A probe in flight for less than the timeout is not a backlog
+    auto inFlight = HealthyLink();
+    inFlight.oldestPendingMs = 200.0;
+    REQUIRE_FALSE(controller.IsCongested(inFlight));
+
+    SendRateController::Signals none;
+    none.oldestPendingMs = 5000.0;
+    REQUIRE_FALSE(controller.IsCongested(none));
+
+    auto lossy = HealthyLink();
+    lossy.lossRate = 0.25;
+    REQUIRE(controller.IsCongested(lossy));
+}
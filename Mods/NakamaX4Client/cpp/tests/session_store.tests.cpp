@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "../src/public/session_store.h"
+
+TEST_CASE("SessionStore round-trips the last session") {
+    const std::string path = (std::filesystem::temp_directory_path() / "session_store.tests.dat").string();
+    SessionStore store(path);
+    store.Clear();
+    REQUIRE_FALSE(store.Load().has_value());
+
+    REQUIRE(store.Save({ "127.0.0.1:7350", "x4-player-1", "auth.jwt", "refresh.jwt" }));
+    auto loaded = store.Load();
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->server == "127.0.0.1:7350");
+    REQUIRE(loaded->deviceId == "x4-player-1");
+    REQUIRE(loaded->authToken == "auth.jwt");
+    REQUIRE(loaded->refreshToken == "refresh.jwt");
+
+    // Replaced, not appended
+    REQUIRE(store.Save({ "127.0.0.1:7350", "x4-player-2", "auth2", "refresh2" }));
+    REQUIRE(store.Load()->deviceId == "x4-player-2");
+
+    store.Clear();
+    REQUIRE_FALSE(std::filesystem::exists(path));
+}
+
+#ifdef _WIN32
+TEST_CASE("SessionStore keeps the tokens encrypted on disk") {
+    const std::string path = (std::filesystem::temp_directory_path() / "session_store.sealed.dat").string();
+    SessionStore store(path);
+    REQUIRE(store.Save({ "127.0.0.1:7350", "x4-player-1", "auth.jwt", "refresh.jwt" }));
+    {
+        std::ifstream in(path, std::ios::binary);
+        const std::string contents((std::istreambuf_iterator<char>(in)), {});
+        REQUIRE(contents.find("auth.jwt") == std::string::npos);
+        REQUIRE(contents.find("refresh.jwt") == std::string::npos);
+    }
+    REQUIRE(store.Load()->authToken == "auth.jwt");
+    store.Clear();
+}
+#endif
+
+TEST_CASE("SessionStore ignores foreign or incomplete files") {
+    const std::string path = (std::filesystem::temp_directory_path() / "session_store.foreign.dat").string();
+    SessionStore store(path);
+    {
+        std::ofstream out(path, std::ios::trunc);
+        out << "something else\ntoken=a\nrefresh=b\n";
+    }
+    REQUIRE_FALSE(store.Load().has_value());
+    {
+        std::ofstream out(path, std::ios::trunc);
+        out << "nakama-session 1\ntoken=a\n";
+    }
+    REQUIRE_FALSE(store.Load().has_value());
+    store.Clear();
+}
+
+TEST_CASE("SessionStore refreshes near the end of the session lifetime") {
+    constexpr std::uint64_t HOUR = 60 * 60 * 1000;
+    constexpr std::uint64_t YEAR = 365 * 24 * HOUR;
+
+    // A tenth of a long lifetime is left
+    REQUIRE(SessionStore::RefreshAtMs(0, YEAR) == YEAR - YEAR / 10);
+    // Short sessions keep at least the minimum margin
+    REQUIRE(SessionStore::RefreshAtMs(0, HOUR) == HOUR - SessionStore::MIN_REFRESH_MARGIN_MS);
+    // Shorter than the margin: refresh right away
+    REQUIRE(SessionStore::RefreshAtMs(1000, 61000) == 1000);
+    REQUIRE(SessionStore::RefreshAtMs(5000, 5000) == 5000);
+}
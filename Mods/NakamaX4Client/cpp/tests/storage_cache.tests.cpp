@@ -0,0 +1,183 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+#include "../src/public/storage_cache.h"
+
+using namespace std::chrono_literals;
+using Clock = StorageCache::Clock;
+
+TEST_CASE("StorageCache only flushes records whose fields changed") {
+    StorageCache cache;
+    const auto now = Clock::now();
+    REQUIRE(cache.NextFlushDeadline() == Clock::time_point::max());
+
+    REQUIRE(cache.Set("player_data", "alice", "credits", 100LL, now));
+    REQUIRE(cache.Set("player_data", "alice", "playtime", 5LL, now));
+    REQUIRE(cache.DirtyCount() == 1);
+    REQUIRE(cache.DirtyFields("player_data", "alice") == std::vector<std::string>{ "credits", "playtime" });
+
+    // Not due until the oldest change is flushDelay old
+    REQUIRE_FALSE(cache.ShouldFlush(now + 1s));
+    REQUIRE(cache.ShouldFlush(now + 2s));
+
+    auto batch = cache.TakeBatch();
+    REQUIRE(batch.size() == 1);
+    REQUIRE(batch[0].value == R"({"credits":100,"playtime":5})");
+    // Unknown version: written unconditionally
+    REQUIRE(batch[0].version.empty());
+    REQUIRE(cache.TakeBatch().empty());
+
+    cache.CompleteBatch({ { "player_data", "alice", "v1" } });
+    REQUIRE(cache.GetVersion("player_data", "alice") == "v1");
+    REQUIRE(cache.DirtyCount() == 0);
+
+    // Same values again: nothing to send
+    REQUIRE_FALSE(cache.Set("player_data", "alice", "credits", 100LL, now + 3s));
+    REQUIRE(cache.NextFlushDeadline() == Clock::time_point::max());
+
+    bool flushed = false;
+    cache.WhenFlushed([&flushed](bool success, const std::string&) { flushed = success; });
+    REQUIRE(flushed);
+
+    // The next write is conditional on the acknowledged version
+    REQUIRE(cache.Set("player_data", "alice", "credits", 150LL, now + 3s));
+    batch = cache.TakeBatch();
+    REQUIRE(batch[0].version == "v1");
+    REQUIRE(batch[0].value == R"({"credits":150,"playtime":5})");
+}
+
+TEST_CASE("StorageCache coalesces records into one batch at the threshold") {
+    StorageCache::Options options;
+    options.flushThreshold = 3;
+    StorageCache cache(options);
+    const auto now = Clock::now();
+
+    cache.Set("player_data", "a", "credits", 1LL, now);
+    cache.Set("player_data", "b", "credits", 2LL, now);
+    cache.Set("player_data", "a", "credits", 3LL, now);
+    REQUIRE_FALSE(cache.ShouldFlush(now));
+    cache.Set("settings", "c", "name", std::string("x"), now);
+    REQUIRE(cache.ShouldFlush(now));
+
+    const auto batch = cache.TakeBatch();
+    REQUIRE(batch.size() == 3);
+    REQUIRE(cache.IsFlushing());
+    // Nothing else goes out while the batch is in flight
+    cache.Set("player_data", "a", "credits", 4LL, now);
+    REQUIRE_FALSE(cache.ShouldFlush(now + 10s));
+
+    cache.CompleteBatch({});
+    REQUIRE(cache.ShouldFlush(now + 10s));
+    REQUIRE(cache.TakeBatch().size() == 1);
+}
+
+TEST_CASE("StorageCache waiters follow the batch that carries their data") {
+    StorageCache cache;
+    const auto now = Clock::now();
+    std::vector<std::string> results;
+    auto record = [&results](const std::string& name) {
+        return [&results, name](bool success, const std::string& error) {
+            results.push_back(name + (success ? ":ok" : ":" + error));
+        };
+    };
+
+    cache.Set("player_data", "alice", "credits", 1LL, now);
+    cache.WhenFlushed(record("first"));
+    cache.TakeBatch();
+    cache.Set("player_data", "alice", "credits", 2LL, now);
+    cache.WhenFlushed(record("second"));
+
+    // A conflict retries the same data right away and keeps the waiters
+    cache.FailBatch(true, "version conflict", now);
+    REQUIRE(results.empty());
+    REQUIRE(cache.DirtyCount() == 1);
+    REQUIRE(cache.ShouldFlush(now));
+    cache.SetVersion("player_data", "alice", "server");
+    auto batch = cache.TakeBatch();
+    REQUIRE(batch[0].version == "server");
+    REQUIRE(batch[0].value == R"({"credits":2})");
+
+    // Any other failure reports to the waiters and backs off
+    cache.FailBatch(false, "offline", now);
+    REQUIRE(results == std::vector<std::string>{ "first:offline", "second:offline" });
+    REQUIRE_FALSE(cache.ShouldFlush(now + 1s));
+    REQUIRE(cache.ShouldFlush(now + 5s));
+
+    cache.WhenFlushed(record("third"));
+    cache.TakeBatch();
+    cache.CompleteBatch({ { "player_data", "alice", "v2" } });
+    REQUIRE(results.back() == "third:ok");
+}
+
+TEST_CASE("StorageCache stops retrying repeated version conflicts at once") {
+    StorageCache::Options options;
+    options.maxConflictRetries = 2;
+    StorageCache cache(options);
+    const auto now = Clock::now();
+    std::vector<std::string> results;
+    cache.Set("player_data", "alice", "credits", 1LL, now);
+    cache.WhenFlushed([&results](bool success, const std::string& error) {
+        results.push_back(success ? "ok" : error);
+    });
+    cache.RequestFlush();
+    for (int retry = 0; retry < 2; ++retry) {
+        REQUIRE(cache.TakeBatch().size() == 1);
+        cache.FailBatch(true, "version conflict", now);
+        REQUIRE(cache.ShouldFlush(now));
+    }
+    REQUIRE(results.empty());
+
+    // One conflict too many fails the waiters and backs off
+    REQUIRE(cache.TakeBatch().size() == 1);
+    cache.FailBatch(true, "version conflict", now);
+    REQUIRE(results == std::vector<std::string>{ "version conflict" });
+    REQUIRE_FALSE(cache.ShouldFlush(now + 1s));
+    REQUIRE(cache.ShouldFlush(now + 5s));
+
+    // The count restarts after the back-off
+    REQUIRE(cache.TakeBatch().size() == 1);
+    cache.FailBatch(true, "version conflict", now + 5s);
+    REQUIRE(cache.ShouldFlush(now + 5s));
+}
+
+TEST_CASE("StorageCache requested flushes skip the delay") {
+    StorageCache cache;
+    const auto now = Clock::now();
+    cache.Set("player_data", "alice", "online", true, now);
+    REQUIRE_FALSE(cache.ShouldFlush(now));
+    cache.RequestFlush();
+    REQUIRE(cache.ShouldFlush(now));
+
+    cache.Clear();
+    REQUIRE(cache.DirtyCount() == 0);
+    REQUIRE_FALSE(cache.Get("player_data", "alice", "online").has_value());
+}
+
+TEST_CASE("StorageCache restores journaled records in bounded batches") {
+    StorageCache::Options options;
+    options.maxBatchSize = 2;
+    StorageCache cache(options);
+    const auto now = Clock::now();
+
+    REQUIRE(cache.Restore("player_data", "a", R"({"credits":7,"ratio":0.5,"online":true,"name":"A"})", now));
+    REQUIRE(cache.Restore("player_data", "b", R"({"credits":8})", now));
+    REQUIRE(cache.Restore("player_data", "c", R"({"credits":9})", now));
+    REQUIRE_FALSE(cache.Restore("player_data", "d", "not json", now));
+    REQUIRE(cache.Get("player_data", "a", "credits") == StorageCache::FieldValue(7LL));
+    REQUIRE(cache.Get("player_data", "a", "ratio") == StorageCache::FieldValue(0.5));
+    REQUIRE(cache.Value("player_data", "a") == R"({"credits":7,"name":"A","online":true,"ratio":0.5})");
+    REQUIRE(cache.DirtyCount() == 3);
+
+    bool flushed = false;
+    cache.WhenFlushed([&flushed](bool success, const std::string&) { flushed = success; });
+    cache.RequestFlush();
+    REQUIRE(cache.TakeBatch().size() == 2);
+    cache.CompleteBatch({});
+    REQUIRE_FALSE(flushed);
+    // The remainder is due at once
+    REQUIRE(cache.ShouldFlush(now));
+    REQUIRE(cache.TakeBatch().size() == 1);
+    cache.CompleteBatch({});
+    REQUIRE(flushed);
+}
@@ -0,0 +1,138 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../src/public/storage_journal.h"
+
+using namespace std::chrono_literals;
+using Clock = StorageJournal::Clock;
+
+namespace {
+// Fresh journal path in the temp directory, removed again on scope exit
+struct TempJournal
+{
+    std::string path;
+
+    explicit TempJournal(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {
+        std::filesystem::remove(path);
+    }
+    ~TempJournal() {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+};
+}
+
+TEST_CASE("StorageJournal replays unacknowledged writes after a restart") {
+    TempJournal temp("storage_journal_replay.journal");
+    const auto now = Clock::now();
+    {
+        StorageJournal journal;
+        REQUIRE(journal.Open(temp.path));
+        journal.Append("player_data", "alice", R"({"credits":1})", now);
+        journal.Append("player_data", "bob", R"({"credits":2})", now);
+        const auto latest = journal.Append("player_data", "alice", R"({"credits":3})", now);
+
+        // Buffered until the sync interval has passed
+        REQUIRE(journal.NextSyncDeadline() == now + 1s);
+        REQUIRE(journal.Sync(now + 500ms));
+        REQUIRE(journal.FileBytes() == 0);
+        REQUIRE(journal.Sync(now + 1s));
+        REQUIRE(journal.FileBytes() > 0);
+        REQUIRE(journal.NextSyncDeadline() == Clock::time_point::max());
+
+        journal.Acknowledge("player_data", "alice", latest);
+        REQUIRE(journal.Sync(now, true));
+    }
+
+    StorageJournal journal;
+    REQUIRE(journal.Open(temp.path));
+    const auto pending = journal.Pending();
+    REQUIRE(pending.size() == 1);
+    REQUIRE(pending[0].key == "bob");
+    REQUIRE(pending[0].value == R"({"credits":2})");
+    // Sequence numbers continue after the replayed ones
+    REQUIRE(journal.Append("player_data", "carol", "{}", now) == 4);
+}
+
+TEST_CASE("StorageJournal keeps a newer write when an older one is acknowledged") {
+    TempJournal temp("storage_journal_newer.journal");
+    StorageJournal journal;
+    REQUIRE(journal.Open(temp.path));
+    const auto now = Clock::now();
+
+    const auto sent = journal.Append("player_data", "alice", R"({"credits":1})", now);
+    journal.Append("player_data", "alice", R"({"credits":2})", now);
+    journal.Acknowledge("player_data", "alice", sent);
+    REQUIRE(journal.Pending().size() == 1);
+    REQUIRE(journal.Pending()[0].value == R"({"credits":2})");
+
+    // Acknowledging everything empties the file
+    REQUIRE(journal.Sync(now, true));
+    journal.Acknowledge("player_data", "alice", journal.LastSequence());
+    REQUIRE(journal.Pending().empty());
+    REQUIRE(journal.FileBytes() == 0);
+    REQUIRE(std::filesystem::file_size(temp.path) == 0);
+}
+
+TEST_CASE("StorageJournal cuts off a torn or corrupt tail") {
+    TempJournal temp("storage_journal_torn.journal");
+    const auto now = Clock::now();
+    std::uintmax_t validBytes = 0;
+    {
+        StorageJournal journal;
+        REQUIRE(journal.Open(temp.path));
+        journal.Append("player_data", "alice", R"({"credits":1})", now);
+        REQUIRE(journal.Sync(now, true));
+        validBytes = journal.FileBytes();
+        journal.Append("player_data", "bob", R"({"credits":2})", now);
+    }
+
+    // Flip a byte of the second record's value and add a partial header
+    {
+        std::fstream file(temp.path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-2, std::ios::end);
+        file.put('X');
+    }
+    {
+        std::ofstream file(temp.path, std::ios::app | std::ios::binary);
+        file.write("\x10\x00", 2);
+    }
+
+    StorageJournal journal;
+    REQUIRE(journal.Open(temp.path));
+    REQUIRE(journal.Pending().size() == 1);
+    REQUIRE(journal.Pending()[0].key == "alice");
+    REQUIRE(std::filesystem::file_size(temp.path) == validBytes);
+    REQUIRE(journal.FileBytes() == validBytes);
+}
+
+TEST_CASE("StorageJournal compacts once acknowledged records dominate") {
+    TempJournal temp("storage_journal_compact.journal");
+    StorageJournal::Options options;
+    options.compactBytes = 1024;
+    StorageJournal journal(options);
+    REQUIRE(journal.Open(temp.path));
+    const auto now = Clock::now();
+
+    journal.Append("player_data", "pinned", "{}", now);
+    const std::string value(64, 'x');
+    for (int i = 0; i < 20; ++i) {
+        const auto sequence = journal.Append("player_data", "alice", value, now);
+        REQUIRE(journal.Sync(now, true));
+        journal.Acknowledge("player_data", "alice", sequence);
+    }
+
+    // Only the pinned write is left in the rewritten file
+    REQUIRE(journal.FileBytes() < options.compactBytes);
+    REQUIRE(journal.Sync(now, true));
+    REQUIRE(std::filesystem::file_size(temp.path) == journal.FileBytes());
+    journal.Close();
+
+    REQUIRE(journal.Open(temp.path));
+    REQUIRE(journal.Pending().size() == 1);
+    REQUIRE(journal.Pending()[0].key == "pinned");
+    REQUIRE(StorageJournal::Crc32("123456789") == 0xCBF43926u);
+}
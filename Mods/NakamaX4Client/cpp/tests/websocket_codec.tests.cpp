@@ -0,0 +1,46 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "../src/public/websocket_codec.h"
+
+using WebsocketCodec::Opcode;
+
+TEST_CASE("WebsocketCodec handshake helpers match RFC test vectors") {
+    // RFC 6455 section 1.3
+    REQUIRE(WebsocketCodec::AcceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    const auto digest = WebsocketCodec::Sha1("abc");
+    REQUIRE(WebsocketCodec::Base64Encode(digest.data(), digest.size()) == "qZk+NkcGgWq6PiVxeFDCbJzQ2J0=");
+
+    const std::string response = "HTTP/1.1 101 Switching Protocols\r\nupgrade: websocket\r\n"
+        "sec-websocket-accept:  s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n\r\n";
+    REQUIRE(WebsocketCodec::ValidateHandshakeResponse(response, "dGhlIHNhbXBsZSBub25jZQ=="));
+    REQUIRE_FALSE(WebsocketCodec::ValidateHandshakeResponse(response, "AAAAAAAAAAAAAAAAAAAAAA=="));
+    REQUIRE_FALSE(WebsocketCodec::ValidateHandshakeResponse("HTTP/1.1 401 Unauthorized\r\n\r\n", "x"));
+}
+
+TEST_CASE("WebsocketCodec frames round-trip at every length encoding") {
+    const WebsocketCodec::MaskKey mask{ 0x11, 0x22, 0x33, 0x44 };
+    for (size_t size : { size_t(0), size_t(5), size_t(125), size_t(126), size_t(300), size_t(70000) }) {
+        const std::string payload(size, 'x');
+        std::string wire;
+        WebsocketCodec::AppendFrame(wire, Opcode::Binary, payload, true, &mask);
+
+        WebsocketCodec::Frame frame;
+        REQUIRE(WebsocketCodec::ParseFrame(wire.data(), wire.size() - 1, 1 << 20, frame) ==
+            WebsocketCodec::ParseResult::NeedMore);
+        REQUIRE(WebsocketCodec::ParseFrame(wire.data(), wire.size(), 1 << 20, frame) ==
+            WebsocketCodec::ParseResult::Complete);
+        REQUIRE(frame.opcode == Opcode::Binary);
+        REQUIRE(frame.fin);
+        REQUIRE(frame.frameSize == wire.size());
+        REQUIRE(frame.payload == payload);
+    }
+
+    // Control frames may not be fragmented or carry more than 125 bytes
+    std::string ping;
+    WebsocketCodec::AppendFrame(ping, Opcode::Ping, std::string(126, 'p'), true, nullptr);
+    WebsocketCodec::Frame frame;
+    REQUIRE(WebsocketCodec::ParseFrame(ping.data(), ping.size(), 1 << 20, frame) ==
+        WebsocketCodec::ParseResult::Error);
+}
@@ -10,6 +10,9 @@ nk.logger_info("=== X4 Nakama Mod - Initializing Lua Runtime ===")
 nk.register_rpc(sector_rpc.get_sector_match_id, "get_sector_match_id")
 nk.logger_info("✓ Registered RPC: get_sector_match_id")
 
+nk.register_rpc(sector_rpc.get_sector_match_ids, "get_sector_match_ids")
+nk.logger_info("✓ Registered RPC: get_sector_match_ids")
+
 nk.register_rpc(sector_rpc.list_sector_matches, "list_sector_matches")
 nk.logger_info("✓ Registered RPC: list_sector_matches")
 
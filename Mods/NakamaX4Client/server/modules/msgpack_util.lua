@@ -0,0 +1,174 @@
+-- MessagePack helpers
+-- Minimal encoders for building aggregated match messages around payloads
+-- that clients already packed with MessagePack. Payloads are embedded as-is;
+-- the only thing ever decoded from them is the sender's position.
+local M = {}
+
+local function byte_at(n, shift)
+    return math.floor(n / shift) % 256
+end
+
+-- Encode an unsigned integer (up to 32 bits)
+function M.uint(n)
+    if n < 128 then
+        return string.char(n)
+    elseif n < 256 then
+        return string.char(0xcc, n)
+    elseif n < 65536 then
+        return string.char(0xcd, byte_at(n, 256), n % 256)
+    end
+    return string.char(0xce, byte_at(n, 16777216), byte_at(n, 65536), byte_at(n, 256), n % 256)
+end
+
+-- Encode an array header for n elements; the elements follow directly
+function M.array_header(n)
+    if n < 16 then
+        return string.char(0x90 + n)
+    elseif n < 65536 then
+        return string.char(0xdc, byte_at(n, 256), n % 256)
+    end
+    return string.char(0xdd, byte_at(n, 16777216), byte_at(n, 65536), byte_at(n, 256), n % 256)
+end
+
+-- Encode a state snapshot: [tick, [[op_code, payload], ...]]
+-- entries is an array of { op_code = number, data = packed payload string }
+function M.snapshot(tick, entries)
+    local parts = { M.array_header(2), M.uint(tick), M.array_header(#entries) }
+    for _, entry in ipairs(entries) do
+        table.insert(parts, M.array_header(2) .. M.uint(entry.op_code) .. entry.data)
+    end
+    return table.concat(parts)
+end
+
+-- Decoding: just enough to read the position out of a client payload
+
+local function be_uint(data, pos, n)
+    local value = 0
+    for i = 0, n - 1 do
+        value = value * 256 + data:byte(pos + i)
+    end
+    return value
+end
+
+-- Read the number at pos; returns value, next position (nil if not a number)
+local function read_number(data, pos)
+    local tag = data:byte(pos)
+    if tag == nil then
+        return nil
+    elseif tag < 0x80 then
+        return tag, pos + 1
+    elseif tag >= 0xe0 then
+        return tag - 256, pos + 1
+    end
+
+    local sizes = { [0xca] = 4, [0xcb] = 8, [0xcc] = 1, [0xcd] = 2, [0xce] = 4, [0xcf] = 8,
+        [0xd0] = 1, [0xd1] = 2, [0xd2] = 4, [0xd3] = 8 }
+    local n = sizes[tag]
+    if n == nil or #data < pos + n then
+        return nil
+    end
+
+    local value
+    if tag == 0xca then
+        local bits = be_uint(data, pos + 1, 4)
+        local exponent = math.floor(bits / 8388608) % 256
+        local mantissa = bits % 8388608
+        if exponent == 255 then
+            return nil
+        elseif exponent == 0 then
+            value = math.ldexp(mantissa, -149)
+        else
+            value = math.ldexp(mantissa + 8388608, exponent - 150)
+        end
+        if bits >= 2147483648 then
+            value = -value
+        end
+    elseif tag == 0xcb then
+        local high = be_uint(data, pos + 1, 4)
+        local low = be_uint(data, pos + 5, 4)
+        local exponent = math.floor(high / 1048576) % 2048
+        local mantissa = (high % 1048576) * 4294967296 + low
+        if exponent == 2047 then
+            return nil
+        elseif exponent == 0 then
+            value = math.ldexp(mantissa, -1074)
+        else
+            value = math.ldexp(mantissa + 4503599627370496, exponent - 1075)
+        end
+        if high >= 2147483648 then
+            value = -value
+        end
+    else
+        value = be_uint(data, pos + 1, n)
+        if tag >= 0xd0 and value >= 2 ^ (8 * n - 1) then
+            value = value - 2 ^ (8 * n)
+        end
+    end
+    return value, pos + 1 + n
+end
+
+-- Read an array header at pos; returns element count, next position
+local function read_array_header(data, pos)
+    local tag = data:byte(pos)
+    if tag == nil then
+        return nil
+    elseif tag >= 0x90 and tag <= 0x9f then
+        return tag - 0x90, pos + 1
+    elseif tag == 0xdc and #data >= pos + 2 then
+        return be_uint(data, pos + 1, 2), pos + 3
+    elseif tag == 0xdd and #data >= pos + 4 then
+        return be_uint(data, pos + 1, 4), pos + 5
+    end
+    return nil
+end
+
+-- Skip the string at pos; returns the next position
+local function skip_string(data, pos)
+    local tag = data:byte(pos)
+    local length, header
+    if tag == nil then
+        return nil
+    elseif tag >= 0xa0 and tag <= 0xbf then
+        length, header = tag - 0xa0, 1
+    elseif tag == 0xd9 and #data >= pos + 1 then
+        length, header = be_uint(data, pos + 1, 1), 2
+    elseif tag == 0xda and #data >= pos + 2 then
+        length, header = be_uint(data, pos + 1, 2), 3
+    elseif tag == 0xdb and #data >= pos + 4 then
+        length, header = be_uint(data, pos + 1, 4), 5
+    else
+        return nil
+    end
+    if #data < pos + header + length - 1 then
+        return nil
+    end
+    return pos + header + length
+end
+
+-- Position {x, y, z} of a PositionUpdate or FleetUpdate payload, both of
+-- which start [player_id, position, ...]. Returns nil if malformed.
+function M.read_position(data)
+    local fields, pos = read_array_header(data, 1)
+    if fields == nil or fields < 2 then
+        return nil
+    end
+    pos = skip_string(data, pos)
+    if pos == nil then
+        return nil
+    end
+    local count
+    count, pos = read_array_header(data, pos)
+    if count == nil or count < 3 then
+        return nil
+    end
+    local position = {}
+    for i = 1, 3 do
+        position[i], pos = read_number(data, pos)
+        if position[i] == nil then
+            return nil
+        end
+    end
+    return position
+end
+
+return M
@@ -1,35 +1,81 @@
 -- Sector Match Handler
 -- Manages realtime multiplayer matches for X4 sectors
 local nk = require("nakama")
+local msgpack = require("msgpack_util")
+local registry = require("sector_registry")
 
 local M = {}
 
+-- Base tick rate, the fastest a crowded shard snapshots. Nakama fixes it when
+-- the match starts, so quieter matches run their work only every
+-- snapshot_interval ticks (see OCCUPANCY_TIERS) and return at once otherwise.
+local TICK_RATE = 20
+
 -- Match termination constants
-local MATCH_TERMINATION_TICKS = 600  -- 60 seconds at 10 ticks/sec
+local MATCH_TERMINATION_TICKS = 60 * TICK_RATE  -- 60 seconds
+
+-- Processing interval (in ticks) by number of players, checked top to bottom.
+-- Crowded shards snapshot at the full rate so nearby ships stay smooth; empty
+-- and lone-player matches only drain messages and track the grace period.
+local OCCUPANCY_TIERS = {
+    { min_players = 8, interval = 1 },   -- 20 Hz
+    { min_players = 2, interval = 2 },   -- 10 Hz
+    { min_players = 0, interval = 20 },  -- 1 Hz (empty or lone player)
+}
+
+-- Match data opcodes (keep in sync with cpp/src/public/match_opcodes.h)
+local OP_POSITION = 1
+local OP_FLEET = 2
+local OP_SNAPSHOT = 3   -- server -> client: [tick, [[op_code, payload], ...]]
+local OP_FULL_SNAPSHOT = 4  -- server -> joiner: same layout, every known presence
+local OP_SHARD_GHOSTS = 5   -- server -> client: sibling shard state, same layout
+local OP_PING = 6           -- client -> server: link probe, echoed back untouched
+local OP_PONG = 7           -- server -> sender: echo of an OP_PING
+
+-- Cross-shard exchange: each shard publishes the last known states of its
+-- players near a shard border to the local cache at a low rate and relays
+-- its siblings' to its players, so players near a border still see each
+-- other (coarsely). Shards without an anchor have no border and publish
+-- nothing.
+local CROSS_SHARD_INTERVAL_TICKS = 2 * TICK_RATE  -- every 2 seconds
+local GHOST_CACHE_PREFIX = "shard_ghosts:"
+local GHOST_TTL_SEC = 5
+local GHOST_BORDER_RADIUS = 5000  -- metres from the border between two anchors
+
+-- Helpers, defined below the match callbacks
+local exchange_shard_ghosts, near_border, update_snapshot_interval
 
 -- Called when match is created
 function M.match_init(context, setupstate)
     local sector = "unknown"
+    local shard = 0
     
-    -- Extract sector name from setupstate metadata
+    -- Extract sector name and shard from setupstate metadata
     if setupstate and setupstate.sector then
         sector = setupstate.sector
     end
+    if setupstate and setupstate.shard then
+        shard = setupstate.shard
+    end
     
     local state = {
         presences = {},
+        presence_count = 0,  -- maintained incrementally in match_join/match_leave
+        snapshot_interval = OCCUPANCY_TIERS[#OCCUPANCY_TIERS].interval,
         sector = sector,
-        label = "sector:" .. sector,
+        shard = shard,
+        label = registry.shard_label(sector, shard),
+        pending = {},      -- latest state per presence received this tick
+        last_state = {},   -- last known state per presence, for late joiners
         tick_count = 0,
         created_at = nk.time()
     }
     
-    local tick_rate = 10 -- 10 ticks per second (100ms)
     local label = state.label
     
-    nk.logger_info(string.format("Match initialized for sector: %s", sector))
+    nk.logger_info(string.format("Match initialized for sector: %s (shard %d)", sector, shard))
     
-    return state, tick_rate, label
+    return state, TICK_RATE, label
 end
 
 -- Called when a player attempts to join
@@ -44,17 +90,26 @@ end
 -- Called when player(s) successfully join
 function M.match_join(context, dispatcher, tick, state, presences)
     for _, presence in ipairs(presences) do
+        if state.presences[presence.session_id] == nil then
+            state.presence_count = state.presence_count + 1
+        end
         state.presences[presence.session_id] = presence
         
         nk.logger_info(string.format("Player %s (username: %s) joined sector %s match. Total players: %d", 
             presence.user_id, 
             presence.username,
             state.sector,
-            table_count(state.presences)))
-        
-        -- Send welcome message to the joining player
-        local welcome_msg = string.format("Welcome to sector %s", state.sector)
-        dispatcher.broadcast_message(1, welcome_msg, {presence})
+            state.presence_count))
+    end
+    update_snapshot_interval(state)
+
+    -- Bring the joiners up to date with everyone already in the sector
+    local entries = {}
+    for _, entry in pairs(state.last_state) do
+        table.insert(entries, entry)
+    end
+    if #entries > 0 then
+        dispatcher.broadcast_message(OP_FULL_SNAPSHOT, msgpack.snapshot(tick, entries), presences)
     end
     
     return state
@@ -63,45 +118,90 @@ end
 -- Called when player(s) leave
 function M.match_leave(context, dispatcher, tick, state, presences)
     for _, presence in ipairs(presences) do
+        if state.presences[presence.session_id] ~= nil then
+            state.presence_count = state.presence_count - 1
+        end
         state.presences[presence.session_id] = nil
+        state.pending[presence.session_id] = nil
+        state.last_state[presence.session_id] = nil
         
         nk.logger_info(string.format("Player %s left sector %s match. Remaining players: %d", 
             presence.user_id,
             state.sector,
-            table_count(state.presences)))
+            state.presence_count))
     end
+    update_snapshot_interval(state)
     
     return state
 end
 
--- Called every tick (10 times per second)
+-- Called every tick (TICK_RATE times per second)
 function M.match_loop(context, dispatcher, tick, state, messages)
     state.tick_count = state.tick_count + 1
     
-    -- Process incoming messages (position updates, etc.)
+    -- Lost the registration race for this sector; nobody can find us.
+    -- Nakama skips match_terminate when match_loop returns nil, so the
+    -- registry entry is dropped here.
+    if state.discarded then
+        registry.evict(state.sector, context.match_id)
+        return nil
+    end
+    
+    -- Empty match: only the termination grace period needs tracking
+    if state.presence_count == 0 then
+        if state.empty_since == nil then
+            state.empty_since = tick
+        elseif (tick - state.empty_since) > MATCH_TERMINATION_TICKS then
+            nk.logger_info(string.format("Terminating empty match for sector %s", state.sector))
+            registry.evict(state.sector, context.match_id)
+            return nil  -- Terminate the match
+        end
+        return state
+    end
+    state.empty_since = nil
+    
+    -- Process incoming messages: keep only the latest state per presence.
+    -- Messages are drained every tick even when no snapshot goes out.
     for _, message in ipairs(messages) do
-        -- OpCode 1 = position update
-        if message.op_code == 1 then
-            -- Broadcast position update to all other players (not sender)
-            dispatcher.broadcast_message(message.op_code, message.data, nil, message.sender)
+        if message.op_code == OP_POSITION or message.op_code == OP_FLEET then
+            local entry = {
+                op_code = message.op_code,
+                data = message.data
+            }
+            state.pending[message.sender.session_id] = entry
+            state.last_state[message.sender.session_id] = entry
+        elseif message.op_code == OP_PING then
+            -- Echo immediately, outside the snapshot cadence, so the client
+            -- measures the link plus at most one tick
+            dispatcher.broadcast_message(OP_PONG, message.data, { message.sender })
         else
             -- Unknown message type - log it
             nk.logger_warn(string.format("Unknown message opcode %d from %s", 
                 message.op_code, message.sender.user_id))
         end
     end
-    
-    -- Check if match is empty - terminate after grace period
-    if table_count(state.presences) == 0 then
-        if state.empty_since == nil then
-            state.empty_since = tick
-        elseif (tick - state.empty_since) > MATCH_TERMINATION_TICKS then -- 60 seconds at 10 ticks/sec
-            nk.logger_info(string.format("Terminating empty match for sector %s", state.sector))
-            return nil  -- Terminate the match
+
+    if tick % CROSS_SHARD_INTERVAL_TICKS == 0 then
+        exchange_shard_ghosts(context, dispatcher, tick, state)
+    end
+
+    if tick % state.snapshot_interval ~= 0 then
+        return state
+    end
+
+    -- Broadcast one aggregated snapshot instead of one message per sender.
+    -- Senders receive their own entry back; clients ignore updates for themselves.
+    -- A lone player has nobody to receive it.
+    if state.presence_count > 1 then
+        local entries = {}
+        for _, entry in pairs(state.pending) do
+            table.insert(entries, entry)
+        end
+        if #entries > 0 then
+            dispatcher.broadcast_message(OP_SNAPSHOT, msgpack.snapshot(tick, entries))
         end
-    else
-        state.empty_since = nil
     end
+    state.pending = {}
     
     return state
 end
@@ -110,6 +210,9 @@ end
 function M.match_terminate(context, dispatcher, tick, state, grace_seconds)
     nk.logger_info(string.format("Match terminating for sector %s (ran for %d ticks)", 
         state.sector, state.tick_count))
+    if not state.discarded then
+        registry.evict(state.sector, context.match_id)
+    end
     return state
 end
 
@@ -118,16 +221,72 @@ function M.match_signal(context, dispatcher, tick, state, data)
     -- Handle external signals to the match (e.g., from nk.match_signal calls)
     nk.logger_info(string.format("Match signal received for sector %s: %s", 
         state.sector, data))
+    if data == registry.DISCARD_SIGNAL then
+        state.discarded = true
+    end
     return state, "signal_received"
 end
 
--- Helper function to count table entries
-function table_count(t)
-    local count = 0
-    for _ in pairs(t) do
-        count = count + 1
+-- Publish our state for sibling shards and relay theirs to our players
+exchange_shard_ghosts = function(context, dispatcher, tick, state)
+    local shards = registry.shards(state.sector)
+    if #shards < 2 then
+        return
+    end
+
+    local own
+    for _, shard in ipairs(shards) do
+        if shard.match_id == context.match_id then
+            own = shard
+        end
+    end
+
+    local entries = {}
+    if own ~= nil and own.anchor ~= nil then
+        for _, entry in pairs(state.last_state) do
+            local position = msgpack.read_position(entry.data)
+            if position ~= nil and near_border(position, own, shards) then
+                table.insert(entries, entry)
+            end
+        end
+    end
+    local key = GHOST_CACHE_PREFIX .. context.match_id
+    if #entries > 0 then
+        nk.localcache_put(key, msgpack.snapshot(tick, entries), GHOST_TTL_SEC)
+    else
+        nk.localcache_delete(key)
+    end
+
+    for _, shard in ipairs(shards) do
+        if shard.match_id ~= context.match_id then
+            local ghosts = nk.localcache_get(GHOST_CACHE_PREFIX .. shard.match_id)
+            if ghosts ~= nil and ghosts ~= "" then
+                dispatcher.broadcast_message(OP_SHARD_GHOSTS, ghosts)
+            end
+        end
+    end
+end
+
+-- Whether position lies within GHOST_BORDER_RADIUS of the border between
+-- own and any sibling shard with an anchor
+near_border = function(position, own, shards)
+    for _, shard in ipairs(shards) do
+        if shard.match_id ~= own.match_id and shard.anchor ~= nil and
+            registry.border_distance(position, own.anchor, shard.anchor) <= GHOST_BORDER_RADIUS then
+            return true
+        end
+    end
+    return false
+end
+
+-- Pick the snapshot interval for the current occupancy
+update_snapshot_interval = function(state)
+    for _, tier in ipairs(OCCUPANCY_TIERS) do
+        if state.presence_count >= tier.min_players then
+            state.snapshot_interval = tier.interval
+            return
+        end
     end
-    return count
 end
 
 return M
@@ -0,0 +1,258 @@
+-- Sector Registry
+-- Maps sector name -> list of authoritative match shards.
+-- Lookups hit the runtime local cache first; the storage engine is the source
+-- of truth and its conditional writes (version "*" or the last read version)
+-- make registration atomic, so concurrent joiners cannot end up with
+-- duplicate shards for a sector.
+local nk = require("nakama")
+
+local M = {}
+
+local COLLECTION = "sector_registry"
+local CACHE_PREFIX = "sector_match:"
+local MATCH_MODULE = "sector_match_handler"
+local MAX_REGISTER_ATTEMPTS = 3
+
+-- Players per shard before new joiners are routed to another shard.
+-- Override with the SECTOR_SHARD_CAPACITY runtime env variable.
+M.DEFAULT_SHARD_CAPACITY = 40
+
+-- Signal sent to a match that lost the registration race
+M.DISCARD_SIGNAL = "discard"
+
+local function cache_key(sector)
+    return CACHE_PREFIX .. sector
+end
+
+-- Match label for a shard; shard 0 keeps the historical "sector:<name>" label
+function M.shard_label(sector, shard)
+    if shard == 0 then
+        return "sector:" .. sector
+    end
+    return string.format("sector:%s#%d", sector, shard)
+end
+
+-- Read the registry record for a sector: returns shards, version (or {}, nil)
+-- Each shard is { match_id = "...", shard = n, anchor = {x, y, z} | nil }
+local function read_record(sector)
+    local objects = nk.storage_read({
+        { collection = COLLECTION, key = sector, user_id = nil }
+    })
+    if #objects == 0 or objects[1].value == nil or objects[1].value.shards == nil then
+        return {}, nil
+    end
+    return objects[1].value.shards, objects[1].version
+end
+
+-- Conditional write: version "*" only succeeds if no record exists,
+-- otherwise the write only succeeds if the record is unchanged
+local function write_record(sector, shards, version)
+    return pcall(nk.storage_write, {
+        {
+            collection = COLLECTION,
+            key = sector,
+            user_id = nil,
+            value = { shards = shards },
+            version = version or "*",
+            permission_read = 0,
+            permission_write = 0
+        }
+    })
+end
+
+local function cache_shards(sector, shards)
+    nk.localcache_put(cache_key(sector), nk.json_encode(shards), 0)
+end
+
+-- Shards whose match is still running, each with its population in `size`.
+-- Also returns whether any shard was dropped.
+local function live_shards(shards)
+    local live = {}
+    for _, shard in ipairs(shards) do
+        local match = nk.match_get(shard.match_id)
+        if match ~= nil then
+            shard.size = match.size
+            table.insert(live, shard)
+        end
+    end
+    return live, #live < #shards
+end
+
+-- Live shards for a sector, cache first. Each returned shard carries the
+-- current population in `size`. A cached list naming a dead match is
+-- discarded and re-read from storage, so a stale entry is never handed out.
+function M.shards(sector)
+    local cached = nk.localcache_get(cache_key(sector))
+    if cached ~= nil and cached ~= "" then
+        local live, stale = live_shards(nk.json_decode(cached))
+        if not stale then
+            return live
+        end
+        nk.localcache_delete(cache_key(sector))
+    end
+
+    local shards = read_record(sector)
+    local live = live_shards(shards)
+    if #live > 0 then
+        cache_shards(sector, live)
+    end
+    return live
+end
+
+local function distance_sq(a, b)
+    local sum = 0
+    for i = 1, 3 do
+        local d = (a[i] or 0) - (b[i] or 0)
+        sum = sum + d * d
+    end
+    return sum
+end
+
+-- Distance from position to the plane halfway between a shard's anchor and a
+-- sibling's anchor, i.e. to the border between the two shards
+function M.border_distance(position, anchor, sibling_anchor)
+    local span = math.sqrt(distance_sq(anchor, sibling_anchor))
+    if span == 0 then
+        return 0
+    end
+    return (distance_sq(position, sibling_anchor) - distance_sq(position, anchor)) / (2 * span)
+end
+
+-- Pick the shard with room whose anchor is closest to the hint. Shards
+-- without a known distance rank after those with one; ties go to the lowest
+-- shard index.
+local function choose_shard(shards, hint, capacity)
+    local best, best_distance
+    for _, shard in ipairs(shards) do
+        if shard.size < capacity then
+            local distance = math.huge
+            if hint ~= nil and shard.anchor ~= nil then
+                distance = distance_sq(hint, shard.anchor)
+            end
+            if best == nil or distance < best_distance or
+                (distance == best_distance and shard.shard < best.shard) then
+                best, best_distance = shard, distance
+            end
+        end
+    end
+    return best
+end
+
+-- Resolve a sector to the first shard's match ID without creating one.
+-- Returns match_id or nil.
+function M.lookup(sector)
+    local shards = M.shards(sector)
+    if #shards == 0 then
+        return nil
+    end
+    table.sort(shards, function(a, b) return a.shard < b.shard end)
+    return shards[1].match_id
+end
+
+-- Resolve a sector to a shard with room, creating and registering a new
+-- shard if all are full. hint is an optional {x, y, z} position used to pick
+-- the nearest shard.
+-- Returns match_id, shard, created
+function M.get_or_create(sector, hint, capacity)
+    capacity = capacity or M.DEFAULT_SHARD_CAPACITY
+
+    local shard = choose_shard(M.shards(sector), hint, capacity)
+    if shard ~= nil then
+        return shard.match_id, shard.shard, false
+    end
+
+    for _ = 1, MAX_REGISTER_ATTEMPTS do
+        -- Re-read the authoritative record; drop shards whose match is gone
+        local recorded, version = read_record(sector)
+        local shards = {}
+        local next_shard = 0
+        for _, existing in ipairs(recorded) do
+            local match = nk.match_get(existing.match_id)
+            if match ~= nil then
+                existing.size = match.size
+                table.insert(shards, existing)
+                next_shard = math.max(next_shard, existing.shard + 1)
+            end
+        end
+
+        -- Someone else may have added room since our cached view
+        shard = choose_shard(shards, hint, capacity)
+        if shard ~= nil then
+            cache_shards(sector, shards)
+            return shard.match_id, shard.shard, false
+        end
+
+        local match_id = nk.match_create(MATCH_MODULE, { sector = sector, shard = next_shard })
+        table.insert(shards, { match_id = match_id, shard = next_shard, anchor = hint })
+        for _, s in ipairs(shards) do
+            s.size = nil
+        end
+
+        if write_record(sector, shards, version) then
+            cache_shards(sector, shards)
+            nk.logger_info(string.format("Registered match %s as shard %d of sector %s",
+                match_id, next_shard, sector))
+            return match_id, next_shard, true
+        end
+
+        -- Lost the race: drop our match and retry against the new record
+        nk.match_signal(match_id, M.DISCARD_SIGNAL)
+        nk.localcache_delete(cache_key(sector))
+    end
+
+    nk.logger_warn(string.format("Could not register a shard for sector %s", sector))
+    return nil, nil, false
+end
+
+-- Resolve many sectors in one pass. Returns { [sector] = match_id }.
+-- Sectors without a live match are omitted unless create is true; new
+-- shards then hold up to capacity players (DEFAULT_SHARD_CAPACITY if nil).
+function M.lookup_many(sectors, create, capacity)
+    local result = {}
+    for _, sector in ipairs(sectors) do
+        local match_id
+        if create then
+            match_id = M.get_or_create(sector, nil, capacity)
+        else
+            match_id = M.lookup(sector)
+        end
+        if match_id ~= nil then
+            result[sector] = match_id
+        end
+    end
+    return result
+end
+
+-- Remove a shard's registration. Called when a match ends, from
+-- match_terminate or before match_loop returns nil.
+function M.evict(sector, match_id)
+    nk.localcache_delete(cache_key(sector))
+
+    for _ = 1, MAX_REGISTER_ATTEMPTS do
+        local shards, version = read_record(sector)
+        local remaining = {}
+        for _, shard in ipairs(shards) do
+            if shard.match_id ~= match_id then
+                table.insert(remaining, shard)
+            end
+        end
+        if #remaining == #shards then
+            return
+        end
+
+        local ok
+        if #remaining == 0 then
+            ok = pcall(nk.storage_delete, {
+                { collection = COLLECTION, key = sector, user_id = nil, version = version }
+            })
+        else
+            ok = write_record(sector, remaining, version)
+        end
+        if ok then
+            nk.logger_info(string.format("Evicted match %s from sector %s", match_id, sector))
+            return
+        end
+    end
+end
+
+return M
@@ -1,12 +1,30 @@
 -- Sector RPC Functions
 -- Provides RPC endpoints for sector match management
 local nk = require("nakama")
+local registry = require("sector_registry")
 
 local M = {}
 
+-- Responses to get_sector_match_id by user and request_key, so a client
+-- retrying a request (e.g. over HTTP after a socket timeout) gets the same
+-- match back and nobody else can read it
+local REQUEST_CACHE_PREFIX = "match_request:"
+local REQUEST_CACHE_TTL_SEC = 60
+
+-- Shard capacity from the runtime env (runtime.env in local.yml), if set
+local function shard_capacity(context)
+    local value = context.env and tonumber(context.env["SECTOR_SHARD_CAPACITY"])
+    return value or registry.DEFAULT_SHARD_CAPACITY
+end
+
 -- RPC: Get or create a sector match ID
--- Payload: { "sector": "SectorName" }
--- Returns: { "match_id": "uuid" }
+-- Crowded sectors are split into shards; the position hint picks the
+-- nearest shard with room. Repeating a request_key within
+-- REQUEST_CACHE_TTL_SEC returns the first response unchanged; the key is
+-- ignored for calls without a user (e.g. server-to-server).
+-- Payload: { "sector": "SectorName", "position": [x, y, z] (optional),
+--            "request_key": "..." (optional) }
+-- Returns: { "match_id": "uuid", "shard": n, "created": bool }
 function M.get_sector_match_id(context, payload)
     -- Parse the payload
     local data = nk.json_decode(payload)
@@ -16,50 +34,56 @@ function M.get_sector_match_id(context, payload)
     end
     
     local sector = data.sector
-    local label = "sector:" .. sector
     
     nk.logger_info(string.format("RPC get_sector_match_id called for sector: %s", sector))
     
-    -- Search for existing match with this sector label
-    local min_size = nil
-    local max_size = nil
-    local limit = 1
-    local authoritative = true
-    local query = nil
+    local request_cache_key = nil
+    if type(data.request_key) == "string" and data.request_key ~= ""
+        and context.user_id ~= nil and context.user_id ~= "" then
+        request_cache_key = REQUEST_CACHE_PREFIX .. context.user_id .. ":" .. data.request_key
+        local cached = nk.localcache_get(request_cache_key)
+        if cached ~= nil and cached ~= "" then
+            return cached
+        end
+    end
     
-    local matches = nk.match_list(limit, authoritative, label, min_size, max_size, query)
+    local hint = nil
+    if type(data.position) == "table" and #data.position == 3 then
+        hint = data.position
+    end
     
-    if #matches > 0 then
-        -- Found existing match
-        local match = matches[1]
-        nk.logger_info(string.format("Found existing match for sector %s: %s (players: %d)", 
-            sector, match.match_id, match.size))
-        
-        return nk.json_encode({
-            match_id = match.match_id,
-            size = match.size,
-            created = false
-        })
-    else
-        -- No match found, create a new one
-        nk.logger_info(string.format("No match found for sector %s, creating new match", sector))
-        
-        -- Create match with sector metadata
-        local module_name = "sector_match_handler"
-        local setupstate = {
-            sector = sector
-        }
-        
-        local match_id = nk.match_create(module_name, setupstate)
-        
-        nk.logger_info(string.format("Created new match for sector %s: %s", sector, match_id))
-        
-        return nk.json_encode({
-            match_id = match_id,
-            size = 0,
-            created = true
-        })
+    local match_id, shard, created = registry.get_or_create(sector, hint, shard_capacity(context))
+    if match_id == nil then
+        error("could not resolve a match for sector " .. sector)
+    end
+    
+    local response = nk.json_encode({
+        match_id = match_id,
+        shard = shard,
+        created = created
+    })
+    if request_cache_key ~= nil then
+        nk.localcache_put(request_cache_key, response, REQUEST_CACHE_TTL_SEC)
     end
+    return response
+end
+
+-- RPC: Resolve many sectors in one call
+-- Payload: { "sectors": ["SectorA", "SectorB"], "create": false }
+-- Returns: { "matches": { "SectorA": "uuid", ... } }
+-- Sectors without a live match are omitted unless "create" is true.
+function M.get_sector_match_ids(context, payload)
+    local data = nk.json_decode(payload)
+    
+    if type(data.sectors) ~= "table" then
+        error("sectors parameter is required")
+    end
+    
+    local matches = registry.lookup_many(data.sectors, data.create == true, shard_capacity(context))
+    
+    return nk.json_encode({
+        matches = matches
+    })
 end
 
 -- RPC: List all active sector matches
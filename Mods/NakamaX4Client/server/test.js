@@ -20,6 +20,13 @@ async function test() {
     console.log('📡 Testing Lua RPC: get_sector_match_id...');
     const matchResponse = await client.rpc(session, 'get_sector_match_id', { sector: 'TestSector' });
     const matchId = matchResponse.payload.match_id;
+
+    console.log('📡 Testing Lua RPC: get_sector_match_ids...');
+    const bulkResponse = await client.rpc(session, 'get_sector_match_ids', { sectors: ['TestSector', 'UnknownSector'] });
+    if (bulkResponse.payload.matches.TestSector !== matchId) {
+      throw new Error('Registry returned a different match for TestSector');
+    }
+    console.log('✅ Registry resolved', Object.keys(bulkResponse.payload.matches).length, 'sector(s)');
     
     console.log('🎮 Joining match:', matchId);
     const match = await socket.joinMatch(matchId);
@@ -43,6 +43,10 @@ end
 local L = {
     -- Any command arguments not yet processed.
     queued_args = {},
+    -- "threaded": network I/O on the DLL's own thread, results applied in Pump.
+    -- "frame": Pump does the network I/O too, on this thread.
+    execution_mode = "threaded",
+    pump_registered = false,
     -- Status tracking
     initialized = false,
     authenticated = false,
@@ -104,6 +108,13 @@ function L.Init_Nakama(host, port, server_key, use_ssl)
 
     if result then
         L.initialized = true
+        nakamaLib.SetExecutionMode(L.execution_mode)
+        if not L.Register_Pump() then
+            L.Shutdown()
+            L.last_error = "Frame callback unavailable"
+            LogError("[Nakama] Init failed: " .. L.last_error)
+            return false
+        end
         L.last_error = ""
         LogInfo("[Nakama] Init successful")
         L.Authenticate_Player(L.Generate_Device_ID(L.player_id), "Player" .. tostring(L.player_id)) -- Auto-auth with proper device ID
@@ -138,39 +149,58 @@ function L.Authenticate_Player(device_id, username)
         return false
     end
 
-    local result, error = nakamaLib.Authenticate(device_id, username or "TestPlayer")
-    if result then
-        L.authenticated = true
-        L.last_error = ""
-        LogInfo("[Nakama] Authentication successful")
-        L.Raise_Signal("auth_complete", "success")
-        return true
-    else
-        L.last_error = error or "Authentication failed"
-        LogError("[Nakama] Authentication failed: " .. L.last_error)
-        return false
+    local function on_done(result, error)
+        if result then
+            L.authenticated = true
+            L.last_error = ""
+            LogInfo("[Nakama] Authentication successful")
+            L.Raise_Signal("auth_complete", "success")
+        else
+            L.last_error = error or "Authentication failed"
+            LogError("[Nakama] Authentication failed: " .. L.last_error)
+        end
     end
+
+    -- Init_Nakama only succeeds with Pump registered, which resumes the coroutine
+    L.Run(function()
+        on_done(nakamaLib.AuthenticateAwait(device_id, username or "TestPlayer"))
+    end)
+    return true
 end
 
-function L.Sync_Player_Data(credits, playtime)
+-- on_done(success) runs exactly once, when the sync finishes or fails.
+function L.Sync_Player_Data(credits, playtime, on_done)
+    local function finish(result, error)
+        if result then
+            L.last_error = ""
+            LogInfo("[Nakama] Player data sync successful")
+        else
+            L.last_error = error or "Sync failed"
+            LogError("[Nakama] Player data sync failed: " .. L.last_error)
+        end
+        if on_done then
+            on_done(result)
+        end
+    end
+
     if not nakamaLib or not L.initialized or not L.authenticated then
-        L.last_error = "Not authenticated"
+        finish(false, "Not authenticated")
         return false
     end
 
-    local result, error = nakamaLib.SyncPlayerData(
-        "Player" .. tostring(L.player_id),
-        credits or 0,
-        playtime or 0
-    )
-    if result then
-        L.last_error = ""
-        LogInfo("[Nakama] Player data sync successful")
-        return true
-    else
-        L.last_error = error or "Sync failed"
-        LogError("[Nakama] Player data sync failed: " .. L.last_error)
-        return false
+    local player_name = "Player" .. tostring(L.player_id)
+    L.Run(function()
+        finish(nakamaLib.SyncPlayerDataAwait(player_name, credits or 0, playtime or 0))
+    end)
+    return true
+end
+
+-- Run fn(...) as a coroutine. Inside it, the nakamaLib *Await calls yield
+-- until their operation finishes and Pump resumes them with (success, error).
+function L.Run(fn, ...)
+    local ok, err = coroutine.resume(coroutine.create(fn), ...)
+    if not ok then
+        LogError("[Nakama] Coroutine failed: " .. tostring(err))
     end
 end
 
@@ -184,6 +214,29 @@ function L.Get_Status()
     return "unknown"
 end
 
+-- Runs once per frame; see NakamaX4Client::Pump
+function L.Pump()
+    if nakamaLib and L.initialized then
+        nakamaLib.Pump()
+    end
+end
+
+-- Returns false if there is no frame callback. Without Pump, queued Lua
+-- callbacks and inbound match events would never run, so Init_Nakama fails.
+function L.Register_Pump()
+    if L.pump_registered then
+        return true
+    end
+    local ok, Time = pcall(require, "extensions.sn_mod_support_apis.ui.time.Interface")
+    if ok and Time and Time.Register_NewFrame_Callback then
+        Time.Register_NewFrame_Callback(L.Pump)
+        L.pump_registered = true
+        return true
+    end
+    LogError("[Nakama] Frame callback unavailable; shutting the client down, nothing would run Pump")
+    return false
+end
+
 function L.Shutdown()
     if nakamaLib and L.initialized then
         nakamaLib.Shutdown()
@@ -204,9 +257,9 @@ function L.Process_Command(signal, value)
         success = L.Init_Nakama()
         result = success and "success" or L.last_error
     elseif signal == "Nakama.Sync" then
-        success = L.Sync_Player_Data(value.credits, value.playtime)
-        result = success and "success" or L.last_error
-        L.Raise_Signal("sync_complete", result)
+        success = L.Sync_Player_Data(value.credits, value.playtime, function(synced)
+            L.Raise_Signal("sync_complete", synced and "success" or L.last_error)
+        end)
     elseif signal == "Nakama.Status" then
         result = L.Get_Status()
         L.Raise_Signal("status_response", result)